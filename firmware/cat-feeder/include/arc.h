@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+
+/**
+ * Circular progress gauge drawn along the top edge of the round display.
+ * The arc is divided into fixed angular steps, and only the steps that
+ * changed since the previous update are rasterized. The arc lies above the
+ * text lines, where the screen is always BACKGROUND regardless of the
+ * palette, so it is hidden by painting it in that color.
+ */
+class ProgressArc {
+private:
+    /**
+     * Color of the screen around the arc.
+     */
+    static constexpr uint16_t BACKGROUND = 0;
+
+    /**
+     * Center of the display.
+     */
+    static constexpr int16_t CENTER = 120;
+
+    /**
+     * Inner radius of the arc. Chosen such that the arc stays above the
+     * topmost text line of the user interface.
+     */
+    static constexpr int16_t RADIUS_INNER = 102;
+
+    /**
+     * Outer radius of the arc.
+     */
+    static constexpr int16_t RADIUS_OUTER = 116;
+
+    /**
+     * Total angle spanned by the arc, centered around the top of the display.
+     */
+    static constexpr int16_t SWEEP_DEGREES = 110;
+
+    /**
+     * Number of angular steps the arc is divided into.
+     */
+    static constexpr int16_t NUM_STEPS = 55;
+
+    /**
+     * Inner and outer endpoint of the boundary between two steps, relative
+     * to the center of the display.
+     */
+    struct Spoke {
+        int8_t inner_x;
+        int8_t inner_y;
+        int8_t outer_x;
+        int8_t outer_y;
+    };
+
+    /**
+     * Precomputed angle to spoke coordinate table. Step i is the quad between
+     * spoke i and spoke i + 1.
+     */
+    Spoke spokes[NUM_STEPS + 1] = {};
+
+    /**
+     * Number of steps currently drawn in the fill color, or -1 if the arc is
+     * not drawn at all.
+     */
+    int16_t steps_filled = -1;
+
+    /**
+     * Colors the arc was drawn with.
+     */
+    uint16_t color_fill = 0;
+    uint16_t color_track = 0;
+
+    /**
+     * Rasterizes steps [from, to) in the given color.
+     */
+    void draw_steps(Adafruit_GFX &gfx, int16_t from, int16_t to, uint16_t color) const;
+
+public:
+    /**
+     * Computes the spoke table and clears the area of the arc to
+     * BACKGROUND.
+     */
+    void begin(Adafruit_GFX &gfx);
+
+    /**
+     * Forgets what was drawn, forcing a full redraw on the next update. To be
+     * used after the screen was cleared by something else.
+     */
+    void invalidate();
+
+    /**
+     * Updates the arc for the given progress in per mille, or hides it if
+     * progress is negative. Only draws what changed since the previous call,
+     * unless the colors changed.
+     */
+    void update(Adafruit_GFX &gfx, int16_t progress, uint16_t fill, uint16_t track);
+};
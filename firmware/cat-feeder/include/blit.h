@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SPITFT.h>
+
+/**
+ * Destination for blocks of RGB565 pixels that were composed off-screen.
+ * Adafruit_GFX has no virtual for this, and its drawRGBBitmap() draws pixel
+ * by pixel, so the user interface sends its text lines through this
+ * interface instead.
+ */
+class BlitTarget {
+public:
+    /**
+     * Copies a w by h block of pixels, stored row by row, to (x, y).
+     */
+    virtual void blit(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels) = 0;
+
+protected:
+    ~BlitTarget() = default;
+};
+
+/**
+ * Blits to an SPI display with a single address window and transaction.
+ */
+class PanelBlit : public BlitTarget {
+private:
+    /**
+     * Display driver.
+     */
+    Adafruit_SPITFT &panel;
+
+public:
+    explicit PanelBlit(Adafruit_SPITFT &panel);
+
+    void blit(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels) override;
+};
+
+/**
+ * Blits into an unrotated GFXcanvas16, clipping to its bounds, so the user
+ * interface can be rendered to an in-memory image.
+ */
+class CanvasBlit : public BlitTarget {
+private:
+    /**
+     * Destination canvas.
+     */
+    GFXcanvas16 &canvas;
+
+public:
+    explicit CanvasBlit(GFXcanvas16 &canvas);
+
+    void blit(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels) override;
+};
+
+/**
+ * Display controller settings that are not drawing operations, so the user
+ * interface can drive a panel it doesn't own.
+ */
+class PanelControl {
+public:
+    /**
+     * Changes the SPI clock frequency.
+     */
+    virtual void set_spi_speed(uint32_t frequency) = 0;
+
+    /**
+     * Sets the display rotation in quarter turns.
+     */
+    virtual void set_rotation(uint8_t rotation) = 0;
+
+protected:
+    ~PanelControl() = default;
+};
+
+/**
+ * Controls an SPI display through its Adafruit driver.
+ */
+class SPIPanelControl : public PanelControl {
+private:
+    /**
+     * Display driver.
+     */
+    Adafruit_SPITFT &panel;
+
+public:
+    explicit SPIPanelControl(Adafruit_SPITFT &panel);
+
+    void set_spi_speed(uint32_t frequency) override;
+    void set_rotation(uint8_t rotation) override;
+};
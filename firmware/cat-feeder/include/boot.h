@@ -0,0 +1,117 @@
+#pragma once
+
+#include <Arduino.h>
+#include "format.h"
+
+/**
+ * Boot progress timestamps. Boot runs as overlapping stages: the display
+ * starts on core 1 while core 0 sets up, WiFi associates and the first
+ * HX711 conversions run from the main loop, and MQTT discovery follows
+ * once connected. Each stage marks its phase when it first completes;
+ * the main loop prints new marks on serial and the whole set is published
+ * over MQTT once complete.
+ */
+class Boot {
+public:
+    /**
+     * Boot milestones, in the order they are usually reached.
+     */
+    enum class Phase : uint8_t {
+        /**
+         * Display initialized and showing the boot status frame.
+         */
+        DISPLAY_READY,
+
+        /**
+         * setup() returned.
+         */
+        SETUP_DONE,
+
+        /**
+         * First full frame with state machine data drawn.
+         */
+        FIRST_FRAME,
+
+        /**
+         * First loadcell measurement completed.
+         */
+        FIRST_MEASUREMENT,
+
+        /**
+         * WiFi associated and got an address.
+         */
+        WIFI_CONNECTED,
+
+        /**
+         * Connected to the MQTT broker.
+         */
+        MQTT_CONNECTED,
+
+        /**
+         * All discovery configs announced.
+         */
+        DISCOVERY_DONE,
+
+        COUNT
+    };
+
+private:
+    /**
+     * Time each phase was reached, in milliseconds since reset.
+     */
+    volatile uint32_t phase_millis[static_cast<size_t>(Phase::COUNT)] = {};
+
+    /**
+     * Whether each phase was reached. Separate flags rather than a mask,
+     * as phases are marked from both cores.
+     */
+    volatile bool marked[static_cast<size_t>(Phase::COUNT)] = {};
+
+    /**
+     * Whether each phase was printed by report().
+     */
+    bool reported[static_cast<size_t>(Phase::COUNT)] = {};
+
+public:
+    /**
+     * Records that a phase was reached, if it wasn't already.
+     */
+    void mark(Phase phase);
+
+    /**
+     * Returns whether a phase was reached.
+     */
+    [[nodiscard]] bool is_marked(Phase phase) const;
+
+    /**
+     * Returns the time at which a phase was reached.
+     */
+    [[nodiscard]] uint32_t get_millis(Phase phase) const;
+
+    /**
+     * Returns whether every phase was reached.
+     */
+    [[nodiscard]] bool is_complete() const;
+
+    /**
+     * Returns the time at which the last phase reached so far was reached.
+     */
+    [[nodiscard]] uint32_t get_completion_millis() const;
+
+    /**
+     * Prints phases reached since the previous call. Called from the main
+     * loop.
+     */
+    void report(Print &out);
+
+    /**
+     * Writes the reached phases as a JSON object of milliseconds since
+     * reset.
+     */
+    void summarize(Formatter &f) const;
+};
+
+/**
+ * Global boot progress.
+ */
+extern Boot boot;
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Non-blocking line reader for commands on the serial console.
+ */
+class Console {
+private:
+    /**
+     * Line being received.
+     */
+    char line[64] = {};
+
+    /**
+     * Number of characters received for the current line.
+     */
+    size_t length = 0;
+
+public:
+    /**
+     * Reads whatever is available from the serial port. Returns a
+     * null-terminated command line once a complete line has been received,
+     * or nullptr otherwise. The returned string is valid until the next call.
+     */
+    const char *poll();
+};
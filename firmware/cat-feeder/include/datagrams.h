@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Telemetry event types.
+ */
+enum class TelemetryEvent : uint8_t {
+    /**
+     * Raw HX711 sample; argument is the Loadcell::Sensor.
+     */
+    SAMPLE,
+
+    /**
+     * Limit switch edge; argument is the new level.
+     */
+    LIMIT,
+
+    /**
+     * Motor output change; argument is the new level.
+     */
+    MOTOR,
+
+    /**
+     * State machine transition; argument is the new state.
+     */
+    STATE,
+};
+
+/**
+ * Ping-pong datagram buffers of the telemetry stream, kept free of hardware
+ * access so they can be tested on the host. Events are written straight into
+ * the active buffer; a full buffer is sealed and the other one becomes
+ * active, unless it is still waiting to be sent, in which case events are
+ * dropped and counted.
+ *
+ * Datagram layout, little endian: 'C', 'F', version, record count, 16-bit
+ * sequence number, 16-bit total dropped event count, then the records.
+ * Each record is a 32-bit micros() timestamp, 8-bit event type, 8-bit
+ * argument and 32-bit signed value.
+ */
+class TelemetryBuffer {
+public:
+    /**
+     * Header and record sizes.
+     */
+    static constexpr size_t HEADER_SIZE = 8;
+    static constexpr size_t RECORD_SIZE = 10;
+
+    /**
+     * Format version in the header.
+     */
+    static constexpr uint8_t VERSION = 1;
+
+    /**
+     * A sealed datagram; length is 0 if there is none.
+     */
+    struct Datagram {
+        const uint8_t *data;
+        size_t length;
+    };
+
+private:
+    /**
+     * Storage of both buffers, back to back.
+     */
+    uint8_t *const storage;
+
+    /**
+     * Size of one buffer.
+     */
+    const size_t datagram_size;
+
+    /**
+     * Bytes used per buffer.
+     */
+    size_t lengths[2] = {HEADER_SIZE, HEADER_SIZE};
+
+    /**
+     * Whether a buffer is sealed and waiting to be sent.
+     */
+    bool ready[2] = {false, false};
+
+    /**
+     * Buffer currently being filled.
+     */
+    uint8_t active = 0;
+
+    /**
+     * Sequence number of the next datagram.
+     */
+    uint16_t sequence = 0;
+
+    /**
+     * Events dropped because both buffers were full.
+     */
+    uint32_t dropped = 0;
+
+    /**
+     * Seals the active buffer and switches to the other one, if it is free.
+     * Returns false if it isn't.
+     */
+    bool swap();
+
+public:
+    /**
+     * Uses the given storage of twice the datagram size.
+     */
+    TelemetryBuffer(uint8_t *storage, size_t datagram_size);
+
+    /**
+     * Appends a record, or drops it if both buffers are full.
+     */
+    void append(TelemetryEvent event, uint8_t arg, int32_t value, uint32_t now_micros);
+
+    /**
+     * Seals the active buffer if it holds any records and the other one is
+     * free. Returns whether it did.
+     */
+    bool seal();
+
+    /**
+     * Returns the sealed datagram waiting to be sent, if any.
+     */
+    [[nodiscard]] Datagram sealed() const;
+
+    /**
+     * Frees the sealed datagram after sending it.
+     */
+    void release();
+
+    /**
+     * Returns the number of events dropped because of backpressure.
+     */
+    [[nodiscard]] uint32_t get_dropped() const;
+};
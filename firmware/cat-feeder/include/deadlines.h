@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Deadline bookkeeping for the watchdog, kept free of hardware access so it
+ * can be tested on the host. Each slot (one per core) tracks the subsystem
+ * currently running on it and the time by which it must have moved on to
+ * the next one. Times are in milliseconds and may wrap.
+ *
+ * A slot is written only by its own core and read from interrupts on
+ * either core; every field is a single aligned word or byte.
+ */
+class Deadlines {
+public:
+    /**
+     * Number of slots.
+     */
+    static constexpr size_t SLOTS = 2;
+
+    /**
+     * Description of an overrun.
+     */
+    struct Expiry {
+        /**
+         * Subsystem that overran.
+         */
+        uint8_t subsystem;
+
+        /**
+         * Time since the deadline passed.
+         */
+        uint32_t overdue_millis;
+    };
+
+private:
+    /**
+     * Per-slot state.
+     */
+    struct Slot {
+        volatile uint32_t entered;
+        volatile uint32_t deadline;
+        volatile uint8_t subsystem;
+        volatile bool armed;
+    };
+
+    /**
+     * Slots.
+     */
+    Slot slots[SLOTS] = {};
+
+public:
+    /**
+     * Records that subsystem starts running in slot at time now and must
+     * be done within budget milliseconds. Arms the slot.
+     */
+    void enter(size_t slot, uint8_t subsystem, uint32_t now, uint32_t budget);
+
+    /**
+     * Returns whether the slot is armed and its subsystem has been running
+     * for more than limit milliseconds at time now, regardless of its own
+     * budget.
+     */
+    [[nodiscard]] bool running_longer(size_t slot, uint32_t now, uint32_t limit) const;
+
+    /**
+     * Returns whether the slot is armed and more than grace milliseconds
+     * past its deadline at time now, filling in expiry if so.
+     */
+    bool expired(size_t slot, uint32_t now, uint32_t grace, Expiry &expiry) const;
+};
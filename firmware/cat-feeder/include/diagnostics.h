@@ -0,0 +1,175 @@
+#pragma once
+
+#include <Arduino.h>
+#include "trace.h"
+
+/**
+ * Histogram of durations with power-of-two microsecond buckets.
+ */
+class Histogram {
+public:
+    /**
+     * Number of buckets. Bucket i counts durations below 2^i microseconds
+     * that didn't fit in bucket i - 1; the last bucket counts everything
+     * else.
+     */
+    static constexpr size_t NUM_BUCKETS = 20;
+
+private:
+    /**
+     * Cumulative count per bucket.
+     */
+    uint32_t counts[NUM_BUCKETS] = {};
+
+public:
+    /**
+     * Adds a duration to the histogram.
+     */
+    void add(uint32_t micros);
+
+    /**
+     * Returns the cumulative count for the given bucket.
+     */
+    [[nodiscard]] uint32_t get_count(size_t bucket) const;
+
+    /**
+     * Returns the exclusive upper bound of the given bucket in microseconds,
+     * or 0 for the unbounded last bucket.
+     */
+    [[nodiscard]] static uint32_t get_bound(size_t bucket);
+
+    /**
+     * Returns the upper bound of the bucket containing the given percentile
+     * (in per mille) of the durations added since the histogram was in the
+     * state given by since.
+     */
+    [[nodiscard]] uint32_t percentile(const Histogram &since, uint32_t per_mille) const;
+};
+
+/**
+ * Cross-cutting counters for the diagnostics page.
+ */
+class Diagnostics {
+private:
+    /**
+     * Maximum number of stack words checked per core and memory_poll().
+     */
+    static constexpr size_t STACK_SCAN_WORDS = 64;
+
+    /**
+     * Interval at which the heap is sampled.
+     */
+    static constexpr uint32_t HEAP_SAMPLE_MILLIS = 100;
+
+    /**
+     * Time at which the previous main loop iteration started.
+     */
+    uint32_t loop_prev_micros = 0;
+
+    /**
+     * Whether each core has painted its stack.
+     */
+    volatile bool stack_painted[2] = {false, false};
+
+    /**
+     * Lowest word of each core's stack found overwritten, or null if none
+     * was found yet.
+     */
+    const uint32_t *stack_low[2] = {nullptr, nullptr};
+
+    /**
+     * Next word to check per core, or null to start at the bottom.
+     */
+    const volatile uint32_t *stack_cursor[2] = {nullptr, nullptr};
+
+    /**
+     * Lowest free heap seen.
+     */
+    uint32_t heap_min_free = UINT32_MAX;
+
+    /**
+     * millis() at which the heap was last sampled.
+     */
+    uint32_t heap_sample_millis = 0;
+
+public:
+    /**
+     * Duration of main loop iterations.
+     */
+    Histogram loop_histogram;
+
+    /**
+     * Number of MQTT state messages published by our sensors.
+     */
+    uint32_t mqtt_publishes = 0;
+
+    /**
+     * Number of times the MQTT connection was established.
+     */
+    uint32_t mqtt_connects = 0;
+
+    /**
+     * Longest time the main loop spent in MQTT handling (mqtt.loop() plus
+     * the discovery step) in one iteration.
+     */
+    uint32_t mqtt_loop_max_micros = 0;
+
+    /**
+     * Counts an MQTT state message published by one of our sensors.
+     */
+    void mqtt_published() {
+        mqtt_publishes++;
+        trace.record(Trace::Event::PUBLISH, 0, static_cast<int32_t>(mqtt_publishes));
+    }
+
+    /**
+     * Marks the start of a main loop iteration.
+     */
+    void loop_mark();
+
+    /**
+     * Fills the unused part of the calling core's stack with a known
+     * pattern, so its high-water mark can be found later. Must be called
+     * early, from each core.
+     */
+    void paint_stack();
+
+    /**
+     * Advances the stack high-water scan by a bounded number of words per
+     * core, and samples the heap on a schedule. Call from the main loop.
+     */
+    void memory_poll();
+
+    /**
+     * Returns the maximum number of stack bytes the given core has used
+     * since its stack was painted, as far as the scan got.
+     */
+    [[nodiscard]] uint32_t stack_used(unsigned core) const;
+
+    /**
+     * Returns the stack size of the given core in bytes.
+     */
+    [[nodiscard]] static uint32_t stack_size(unsigned core);
+
+    /**
+     * Returns the current free heap in bytes.
+     */
+    [[nodiscard]] static uint32_t heap_free();
+
+    /**
+     * Returns the lowest free heap seen by memory_poll().
+     */
+    [[nodiscard]] uint32_t get_heap_min_free() const;
+
+    /**
+     * Returns the size of the heap area above the highest allocation that
+     * malloc hasn't claimed yet. This is a lower bound on the largest block
+     * that can be allocated; the rest of the free heap is fragments.
+     */
+    [[nodiscard]] static uint32_t heap_largest_free();
+};
+
+/**
+ * Global diagnostics counters.
+ */
+extern Diagnostics diagnostics;
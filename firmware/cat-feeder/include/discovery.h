@@ -0,0 +1,258 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoHA.h>
+#include <utility>
+
+/**
+ * Network client through which HAMqtt talks to the broker. Forwards
+ * everything to the underlying client, except that between begin_hash()
+ * and end_hash() written bytes are folded into an FNV-1a hash instead of
+ * being sent.
+ */
+class DiscoveryClient : public Client {
+private:
+    /**
+     * Underlying client.
+     */
+    Client &inner;
+
+    /**
+     * Whether writes are being hashed.
+     */
+    bool hashing = false;
+
+    /**
+     * Hash of the bytes written since begin_hash().
+     */
+    uint32_t hash = 0;
+
+public:
+    explicit DiscoveryClient(Client &inner);
+
+    /**
+     * Starts hashing instead of sending written bytes.
+     */
+    void begin_hash();
+
+    /**
+     * Resumes sending and returns the nonzero hash of the bytes written
+     * since begin_hash().
+     */
+    [[nodiscard]] uint32_t end_hash();
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char *host, uint16_t port) override;
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override;
+};
+
+/**
+ * Paces Home Assistant discovery. On every (re)connect ArduinoHA publishes
+ * the discovery config, availability and state of all entities from within
+ * a single mqtt.loop() call, holding up the main loop for the whole burst.
+ * Entities declared as Paced<T> instead only mark themselves pending when
+ * connected; poll() then announces one of them per call, and does nothing
+ * at all while a feed is in progress.
+ *
+ * Discovery configs are retained by the broker, so the config of an entity
+ * is skipped (availability, state and subscriptions are still sent) if its
+ * hash equals that of the last config sent during a round that completed
+ * with the connection still up. The hash covers the serialized config,
+ * obtained by flushing it into the DiscoveryClient that HAMqtt writes
+ * through. Hashes are only kept in RAM, so everything
+ * is sent again after a reboot or firmware update, and whenever Home
+ * Assistant announces it came online.
+ */
+class Discovery {
+public:
+    /**
+     * Maximum number of paced entities.
+     */
+    static constexpr size_t MAX_ENTITIES = 40;
+
+    /**
+     * Topic on which Home Assistant announces its status.
+     */
+    static constexpr const char *STATUS_TOPIC = "homeassistant/status";
+
+    /**
+     * Bookkeeping for a paced entity; see Paced.
+     */
+    class Entity {
+    private:
+        friend class Discovery;
+
+        /**
+         * Hash of the config confirmed to be retained by the broker, or 0 if
+         * unknown.
+         */
+        uint32_t known_hash = 0;
+
+    protected:
+        /**
+         * Whether the entity was registered; if not, it is announced
+         * immediately on connect like an ordinary entity.
+         */
+        bool registered;
+
+        /**
+         * Whether the entity is waiting to be announced.
+         */
+        bool pending = false;
+
+        /**
+         * Hash of the most recently built config.
+         */
+        uint32_t hash = 0;
+
+        Entity();
+
+        /**
+         * Publishes config, availability and state and subscribes to the
+         * command topics, as ArduinoHA does on connect.
+         */
+        virtual void announce() = 0;
+
+        /**
+         * Returns whether a config with the current hash is already retained
+         * by the broker.
+         */
+        [[nodiscard]] bool is_retained() const;
+    };
+
+private:
+    /**
+     * Registered entities, in declaration order. Filled during static
+     * initialization, so this must not depend on a constructor having run.
+     */
+    static Entity *entities[MAX_ENTITIES];
+
+    /**
+     * Number of registered entities.
+     */
+    static size_t count;
+
+    /**
+     * Client that configs are hashed through. Static like the registry
+     * because Paced entities only know the class; set by the constructor.
+     */
+    static DiscoveryClient *client;
+
+    /**
+     * MQTT manager.
+     */
+    HAMqtt &mqtt;
+
+    /**
+     * Index of the next entity to consider.
+     */
+    size_t cursor = 0;
+
+    /**
+     * Whether a round of announcements is in progress.
+     */
+    bool round_active = false;
+
+    /**
+     * Longest time a single announcement took.
+     */
+    uint32_t max_announce_micros = 0;
+
+    /**
+     * Number of configs skipped because the broker already had them.
+     */
+    uint32_t skipped = 0;
+
+    /**
+     * Registers an entity. Returns false if the registry is full.
+     */
+    static bool add(Entity *entity);
+
+public:
+    /**
+     * Takes the MQTT manager and the client it was constructed with.
+     */
+    Discovery(HAMqtt &mqtt, DiscoveryClient &client);
+
+    /**
+     * Returns a nonzero hash of the serialized config, without sending it.
+     */
+    [[nodiscard]] static uint32_t hash(const HASerializer &serializer);
+
+    /**
+     * Starts a round of announcements; call from the MQTT connected
+     * callback.
+     */
+    void on_connected();
+
+    /**
+     * Handles an incoming message. Returns true if it was a Home Assistant
+     * status message.
+     */
+    bool on_message(const char *topic, const uint8_t *payload, uint16_t length);
+
+    /**
+     * Forgets all retained configs and announces every entity again.
+     */
+    void resend();
+
+    /**
+     * Announces at most one pending entity, unless busy is set.
+     */
+    void poll(bool busy);
+
+    /**
+     * Returns the longest time a single announcement took.
+     */
+    [[nodiscard]] uint32_t get_max_announce_micros() const;
+
+    /**
+     * Returns the number of configs skipped because they were retained.
+     */
+    [[nodiscard]] uint32_t get_skipped() const;
+
+    /**
+     * Returns whether a round of announcements is in progress.
+     */
+    [[nodiscard]] bool is_announcing() const;
+};
+
+/**
+ * ArduinoHA entity type T whose discovery is paced by Discovery.
+ */
+template <class T>
+class Paced : public T, public Discovery::Entity {
+public:
+    template <class... Args>
+    explicit Paced(Args &&...args) : T(std::forward<Args>(args)...) {
+    }
+
+protected:
+    void onMqttConnected() override {
+        if (registered) {
+            pending = true;
+        } else {
+            announce();
+        }
+    }
+
+    void buildSerializer() override {
+        T::buildSerializer();
+        if (this->_serializer == nullptr) return;
+        hash = Discovery::hash(*this->_serializer);
+        if (is_retained()) this->destroySerializer();
+    }
+
+    void announce() override {
+        T::onMqttConnected();
+    }
+};
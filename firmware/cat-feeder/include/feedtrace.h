@@ -0,0 +1,160 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Per-phase trace of feed cycles. The state machine reports how long it
+ * spent in each feed state, how often a state was retried, the stddev of
+ * each measurement and the outcome; the last CYCLES cycles are kept in a
+ * ring, from which the median and 95th percentile duration of each phase
+ * are derived to see where a cycle's time goes.
+ */
+class FeedTrace {
+public:
+    /**
+     * Number of feed phases, one per FEED_* state, in state order.
+     */
+    static constexpr size_t PHASES = 10;
+
+    /**
+     * Number of cycles kept.
+     */
+    static constexpr size_t CYCLES = 16;
+
+    /**
+     * Result code for a cycle that was interrupted (reset, maintenance).
+     */
+    static constexpr uint8_t ABORTED = 0xFF;
+
+    /**
+     * Trace of a single feed cycle.
+     */
+    struct Cycle {
+        /**
+         * millis() at the start of the cycle.
+         */
+        uint32_t start_millis;
+
+        /**
+         * Total time spent in each phase, saturating.
+         */
+        uint16_t phase_millis[PHASES];
+
+        /**
+         * Measurement stddev per phase in centigrams, for the phases that
+         * measure.
+         */
+        uint16_t stddev_centigrams[PHASES];
+
+        /**
+         * Number of times each phase was retried.
+         */
+        uint8_t retries[PHASES];
+
+        /**
+         * Bit i is set if phase i was entered.
+         */
+        uint16_t visited;
+
+        /**
+         * Dispensed amount in decigrams, if successful.
+         */
+        int16_t decigrams;
+
+        /**
+         * StateMachine::FeedResult, or ABORTED.
+         */
+        uint8_t result;
+
+        /**
+         * Returns the total duration of the cycle.
+         */
+        [[nodiscard]] uint32_t total_millis() const;
+    };
+
+private:
+    /**
+     * Completed cycles; the newest is at index (next - 1) % CYCLES.
+     */
+    Cycle cycles[CYCLES] = {};
+
+    /**
+     * Number of valid entries in cycles.
+     */
+    size_t count = 0;
+
+    /**
+     * Index at which the next cycle is stored.
+     */
+    size_t next = 0;
+
+    /**
+     * Cycle in progress.
+     */
+    Cycle current = {};
+
+    /**
+     * Whether a cycle is in progress.
+     */
+    bool active = false;
+
+    /**
+     * Incremented whenever a cycle completes.
+     */
+    uint32_t sequence = 0;
+
+public:
+    /**
+     * Starts a cycle.
+     */
+    void begin();
+
+    /**
+     * Adds time spent in a phase. Retried is set if the phase is entered
+     * again right away.
+     */
+    void phase(size_t phase, uint32_t millis, bool retried);
+
+    /**
+     * Records the stddev of a measurement completed in a phase.
+     */
+    void measured(size_t phase, float stddev);
+
+    /**
+     * Sets the outcome of the cycle in progress.
+     */
+    void set_result(uint8_t result, float grams);
+
+    /**
+     * Completes the cycle in progress.
+     */
+    void end();
+
+    /**
+     * Returns the number of completed cycles in the ring.
+     */
+    [[nodiscard]] size_t get_count() const;
+
+    /**
+     * Returns a completed cycle; age 0 is the most recent one. Only valid
+     * for age < get_count().
+     */
+    [[nodiscard]] const Cycle &get_cycle(size_t age) const;
+
+    /**
+     * Returns a counter incremented with every completed cycle.
+     */
+    [[nodiscard]] uint32_t get_sequence() const;
+
+    /**
+     * Returns the duration of a phase at the given percentile (per mille,
+     * nearest rank) over the cycles that entered it, or 0 if none did.
+     */
+    [[nodiscard]] uint32_t percentile(size_t phase, uint32_t per_mille) const;
+
+    /**
+     * Writes a JSON summary: p50 and p95 duration per phase and the details
+     * of the most recent cycle. Returns the length written.
+     */
+    size_t summarize(char *buffer, size_t size) const;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Estimates how many days the kibble in the reservoir will last. Keeps a ring
+ * of daily dispensed totals along with running sums for a least-squares line
+ * through them, so both recording a feed and closing a day are constant-time
+ * operations that never rescan the history.
+ */
+class Forecaster {
+public:
+    /**
+     * Number of daily totals used for the regression.
+     */
+    static constexpr size_t DAYS = 14;
+
+    /**
+     * Minimum number of completed days before the history is used; until
+     * then the configured daily amount is assumed.
+     */
+    static constexpr size_t MIN_DAYS = 3;
+
+    /**
+     * Value returned when the reservoir is not expected to run out.
+     */
+    static constexpr float MAX_DAYS = 999.0f;
+
+private:
+    /**
+     * Length of a day.
+     */
+    static constexpr int32_t DAY_MILLIS = 86400000;
+
+    /**
+     * Completed daily totals in decigrams, oldest at index head once the
+     * ring is full.
+     */
+    int32_t totals[DAYS] = {0};
+
+    /**
+     * Index of the oldest total in the ring.
+     */
+    size_t head = 0;
+
+    /**
+     * Number of valid totals in the ring.
+     */
+    size_t count = 0;
+
+    /**
+     * Running sum of the totals (y).
+     */
+    int32_t sum_y = 0;
+
+    /**
+     * Running sum of the totals weighted by their age-ordered index, oldest
+     * being 0 (x * y).
+     */
+    int32_t sum_xy = 0;
+
+    /**
+     * Amount dispensed so far today, in decigrams.
+     */
+    int32_t today = 0;
+
+    /**
+     * Time elapsed in the current day.
+     */
+    int32_t millis_in_day = 0;
+
+    /**
+     * Whether the cached forecast below is valid.
+     */
+    bool cache_valid = false;
+
+    /**
+     * Inputs and result of the most recent forecast. The fit only changes
+     * when a day is closed and the reservoir only when it is read out, so
+     * most calls return the cached result.
+     */
+    float cache_reservoir_grams = 0.0f;
+    float cache_fallback_grams_per_day = 0.0f;
+    float cache_days = 0.0f;
+
+    /**
+     * Closes the current day and pushes its total into the ring.
+     */
+    void roll();
+
+    /**
+     * Computes days_remaining() without the cache.
+     */
+    [[nodiscard]] float compute_days_remaining(float reservoir_grams, float fallback_grams_per_day) const;
+
+public:
+    /**
+     * Records an amount of dispensed kibble.
+     */
+    void add(float grams);
+
+    /**
+     * Advances the day clock, closing the day if it is over.
+     */
+    void update(int32_t delta_millis);
+
+    /**
+     * Returns the number of days until the given amount of kibble is used
+     * up, following the trend of the daily totals. Uses the given daily
+     * amount instead while there is not enough history yet. Returns MAX_DAYS
+     * if consumption trends toward zero before the reservoir is empty.
+     * Only recomputed when the inputs or the daily totals changed.
+     */
+    [[nodiscard]] float days_remaining(float reservoir_grams, float fallback_grams_per_day);
+
+    /**
+     * Returns the number of completed days in the history.
+     */
+    [[nodiscard]] size_t get_count() const;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Minimal replacement for the snprintf formats used in the status reports,
+ * writing into a fixed-size character buffer without touching the heap or
+ * the floating-point printf machinery. Output is always null-terminated and
+ * silently truncated, like snprintf.
+ */
+class Formatter {
+private:
+    /**
+     * Output buffer.
+     */
+    char *buffer;
+
+    /**
+     * Size of the output buffer including null terminator.
+     */
+    size_t size;
+
+    /**
+     * Number of characters written so far.
+     */
+    size_t length = 0;
+
+    /**
+     * Appends a single character.
+     */
+    void put(char c);
+
+    /**
+     * Appends a number with optional sign, right-aligned to the given width
+     * using spaces, or zero-padded after the sign if zero_pad is set. If
+     * decimals is nonzero, that many of the trailing digits are placed
+     * after a decimal point.
+     */
+    void put_number(uint64_t magnitude, bool negative, bool plus, uint8_t width, bool zero_pad, uint8_t decimals);
+
+public:
+    Formatter(char *buffer, size_t size);
+
+    template <size_t N>
+    explicit Formatter(char (&buffer)[N]) : Formatter(buffer, N) {}
+
+    /**
+     * Appends a string, like %s.
+     */
+    Formatter &text(const char *s);
+
+    /**
+     * Appends a character, like %c.
+     */
+    Formatter &character(char c);
+
+    /**
+     * Appends an integer, like %d, %+d, %5d or %02d.
+     */
+    Formatter &integer(int32_t value, uint8_t width = 0, bool plus = false, bool zero_pad = false);
+
+    /**
+     * Appends an unsigned integer, like %lu.
+     */
+    Formatter &natural(uint32_t value);
+
+    /**
+     * Appends a 32-bit value in hexadecimal, like 0x%08lx.
+     */
+    Formatter &hex(uint32_t value);
+
+    /**
+     * Appends a value with one decimal place, like %.1f, %+7.1f or %6.1f,
+     * including the round-half-to-even behavior of printf.
+     */
+    Formatter &decimal(float value, uint8_t width = 0, bool plus = false);
+
+    /**
+     * Appends a duration as h:mm:ss, or m:ss if hours is not set.
+     */
+    Formatter &clock(unsigned long seconds, bool hours = true);
+
+    /**
+     * Appends an IPv4 address in dotted-decimal notation.
+     */
+    Formatter &ip(const uint8_t address[4]);
+
+    /**
+     * Returns the number of characters written, excluding truncated ones.
+     */
+    [[nodiscard]] size_t get_length() const;
+};
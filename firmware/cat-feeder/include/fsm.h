@@ -2,7 +2,17 @@
 
 #include <Arduino.h>
 #include <ArduinoHA.h>
+#include "diagnostics.h"
+#include "discovery.h"
+#include "feedtrace.h"
+#include "forecast.h"
+#include "history.h"
+#include "hot.h"
 #include "loadcell.h"
+#include "meals.h"
+#include "reports.h"
+#include "text.h"
+#include "weightlog.h"
 
 //#define DEBUG_FSM
 
@@ -12,62 +22,27 @@
 class StateMachine {
 public:
     /**
-     * Result of previous feed.
+     * Display reports, shared with the rendering code.
      */
-    enum struct FeedResult {
-        /**
-         * No feed has been performed yet.
-         */
-        NONE,
+    using FeedResult = ::FeedResult;
+    using FeedReport = ::FeedReport;
+    using StateReport = ::StateReport;
+    using ErrorSeverity = ::ErrorSeverity;
+    using ErrorReport = ::ErrorReport;
 
+    /**
+     * A published sensor value, for exporting in other formats.
+     */
+    struct Metric {
         /**
-         * Successful feed; arg is amount of milligrams.
+         * Unique ID of the sensor.
          */
-        SUCCESS,
+        const char *name;
 
         /**
-         * Failed to initiate feed due to noise on sensors; arg is number of
-         * consecutively failed attempts.
+         * Current value; binary sensors are 0 or 1.
          */
-        SENSOR_RETRY,
-    };
-
-    /**
-     * Report for result of previous feed.
-     */
-    struct FeedReport {
-        FeedResult result;
-        int arg;
-        unsigned long millis;
-    };
-
-    /**
-     * Feeding status report. If large is set, only up to 10 characters of
-     * detail1 will be used and detail2 is unused, allowing this text to be
-     * printed at 2x scale where detail1+detail2 would normally be.
-     */
-    struct StateReport {
-        char header[21];
-        char detail1[21];
-        char detail2[21];
-        bool large;
-    };
-
-    /**
-     * Severity level for an error message.
-     */
-    enum struct ErrorSeverity {
-        OKAY,
-        WARNING,
-        ERROR
-    };
-
-    /**
-     * Status report.
-     */
-    struct ErrorReport {
-        const char *message;
-        ErrorSeverity severity;
+        float value;
     };
 
 private:
@@ -198,46 +173,62 @@ private:
     MaintenanceMode maintenance_mode = MaintenanceMode::OPERATIONAL;
 
     /**
-     * Excessive standard deviation in reservoir weight readout.
+     * Error codes that put the loadcells in limp mode.
      */
-    bool error_reservoir_stddev = false;
+    static constexpr uint32_t ERROR_MASK_LIMP
+        = error_bit(ErrorCode::SENSOR_TIMEOUT)
+        | error_bit(ErrorCode::RESERVOIR_NOISY)
+        | error_bit(ErrorCode::BOWL_NOISY)
+        | error_bit(ErrorCode::SENSOR_DISAGREE)
+        | error_bit(ErrorCode::SENSOR_SANITY);
 
     /**
-     * Excessive standard deviation in bowl weight readout.
+     * Error codes that are only warnings. All others are errors.
      */
-    bool error_bowl_stddev = false;
+    static constexpr uint32_t ERROR_MASK_WARNING
+        = error_bit(ErrorCode::JAMMED_MAYBE)
+        | error_bit(ErrorCode::RESERVOIR_LOW)
+        | error_bit(ErrorCode::REFILL_SOON);
 
     /**
-     * Loadcell readout timed out.
+     * Error codes that are derived from other state every update, rather
+     * than latched until reset.
      */
-    bool error_loadcell_timeout = false;
+    static constexpr uint32_t ERROR_MASK_DERIVED
+        = error_bit(ErrorCode::JAMMED)
+        | ERROR_MASK_WARNING;
 
     /**
-     * Loadcell readout timed out.
+     * Currently active errors and warnings.
      */
-    bool error_loadcell_disagree = false;
+#ifdef DEBUG_FSM
+    uint32_t error_mask = 0;
+#else
+    uint32_t error_mask = error_bit(ErrorCode::POWER_LOSS);
+#endif
 
     /**
-     * Loadcell readout timed out.
+     * Incremented whenever error_mask changes.
      */
-    bool error_loadcell_unreasonable = false;
+    uint32_t error_sequence = 0;
 
     /**
-     * Motor limit switch readout.
+     * Value of error_sequence when the error sensors were last published.
      */
-    bool error_limit_switch = false;
+    uint32_t error_sequence_published = 0;
 
     /**
-     * Whether there has been a power loss since the last reset.
+     * Sets or clears an error condition.
      */
-#ifdef DEBUG_FSM
-    bool error_power_loss = false;
-#else
-    bool error_power_loss = true;
-#endif
+    void error_set(ErrorCode code, bool active = true);
 
     /**
-     * Clears the above error flags.
+     * Returns whether the given error condition is active.
+     */
+    [[nodiscard]] bool error_active(ErrorCode code) const;
+
+    /**
+     * Clears all latched error conditions.
      */
     void error_reset();
 
@@ -246,6 +237,53 @@ private:
      */
     int32_t grams_per_day = 60;
 
+    /**
+     * Reservoir consumption forecaster.
+     */
+    Forecaster forecaster;
+
+    /**
+     * Eating session detector.
+     */
+    MealDetector meals;
+
+    /**
+     * Time-series store for weights and intake.
+     */
+    History history;
+
+    /**
+     * Compressed long-term log of weights, feeds and meals in flash.
+     */
+    WeightLog weight_log;
+
+    /**
+     * Per-phase trace of recent feed cycles.
+     */
+    FeedTrace feed_trace;
+
+    /**
+     * Value of the feed trace sequence when its summary was last published.
+     */
+    uint32_t feed_trace_sequence_published = 0;
+
+    /**
+     * Value of the meal detector sequence when the meal sensors were last
+     * published.
+     */
+    uint32_t meals_sequence_published = 0;
+
+    /**
+     * Bowl readout interval while the cat is eating, to catch the end of a
+     * meal accurately.
+     */
+    static constexpr int32_t MEAL_READ_MILLIS = 30000;
+
+    /**
+     * Warn when the reservoir is forecast to run out within this many days.
+     */
+    int32_t forecast_horizon_days = 3;
+
     /**
      * Number of milliseconds remaining before deficit is incremented.
      */
@@ -266,6 +304,13 @@ private:
      */
     unsigned long update_prev_millis = 0;
 
+    /**
+     * Limit switch and motor levels during the previous update, for
+     * reporting edges to telemetry.
+     */
+    bool prev_limit = false;
+    bool prev_motor = false;
+
     /**
      * Amount of time passed since the reservoir sensor was read.
      */
@@ -344,6 +389,12 @@ private:
      */
     FeedReport feed_report = {FeedResult::NONE, 0, 0};
 
+    /**
+     * Wait this amount of time after a feed request before doing the pre-feed
+     * load cell measurements, to let the reservoir stabilize.
+     */
+    static constexpr unsigned long FEED_PRE_MEASURE_MILLIS = 2000;
+
     /**
      * Motor takes about 2 seconds to do one cycle. If state transitions take
      * much longer than that we time out.
@@ -389,9 +440,10 @@ private:
     /**
      * Returns whether we're operating in loadcell limp mode. That is, load
      * cells aren't used; portion size is assumed. If we are in a limp mode,
-     * return value is a string representing why.
+     * return value is the error code representing why, otherwise it is
+     * ErrorCode::NONE.
      */
-    [[nodiscard]] const char *loadcell_limp_mode() const;
+    [[nodiscard]] ErrorCode loadcell_limp_mode() const;
 
     /**
      * Reasons why feeding might be blocked from the idle state.
@@ -409,6 +461,23 @@ private:
      */
     [[nodiscard]] FeedBlockReason need_to_feed() const;
 
+    /**
+     * Returns how far along we are in the current state in per mille, based
+     * on elapsed time or loadcell sample count. Used to interpolate feed
+     * progress between state transitions.
+     */
+    [[nodiscard]] int16_t state_progress() const;
+
+    /**
+     * Returns whether the given state is part of a feed cycle.
+     */
+    [[nodiscard]] static bool is_feed_state(State state);
+
+    /**
+     * Returns the FeedTrace phase index of a feed state.
+     */
+    [[nodiscard]] static size_t feed_phase(State state);
+
     /**
      * Transitions to the given state.
      */
@@ -446,7 +515,7 @@ public:
         /**
          * MQTT manager.
          */
-        HASensorNumber mqtt;
+        Paced<HASensorNumber> mqtt;
 
         /**
          * Sets the value, optionally forcing MQTT update.
@@ -494,6 +563,41 @@ public:
      */
     PublishedFloatSensor mqtt_grams_per_day{"grams_per_day_fb", "Actual grams per day", "g", "mdi:food-drumstick", 0, HABaseDeviceType::PrecisionP0};
 
+    /**
+     * Amount eaten during the most recent meal.
+     */
+    PublishedFloatSensor mqtt_last_meal{"last_meal", "Last meal", "g", "mdi:food", 0, HABaseDeviceType::PrecisionP1};
+
+    /**
+     * Intake rate of the most recent meal that was timed.
+     */
+    PublishedFloatSensor mqtt_last_meal_rate{"last_meal_rate", "Last meal rate", "g/min", "mdi:speedometer", 0, HABaseDeviceType::PrecisionP1};
+
+    /**
+     * Duration of the most recent meal that was timed.
+     */
+    PublishedFloatSensor mqtt_last_meal_duration{"last_meal_duration", "Last meal duration", "min", "mdi:timer", 0, HABaseDeviceType::PrecisionP1};
+
+    /**
+     * Amount eaten today.
+     */
+    PublishedFloatSensor mqtt_eaten_today{"eaten_today", "Eaten today", "g", "mdi:food", 0, HABaseDeviceType::PrecisionP0};
+
+    /**
+     * Amount eaten during the previous day.
+     */
+    PublishedFloatSensor mqtt_eaten_yesterday{"eaten_yesterday", "Eaten yesterday", "g", "mdi:food", 0, HABaseDeviceType::PrecisionP0};
+
+    /**
+     * Forecast number of days until the reservoir is empty.
+     */
+    PublishedFloatSensor mqtt_days_remaining{"days_remaining", "Reservoir days remaining", "d", "mdi:calendar-clock", 0, HABaseDeviceType::PrecisionP1};
+
+    /**
+     * Forecast horizon feedback.
+     */
+    PublishedFloatSensor mqtt_forecast_horizon{"forecast_horizon_fb", "Refill warning horizon", "d", "mdi:calendar-alert", 0, HABaseDeviceType::PrecisionP0};
+
     /**
      * Published binary value.
      */
@@ -509,7 +613,7 @@ public:
         /**
          * MQTT manager.
          */
-        HABinarySensor mqtt;
+        Paced<HABinarySensor> mqtt;
 
         /**
          * Sets the value, optionally forcing MQTT update.
@@ -538,41 +642,54 @@ public:
     PublishedBinarySensor mqtt_jammed{"jammed", "Jammed", "mdi:alert", 0};
 
     /**
-     * Published string value.
+     * Whether the cat is currently eating.
      */
-    template <size_t BUF_SIZE>
-    class PublishedStringSensor {
+    PublishedBinarySensor mqtt_eating{"eating", "Eating", "mdi:food", 0};
+
+    /**
+     * Published string value taken from one of the string tables. Changes
+     * are detected by comparing table indices; the text is only looked up
+     * when publishing.
+     */
+    template <class Id>
+    class PublishedTextSensor {
     private:
         friend class StateMachine;
 
         /**
          * Most recent value.
          */
-        char value[BUF_SIZE] = {0};
+        Id value = {};
+
+        /**
+         * Whether a value has been set yet.
+         */
+        bool valid = false;
 
         /**
          * MQTT manager.
          */
-        HASensor mqtt;
+        Paced<HASensor> mqtt;
 
         /**
          * Sets the value, optionally forcing MQTT update.
          */
-        void set(const char *new_value, bool force = false) {
-            if (force || strcmp(value, new_value)) {
-                snprintf(value, sizeof(value), "%s", new_value);
-                mqtt.setValue(new_value);
+        void set(const Id new_value, bool force = false) {
+            if (force || !valid || new_value != value) {
+                value = new_value;
+                valid = true;
+                if (mqtt.setValue(text(new_value))) diagnostics.mqtt_published();
             }
         }
 
     public:
-        PublishedStringSensor(const char *unique_id, const char *name, const char *icon, const int16_t expiry) : mqtt(unique_id) {
+        PublishedTextSensor(const char *unique_id, const char *name, const char *icon, const int16_t expiry) : mqtt(unique_id) {
             mqtt.setName(name);
             mqtt.setIcon(icon);
             mqtt.setExpireAfter(expiry);
         }
 
-        [[nodiscard]] const char *get() const {
+        [[nodiscard]] Id get() const {
             return value;
         }
     };
@@ -580,7 +697,28 @@ public:
     /**
      * Error message.
      */
-    PublishedStringSensor<21> mqtt_error{"error", "Error message", "mdi:alert", 0};
+    PublishedTextSensor<ErrorCode> mqtt_error{"error", "Error message", "mdi:alert", 0};
+
+    /**
+     * All active errors and warnings, highest priority first.
+     */
+    Paced<HASensor> mqtt_errors{"errors"};
+
+    /**
+     * Publishes the active error set as a comma-separated list.
+     */
+    void publish_error_set();
+
+    /**
+     * Duration of the most recent feed cycle, with the per-phase summary of
+     * the feed trace as JSON attributes.
+     */
+    Paced<HASensor> mqtt_feed_trace{"feed_trace", HASensor::JsonAttributesFeature};
+
+    /**
+     * Publishes the feed trace summary.
+     */
+    void publish_feed_trace();
 
     /**
      * Initializes the driver.
@@ -602,6 +740,11 @@ public:
      */
     [[nodiscard]] bool maintenance() const;
 
+    /**
+     * Whether a feeding cycle is in progress.
+     */
+    [[nodiscard]] bool feeding() const;
+
     /**
      * Resets to maintenance mode and tares empty feeding reservoir.
      */
@@ -644,21 +787,68 @@ public:
      */
     void set_grams_per_day(int32_t new_grams_per_day);
 
+    /**
+     * Returns the number of days before the reservoir is forecast to run out
+     * at which a warning is raised.
+     */
+    [[nodiscard]] int32_t get_forecast_horizon() const;
+
+    /**
+     * Adjusts the refill warning horizon in days.
+     */
+    void set_forecast_horizon(int32_t new_days);
+
     /**
      * Returns string representations of the current high-level state.
      */
     void get_state_report(StateReport &report) const;
 
+    /**
+     * Returns loadcell sample timing statistics.
+     */
+    [[nodiscard]] const Loadcell::Stats &get_loadcell_stats() const;
+
     /**
      * Returns information about the previous feed.
      */
     [[nodiscard]] const FeedReport &get_feed_report() const;
 
     /**
-     * Returns a string representation of the most severe error message along
-     * with a severity level. Max 20 characters. Returns a null string along
-     * with OKAY if there is no error to report.
+     * Returns the most severe error code along with a severity level.
+     * Returns ErrorCode::NONE along with OKAY if there is no error to report.
      */
     [[nodiscard]] ErrorReport get_error_report() const;
 
+    /**
+     * Returns a counter that is incremented whenever the set of active errors
+     * changes, so consumers can skip work when nothing changed.
+     */
+    [[nodiscard]] uint32_t get_error_sequence() const;
+
+    /**
+     * Returns the set of active errors as a mask of error_bit() values.
+     */
+    [[nodiscard]] uint32_t get_error_mask() const;
+
+    /**
+     * Returns the time-series store.
+     */
+    [[nodiscard]] const History &get_history() const;
+
+    /**
+     * Returns the long-term weight log.
+     */
+    [[nodiscard]] const WeightLog &get_weight_log() const;
+
+    /**
+     * Returns the feed cycle trace.
+     */
+    [[nodiscard]] const FeedTrace &get_feed_trace() const;
+
+    /**
+     * Returns the published sensor with the given index in metric. Returns
+     * false if the index is past the last sensor.
+     */
+    bool get_metric(size_t index, Metric &metric) const;
+
 };
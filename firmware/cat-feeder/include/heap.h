@@ -0,0 +1,115 @@
+#pragma once
+
+#include <Arduino.h>
+#include <hardware/sync.h>
+
+// Uncomment to panic on any heap allocation made after setup() that the
+// block pool can't serve, so its origin can be found with a debugger.
+//#define HEAP_TRAP
+
+/**
+ * Keeps the heap static once the firmware is running. Global operator new
+ * and delete are replaced: until seal() is called at the end of setup()
+ * they use the heap as usual. Afterwards, requests of up to BLOCK_SIZE
+ * bytes are served from a fixed pool of equally sized blocks, which covers
+ * the short-lived objects libraries create while running (ArduinoHA
+ * discovery serializers, LittleFS file and socket handles) and cannot
+ * fragment. Anything else still goes to the heap, but is counted as an
+ * escape along with the caller's address.
+ *
+ * Plain malloc() calls from C code (lwIP, littlefs buffers) bypass this.
+ */
+class Heap {
+public:
+    /**
+     * Size of a pool block.
+     */
+    static constexpr size_t BLOCK_SIZE = 256;
+
+    /**
+     * Number of pool blocks.
+     */
+    static constexpr size_t NUM_BLOCKS = 16;
+
+    /**
+     * Allocation counters.
+     */
+    struct Stats {
+        /**
+         * Allocations served from the pool.
+         */
+        uint32_t pool_allocations;
+
+        /**
+         * Pool blocks currently in use, and the maximum since sealing.
+         */
+        uint32_t pool_in_use;
+        uint32_t pool_peak;
+
+        /**
+         * Allocations after sealing that went to the heap.
+         */
+        uint32_t escapes;
+
+        /**
+         * Return address and size of the most recent escape.
+         */
+        uintptr_t escape_caller;
+        size_t escape_size;
+    };
+
+private:
+    /**
+     * Pool storage.
+     */
+    alignas(8) uint8_t pool[NUM_BLOCKS][BLOCK_SIZE] = {};
+
+    /**
+     * Bit i is set if block i is free.
+     */
+    uint32_t free_mask = (1ull << NUM_BLOCKS) - 1;
+
+    /**
+     * Spinlock guarding the pool, as both cores may allocate. Claimed by
+     * seal(); the pool isn't used before that.
+     */
+    spin_lock_t *lock = nullptr;
+
+    /**
+     * Counters.
+     */
+    Stats stats = {};
+
+    static_assert(NUM_BLOCKS <= 32, "free mask is 32 bits");
+
+public:
+    /**
+     * Ends the setup phase: from now on, allocations use the pool.
+     */
+    void seal();
+
+    /**
+     * Whether seal() was called.
+     */
+    [[nodiscard]] bool is_sealed() const;
+
+    /**
+     * Allocates size bytes for operator new, called from caller.
+     */
+    void *allocate(size_t size, const void *caller);
+
+    /**
+     * Frees memory for operator delete.
+     */
+    void release(void *ptr);
+
+    /**
+     * Returns a copy of the counters.
+     */
+    [[nodiscard]] Stats get_stats() const;
+};
+
+/**
+ * Global heap guard.
+ */
+extern Heap heap;
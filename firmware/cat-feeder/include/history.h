@@ -0,0 +1,278 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Fixed-memory time-series store for weights and intake. Every series keeps
+ * three tiers of min/max/mean/count buckets: one minute for two hours,
+ * fifteen minutes for two days, and one hour for thirty days. A sample is
+ * added to the open bucket of each tier directly, so adding is constant
+ * time, and closing a bucket is a single ring write per series.
+ *
+ * The flash mirror is a snapshot of all closed buckets plus a journal to
+ * which each save appends only the buckets closed since the previous one.
+ * Once the journal is large, it is folded into a new snapshot. Both carry a
+ * generation number, so a journal left behind by a power loss during that
+ * is never applied to the snapshot that already contains it.
+ */
+class History {
+public:
+    /**
+     * Recorded series.
+     */
+    enum class Series : uint8_t {
+        RESERVOIR,
+        BOWL,
+        INTAKE,
+        COUNT
+    };
+
+    /**
+     * A closed bucket. Values are in the unit of the series (see
+     * UNITS_PER_GRAM); a bucket without samples has count 0 and all values
+     * 0.
+     */
+    struct Bucket {
+        int16_t min;
+        int16_t max;
+        int16_t mean;
+        uint16_t count;
+    };
+
+    /**
+     * Number of tiers.
+     */
+    static constexpr size_t TIERS = 3;
+
+    /**
+     * Bucket period per tier.
+     */
+    static constexpr uint32_t PERIOD_MILLIS[TIERS] = {60000, 900000, 3600000};
+
+    /**
+     * Number of buckets per tier.
+     */
+    static constexpr size_t LENGTH[TIERS] = {120, 192, 720};
+
+    /**
+     * Offset of each tier in the bucket storage of a series.
+     */
+    static constexpr size_t OFFSET[TIERS] = {0, LENGTH[0], LENGTH[0] + LENGTH[1]};
+
+    /**
+     * Number of buckets per series.
+     */
+    static constexpr size_t BUCKETS = LENGTH[0] + LENGTH[1] + LENGTH[2];
+
+    /**
+     * Number of series.
+     */
+    static constexpr size_t SERIES = static_cast<size_t>(Series::COUNT);
+
+    /**
+     * Resolution of the stored values per series. The reservoir holds more
+     * than 16 bits of decigrams, so it is stored in grams; the bowl and
+     * intake are stored in decigrams.
+     */
+    static constexpr int32_t UNITS_PER_GRAM[SERIES] = {1, 10, 10};
+
+    /**
+     * RAM budget for the bucket storage.
+     */
+    static constexpr size_t BUDGET_BYTES = 32 * 1024;
+
+private:
+    /**
+     * Open bucket being accumulated.
+     */
+    struct Accumulator {
+        int16_t min;
+        int16_t max;
+        int32_t sum;
+        uint16_t count;
+    };
+
+    /**
+     * Header of the snapshot, to reject files from a different layout.
+     */
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t size;
+        uint32_t generation;
+    };
+
+    /**
+     * Header of the journal.
+     */
+    struct JournalHeader {
+        uint32_t magic;
+        uint32_t generation;
+    };
+
+    /**
+     * Journal entry: a bucket closed in the given tier, for all series.
+     */
+    struct JournalEntry {
+        uint8_t tier;
+        uint8_t reserved;
+        Bucket buckets[SERIES];
+    };
+    static_assert(sizeof(JournalEntry) == 2 + sizeof(Bucket) * SERIES, "journal entry layout changed");
+
+    /**
+     * Snapshot file name.
+     */
+    static constexpr const char *FILE_NAME = "/history.bin";
+
+    /**
+     * Temporary file name used while writing the snapshot.
+     */
+    static constexpr const char *FILE_NAME_TEMP = "/history.tmp";
+
+    /**
+     * Journal file name.
+     */
+    static constexpr const char *FILE_NAME_JOURNAL = "/history.log";
+
+    /**
+     * Magic number of the snapshot.
+     */
+    static constexpr uint32_t FILE_MAGIC = 0x48535432;
+
+    /**
+     * Magic number of the journal.
+     */
+    static constexpr uint32_t JOURNAL_MAGIC = 0x484A4E31;
+
+    /**
+     * Journal size above which the next save writes a new snapshot. An
+     * hour of closed buckets takes about 1.7kB.
+     */
+    static constexpr size_t MAX_JOURNAL_BYTES = 16 * 1024;
+
+    /**
+     * Closed buckets, per series, tiers laid out back to back.
+     */
+    Bucket buckets[SERIES][BUCKETS] = {};
+    static_assert(sizeof(Bucket) == 8, "bucket layout changed");
+
+    /**
+     * Index within its tier of the next bucket to write.
+     */
+    uint16_t heads[TIERS] = {};
+
+    /**
+     * Number of closed buckets per tier.
+     */
+    uint16_t counts[TIERS] = {};
+
+    /**
+     * Open buckets per series and tier.
+     */
+    Accumulator open[SERIES][TIERS] = {};
+
+    /**
+     * Time elapsed in the open bucket of each tier.
+     */
+    uint32_t open_millis[TIERS] = {};
+
+    /**
+     * Whether the slowest tier closed a bucket since the last save.
+     */
+    bool save_due = false;
+
+    /**
+     * Number of buckets per tier closed since the last save.
+     */
+    uint16_t unsaved[TIERS] = {};
+
+    /**
+     * Generation of the snapshot; the journal belongs to it.
+     */
+    uint32_t generation = 0;
+
+    /**
+     * Size of the journal file, 0 if there is none.
+     */
+    size_t journal_size = 0;
+
+    /**
+     * Closes the open bucket of the given tier for all series.
+     */
+    void close(size_t tier);
+
+    /**
+     * Stores a closed bucket for all series in the ring of a tier.
+     */
+    void push(size_t tier, const Bucket (&closed)[SERIES]);
+
+    /**
+     * Appends the buckets closed since the last save to the journal.
+     */
+    bool append_journal();
+
+    /**
+     * Writes all closed buckets to a new snapshot and drops the journal.
+     */
+    bool write_snapshot();
+
+    /**
+     * Applies the journal of the current generation, if any.
+     */
+    void replay_journal();
+
+public:
+    /**
+     * Adds a sample to a series.
+     */
+    void add(Series series, float grams);
+
+    /**
+     * Advances the bucket clocks, closing buckets as their periods end.
+     */
+    void update(int32_t delta_millis);
+
+    /**
+     * Converts a stored value of a series to grams.
+     */
+    [[nodiscard]] static float to_grams(Series series, int16_t value);
+
+    /**
+     * Returns the number of closed buckets in a tier.
+     */
+    [[nodiscard]] size_t get_count(size_t tier) const;
+
+    /**
+     * Returns a closed bucket; age 0 is the most recent one. Only valid for
+     * ages below get_count(tier).
+     */
+    [[nodiscard]] const Bucket &get(Series series, size_t tier, size_t age) const;
+
+    /**
+     * Returns whether the flash mirror is out of date by at least one bucket
+     * of the slowest tier.
+     */
+    [[nodiscard]] bool is_save_due() const;
+
+    /**
+     * Writes the buckets closed since the last save to flash, or a new
+     * snapshot once the journal is large. The filesystem must be mounted.
+     * Call it when nothing time-critical is going on.
+     */
+    bool save();
+
+    /**
+     * Restores the closed buckets from flash, if a valid snapshot or
+     * journal exists. The time between the save and the restore is not
+     * represented.
+     */
+    bool load();
+
+    /**
+     * Prints a tier of a series, oldest bucket first, one bucket per line:
+     * age in minutes, min, max, mean and sample count.
+     */
+    void print(Print &out, Series series, size_t tier) const;
+};
+
+static_assert(sizeof(History::Bucket) * History::SERIES * History::BUCKETS <= History::BUDGET_BYTES, "history exceeds its RAM budget");
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Comment out to leave the functions marked HOT in flash, executing
+// through the XIP cache like everything else. Compare both builds with the
+// "bench hot" serial command.
+#define HOT_IN_RAM
+
+/**
+ * Marks a timing-critical function definition for placement in SRAM, so it
+ * never stalls on XIP cache misses caused by WiFi or display code evicting
+ * it. Use as void HOT(Class::function)(...).
+ */
+#ifdef HOT_IN_RAM
+#define HOT(name) __not_in_flash_func(name)
+#else
+#define HOT(name) name
+#endif
+
+/**
+ * Measures the execution time of hot functions under real load. Every
+ * other main loop iteration, the XIP cache is flushed first, so the cold
+ * iterations show the worst case of code that lives in flash and the warm
+ * ones the best case.
+ */
+class HotBench {
+public:
+    /**
+     * Measured call sites.
+     */
+    enum class Probe : uint8_t {
+        /**
+         * StateMachine::update(), including limit switch handling.
+         */
+        FSM_UPDATE,
+
+        /**
+         * Loadcell::update().
+         */
+        LOADCELL_UPDATE,
+
+        /**
+         * Statistics over one loadcell window. Only runs when a window
+         * completes, so run the benchmark in maintenance mode, where the
+         * loadcells are read continuously.
+         */
+        LOADCELL_STATISTICS,
+
+        COUNT,
+    };
+
+private:
+    /**
+     * Number of main loop iterations measured per run.
+     */
+    static constexpr uint32_t ITERATIONS = 2000;
+
+    /**
+     * Execution time range of one probe.
+     */
+    struct Range {
+        uint32_t min_micros;
+        uint32_t max_micros;
+        uint32_t count;
+    };
+
+    /**
+     * Ranges per cache state (0 = warm, 1 = cold) and probe.
+     */
+    Range ranges[2][static_cast<size_t>(Probe::COUNT)] = {};
+
+    /**
+     * Iterations left in the current run, 0 if idle.
+     */
+    uint32_t remaining = 0;
+
+    /**
+     * Whether the current iteration started with a flushed cache.
+     */
+    bool cold = false;
+
+    /**
+     * Whether a finished run has yet to be reported.
+     */
+    bool unreported = false;
+
+public:
+    /**
+     * Starts a run.
+     */
+    void start();
+
+    /**
+     * Marks the start of a main loop iteration; flushes the XIP cache on
+     * cold iterations.
+     */
+    void mark();
+
+    /**
+     * Returns a start timestamp for a probed call.
+     */
+    [[nodiscard]] uint32_t enter() const {
+        return remaining ? micros() : 0;
+    }
+
+    /**
+     * Records a probed call that started at the given timestamp.
+     */
+    void leave(Probe probe, uint32_t start_micros);
+
+    /**
+     * Prints the results once a run completes. Returns whether it did.
+     */
+    bool report(Print &out);
+};
+
+/**
+ * Global hot path benchmark.
+ */
+extern HotBench hot_bench;
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "format.h"
+
+/**
+ * One request/response exchange of a minimal HTTP/1.0 server, kept free of
+ * socket access so it can be tested on the host. Request bytes are fed in
+ * one at a time until the end of the headers; the response is then
+ * generated item by item into a fixed buffer that the caller sends and
+ * consumes. Only GET requests for a single path are answered with 200,
+ * everything else with 404.
+ */
+class HttpExchange {
+public:
+    /**
+     * Size of the response buffer.
+     */
+    static constexpr size_t BUFFER_SIZE = 512;
+
+    /**
+     * Response body, generated in sections of items.
+     */
+    class Body {
+    public:
+        /**
+         * Writes the given item of the given section into f. Returns false
+         * if the section has no more items.
+         */
+        virtual bool render(Formatter &f, uint8_t section, size_t item) const = 0;
+
+    protected:
+        ~Body() = default;
+    };
+
+private:
+    /**
+     * Path that is served.
+     */
+    const char *const path;
+
+    /**
+     * Content type of the body.
+     */
+    const char *const content_type;
+
+    /**
+     * Body generator.
+     */
+    const Body &body;
+
+    /**
+     * Number of body sections.
+     */
+    const uint8_t sections;
+
+    /**
+     * Start of the request line, enough to recognize the path.
+     */
+    char request[24] = {0};
+
+    /**
+     * Number of request characters received.
+     */
+    size_t request_length = 0;
+
+    /**
+     * Length of the current run of line terminator characters, to detect
+     * the end of the request headers.
+     */
+    uint8_t terminator_run = 0;
+
+    /**
+     * Whether the request was for the served path.
+     */
+    bool found = false;
+
+    /**
+     * Whether the status line and headers have been generated.
+     */
+    bool header_done = false;
+
+    /**
+     * Body section and item within the section to generate next; section
+     * equals sections once the response is complete.
+     */
+    uint8_t section = 0;
+    size_t item = 0;
+
+    /**
+     * Response bytes waiting to be sent.
+     */
+    char buffer[BUFFER_SIZE] = {0};
+
+    /**
+     * Number of bytes in buffer.
+     */
+    size_t buffer_length = 0;
+
+    /**
+     * Writes the status line and headers into f.
+     */
+    void render_header(Formatter &f) const;
+
+public:
+    HttpExchange(const char *path, const char *content_type, const Body &body, uint8_t sections);
+
+    /**
+     * Prepares for a new connection.
+     */
+    void reset();
+
+    /**
+     * Takes one request byte. Returns true once the request headers are
+     * complete, after which the response can be generated.
+     */
+    bool receive(char c);
+
+    /**
+     * Returns whether the request was for the served path.
+     */
+    [[nodiscard]] bool is_found() const;
+
+    /**
+     * Fills the buffer with as many whole items as fit, if it is empty.
+     * Returns the number of bytes to send, which is 0 once the response is
+     * complete.
+     */
+    size_t fill();
+
+    /**
+     * Returns the bytes to send.
+     */
+    [[nodiscard]] const uint8_t *get_buffer() const;
+
+    /**
+     * Marks the buffer as sent.
+     */
+    void consume();
+};
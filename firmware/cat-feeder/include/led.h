@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <pico/time.h>
+#include "sequence.h"
+
+/**
+ * Front panel status LED. Patterns are played back from a repeating timer
+ * interrupt driving the hardware PWM, so the main loops only need to do
+ * something when the pattern changes.
+ */
+class StatusLed {
+public:
+    /**
+     * Pattern shapes.
+     */
+    using Pattern = LedPattern;
+
+private:
+    /**
+     * Duration of a pattern step.
+     */
+    static constexpr int32_t STEP_MILLIS = 50;
+
+    /**
+     * PWM counter wrap value; brightness levels are squared into this range
+     * for a rough gamma correction.
+     */
+    static constexpr uint16_t PWM_WRAP = 255 * 255;
+
+    /**
+     * Timer driving the pattern.
+     */
+    repeating_timer timer = {};
+
+    /**
+     * Requested pattern in the low byte and flash count in the high byte,
+     * packed so it can be updated atomically.
+     */
+    std::atomic<uint16_t> setting{0};
+
+    /**
+     * Pattern playback state, advanced by the timer.
+     */
+    LedSequence sequence;
+
+    /**
+     * Timer callback.
+     */
+    static bool on_timer(repeating_timer *t);
+
+public:
+    /**
+     * Configures the PWM and starts the timer.
+     */
+    void begin();
+
+    /**
+     * Selects the pattern to play. Count is only used for FLASH. Playback
+     * restarts from the beginning if the pattern differs from the current
+     * one. May be called from either core.
+     */
+    void set(Pattern pattern, uint8_t count = 0);
+};
@@ -2,67 +2,149 @@
 
 #include <Arduino.h>
 #include <HX711.h>
+#include <algorithm>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include "hot.h"
+#include "statistics.h"
+#include "trace.h"
 
 /**
- * Loadcell/HX711 management class.
+ * Loadcells of the feeder, in the order of the channel descriptors of the
+ * Loadcell alias below.
  */
-class Loadcell {
+enum class LoadcellSensor : uint8_t {
+    RESERVOIR,
+    BOWL,
+};
+
+/**
+ * Channel descriptor for the reservoir loadcell.
+ */
+struct ReservoirChannel {
+    /**
+     * HX711 gain; 128 and 64 select input A, 32 selects input B.
+     */
+    static constexpr uint8_t HX711_GAIN = 128;
+
+    /**
+     * Gain to go from raw HX711 value to grams.
+     */
+    static constexpr float GRAMS_PER_COUNT = -0.0020530327830519573f;
+
+    /**
+     * Number of samples to average, as a power of two.
+     */
+    static constexpr uint8_t WINDOW_LOG2 = 5;
+};
+
+/**
+ * Channel descriptor for the bowl loadcell.
+ */
+struct BowlChannel {
+    /**
+     * HX711 gain; 128 and 64 select input A, 32 selects input B.
+     */
+    static constexpr uint8_t HX711_GAIN = 32;
+
+    /**
+     * Gain to go from raw HX711 value to grams.
+     */
+    static constexpr float GRAMS_PER_COUNT = 0.003227106961589246f;
+
+    /**
+     * Number of samples to average, as a power of two.
+     */
+    static constexpr uint8_t WINDOW_LOG2 = 5;
+};
+
+/**
+ * Channel-independent part of the loadcell driver: the HX711, sample
+ * timing and the most recent result.
+ */
+class LoadcellBase {
 public:
-    enum class Sensor {
-        RESERVOIR,
-        BOWL,
+    /**
+     * Maximum number of channels.
+     */
+    static constexpr size_t MAX_CHANNELS = 2;
+
+    /**
+     * Sample timing statistics since boot.
+     */
+    struct Stats {
+        /**
+         * Number of samples taken per sensor.
+         */
+        uint32_t samples[MAX_CHANNELS];
+
+        /**
+         * Total time spent waiting for those samples per sensor.
+         */
+        uint32_t busy_micros[MAX_CHANNELS];
+
+        /**
+         * Estimated number of conversions that were missed because the main
+         * loop did not poll the HX711 in time.
+         */
+        uint32_t dropped;
     };
 
-private:
+protected:
     /**
      * Underlying driver.
      */
     HX711 hx711;
 
     /**
-     * Number of samples to average.
+     * Number of averaging samples remaining.
      */
-    static constexpr size_t NUM_SAMPLES = 32;
+    size_t samples_remaining = 0;
 
     /**
-     * Gain to go from raw HX711 reservoir value to grams.
+     * Number of samples in the current measurement.
      */
-    static constexpr float GAIN_RESERVOIR = -0.0020530327830519573f;
+    size_t window = 1;
 
     /**
-     * Gain to go from raw HX711 bowl value to grams.
+     * The channel we're measuring.
      */
-    static constexpr float GAIN_BOWL = 0.003227106961589246f;
+    size_t channel = 0;
 
     /**
-     * Number of averaging samples remaining.
+     * Whether this measurement is a taring operation.
      */
-    int samples_remaining = 0;
+    bool apply_tare = false;
 
     /**
-     * The sensor we're measuring.
+     * Whether the next conversion must be discarded. The HX711 applies a
+     * new channel and gain only to the conversion after the one read out
+     * with them, so the first one after start() belongs to the previous
+     * setting.
      */
-    Sensor sensor = Sensor::RESERVOIR;
+    bool discard_next = false;
 
     /**
-     * Whether this measurement is a taring operation.
+     * Raw tare value per channel.
      */
-    bool apply_tare = false;
+    int32_t tares[MAX_CHANNELS];
 
     /**
-     * List of samples.
+     * Sample timing statistics.
      */
-    int32_t samples[NUM_SAMPLES] = {};
+    Stats stats = {};
 
     /**
-     * Raw tare value for reservoir sensor.
+     * Time at which the previous sample was taken.
      */
-    int32_t tare_reservoir = std::numeric_limits<int32_t>::min();
+    uint32_t prev_sample_micros = 0;
 
     /**
-     * Raw tare value for bowl sensor.
+     * Shortest interval observed between samples, taken to be the HX711
+     * conversion period.
      */
-    int32_t tare_bowl = std::numeric_limits<int32_t>::min();
+    uint32_t min_interval_micros = std::numeric_limits<uint32_t>::max();
 
     /**
      * Most recently measured mean.
@@ -79,28 +161,43 @@ private:
      */
     int32_t mean_raw = 0;
 
-public:
     /**
-     * Initialize the driver.
+     * Constructor.
      */
-    void begin();
+    LoadcellBase();
 
     /**
-     * Start averaging loadcell data for the given loadcell. Any
-     * previously-started measurement is stopped.
+     * Starts a measurement of window samples on the given channel.
      */
-    void start(Sensor sensor, bool tare = false);
+    void begin_measurement(size_t target_channel, uint8_t gain, size_t target_window, bool tare);
 
     /**
-     * Updates state machine from main loop.
+     * Reads a sample if the HX711 has one, returning whether it did. Keeps
+     * track of sample timing and counts the sample off the window.
      */
-    void update();
+    bool poll_sample(int32_t &raw);
+
+    /**
+     * Stores the result of a measurement and logs it.
+     */
+    void finish_measurement(int32_t raw_mean, float variance, float grams_per_count);
+
+public:
+    /**
+     * Initialize the driver. Doesn't wait for the HX711.
+     */
+    void begin();
 
     /**
      * Returns whether the loadcell readout logic is currently busy.
      */
     [[nodiscard]] bool is_busy() const;
 
+    /**
+     * Returns the progress of the current measurement in per mille.
+     */
+    [[nodiscard]] int16_t get_progress() const;
+
     /**
      * Returns mean in grams.
      */
@@ -112,18 +209,121 @@ public:
     [[nodiscard]] float get_stddev() const;
 
     /**
-     * Returns which sensor was most recently read.
+     * Returns mean in raw measurement units.
      */
-    [[nodiscard]] Sensor get_sensor() const;
+    [[nodiscard]] int32_t get_mean_raw() const;
 
     /**
-     * Returns mean in raw measurement units.
+     * Returns sample timing statistics.
      */
-    [[nodiscard]] int32_t get_mean_raw() const;
+    [[nodiscard]] const Stats &get_stats() const;
+};
+
+/**
+ * Loadcell/HX711 management class, specialized at compile time for a list
+ * of channel descriptors (HX711_GAIN, GRAMS_PER_COUNT, WINDOW_LOG2) and a
+ * statistics policy. The sensor passed at runtime is mapped once per
+ * measurement onto the code for its channel, in which gain, calibration
+ * and window size are constants.
+ */
+template<class SensorId, class Statistics, class... Channels>
+class BasicLoadcell : public LoadcellBase {
+    static_assert(sizeof...(Channels) >= 1 && sizeof...(Channels) <= MAX_CHANNELS, "unsupported number of channels");
 
+public:
     /**
-     * Sets the tare value for the given sensor.
+     * Sensor identifiers, numbered in channel order.
+     */
+    using Sensor = SensorId;
+
+private:
+    /**
+     * Channel descriptor by index.
+     */
+    template<size_t I>
+    using ChannelAt = std::tuple_element_t<I, std::tuple<Channels...>>;
+
+    /**
+     * Largest window over all channels.
+     */
+    static constexpr size_t MAX_WINDOW = std::max({size_t(1) << Channels::WINDOW_LOG2...});
+
+    /**
+     * List of samples.
+     */
+    int32_t samples[MAX_WINDOW] = {};
+
+    /**
+     * Calls f with the index of the given channel as a compile-time
+     * constant.
+     */
+    template<size_t I = 0, class F>
+    static void dispatch(const size_t index, F &&f) {
+        if constexpr (I < sizeof...(Channels)) {
+            if (index == I) {
+                f(std::integral_constant<size_t, I>());
+            } else {
+                dispatch<I + 1>(index, f);
+            }
+        }
+    }
+
+    /**
+     * Computes the result of a completed measurement on channel I.
+     */
+    template<size_t I>
+    void finish() {
+        using Channel = ChannelAt<I>;
+        int32_t raw_mean = 0;
+        float variance = 0.0f;
+        const uint32_t start_micros = hot_bench.enter();
+        Statistics::template compute<Channel::WINDOW_LOG2>(samples, raw_mean, variance);
+        hot_bench.leave(HotBench::Probe::LOADCELL_STATISTICS, start_micros);
+        finish_measurement(raw_mean, variance, Channel::GRAMS_PER_COUNT);
+    }
+
+public:
+    /**
+     * Start averaging loadcell data for the given loadcell. Any
+     * previously-started measurement is stopped. Doesn't wait for the
+     * HX711; the conversions are picked up by update().
+     */
+    void start(const Sensor sensor, const bool tare = false) {
+        const auto index = static_cast<size_t>(sensor);
+        dispatch(index, [&](auto i) {
+            using Channel = ChannelAt<decltype(i)::value>;
+            begin_measurement(index, Channel::HX711_GAIN, size_t(1) << Channel::WINDOW_LOG2, tare);
+        });
+    }
+
+    /**
+     * Updates state machine from main loop.
+     */
+    void HOT(update)() {
+        const Trace::Span span(Trace::Scope::LOADCELL_UPDATE);
+        int32_t raw = 0;
+        if (!poll_sample(raw)) return;
+        samples[samples_remaining] = raw;
+        if (samples_remaining) return;
+        dispatch(channel, [this](auto i) { finish<decltype(i)::value>(); });
+    }
+
+    /**
+     * Returns which sensor was most recently read.
      */
-    void set_tare_raw(Sensor sensor, int32_t raw);
+    [[nodiscard]] Sensor get_sensor() const {
+        return static_cast<Sensor>(channel);
+    }
 
+    /**
+     * Sets the tare value for the given sensor.
+     */
+    void set_tare_raw(const Sensor sensor, const int32_t raw) {
+        tares[static_cast<size_t>(sensor)] = raw;
+    }
 };
+
+/**
+ * The feeder's reservoir and bowl loadcells.
+ */
+using Loadcell = BasicLoadcell<LoadcellSensor, MeanVariance, ReservoirChannel, BowlChannel>;
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * Single-producer, single-consumer mailbox holding the most recently posted
+ * value, for passing snapshots between the two cores. Implemented as a
+ * sequence lock: the producer never waits, and the consumer retries its copy
+ * in the rare case that it raced with the producer. T must be trivially
+ * copyable.
+ */
+template <class T>
+class Mailbox {
+private:
+    /**
+     * Sequence number. Odd while the producer is writing; incremented by
+     * two for every posted value.
+     */
+    std::atomic<uint32_t> sequence{0};
+
+    /**
+     * The value.
+     */
+    T value = {};
+
+public:
+    /**
+     * Posts a new value, replacing any value that wasn't fetched yet. May
+     * only be called from the producer.
+     */
+    void post(const T &new_value) {
+        const uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        value = new_value;
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * Copies the most recent value into out if it differs from the one
+     * identified by seen, which is then updated. Returns whether a new value
+     * was copied. May only be called from the consumer; seen should be
+     * initialized to 0.
+     */
+    bool fetch(T &out, uint32_t &seen) {
+        for (;;) {
+            const uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before == seen) return false;
+            if (before & 1) continue;
+            out = value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                seen = before;
+                return true;
+            }
+        }
+    }
+};
+
+/**
+ * Single-producer, single-consumer lock-free FIFO for passing events between
+ * the two cores. N must be a power of two.
+ */
+template <class T, size_t N>
+class Queue {
+private:
+    static_assert((N & (N - 1)) == 0, "queue size must be a power of two");
+
+    /**
+     * Ring buffer.
+     */
+    T items[N] = {};
+
+    /**
+     * Number of items pushed so far; only written by the producer.
+     */
+    std::atomic<uint32_t> head{0};
+
+    /**
+     * Number of items popped so far; only written by the consumer.
+     */
+    std::atomic<uint32_t> tail{0};
+
+public:
+    /**
+     * Pushes an item. Returns false and drops it if the queue is full.
+     */
+    bool push(const T &item) {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N) return false;
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Pops an item. Returns false if the queue is empty.
+     */
+    bool pop(T &item) {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        item = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+};
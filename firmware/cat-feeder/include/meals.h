@@ -0,0 +1,195 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Streaming detector for eating sessions, fed with bowl readouts. A meal
+ * starts when the bowl reading becomes disturbed (the cat is at the bowl)
+ * and ends at the next stable reading; the weight lost relative to the last
+ * stable reading before it is what was eaten. A drop between two stable
+ * readings is recorded as a meal as well, since a short meal can fall in
+ * between readouts, but without a duration: only a session bracketed by
+ * disturbed readings has a meaningful duration and rate. Increases (feeds,
+ * refills) only move the baseline.
+ */
+class MealDetector {
+public:
+    /**
+     * A completed eating session.
+     */
+    struct Meal {
+        /**
+         * millis() at the start of the session.
+         */
+        uint32_t start_millis;
+
+        /**
+         * Length of the session, from the first disturbed reading to the
+         * next stable one; 0 if not timed.
+         */
+        uint32_t duration_millis;
+
+        /**
+         * Amount eaten.
+         */
+        float grams;
+
+        /**
+         * Whether the session was seen in disturbed readings. If not, it
+         * happened somewhere between two stable readings, start_millis is
+         * the first of those and the duration is unknown.
+         */
+        bool timed;
+
+        /**
+         * Returns the intake rate in grams per minute, or 0 if not timed.
+         */
+        [[nodiscard]] float rate() const;
+    };
+
+    /**
+     * Number of meals kept.
+     */
+    static constexpr size_t MEALS = 16;
+
+    /**
+     * Bowl standard deviation above which the bowl is considered disturbed.
+     */
+    static constexpr float DISTURBED_STDDEV = 2.0f;
+
+    /**
+     * Minimum weight drop that is counted as a meal.
+     */
+    static constexpr float MIN_MEAL_GRAMS = 2.0f;
+
+private:
+    /**
+     * Length of a day for the daily totals.
+     */
+    static constexpr int32_t DAY_MILLIS = 86400000;
+
+    /**
+     * Ring of completed meals, newest at index (head + MEALS - 1) % MEALS.
+     */
+    Meal meals[MEALS] = {};
+
+    /**
+     * Index of the next meal to write.
+     */
+    size_t head = 0;
+
+    /**
+     * Number of valid meals in the ring.
+     */
+    size_t count = 0;
+
+    /**
+     * Incremented for every recorded meal.
+     */
+    uint32_t sequence = 0;
+
+    /**
+     * Whether a stable baseline reading has been seen.
+     */
+    bool baseline_valid = false;
+
+    /**
+     * Bowl weight at the last stable reading.
+     */
+    float baseline = 0.0f;
+
+    /**
+     * millis() at the last stable reading.
+     */
+    uint32_t baseline_millis = 0;
+
+    /**
+     * Whether a session is in progress.
+     */
+    bool eating = false;
+
+    /**
+     * millis() at the first disturbed reading of the current session.
+     */
+    uint32_t eating_millis = 0;
+
+    /**
+     * Amount eaten today.
+     */
+    float today = 0.0f;
+
+    /**
+     * Amount eaten during the previous day.
+     */
+    float yesterday = 0.0f;
+
+    /**
+     * Time elapsed in the current day.
+     */
+    int32_t millis_in_day = 0;
+
+    /**
+     * Records a meal if enough was eaten.
+     */
+    void record(uint32_t start, uint32_t end, float grams, bool timed);
+
+public:
+    /**
+     * Processes a bowl readout taken at the given time.
+     */
+    void sample(float mean, float stddev, uint32_t now);
+
+    /**
+     * Forgets the baseline, for when the bowl reading changes for reasons
+     * other than eating (taring).
+     */
+    void reset_baseline();
+
+    /**
+     * Informs the detector that the given amount was dispensed into the
+     * bowl, so it is not mistaken for a change in consumption.
+     */
+    void dispensed(float grams);
+
+    /**
+     * Advances the day clock for the daily totals.
+     */
+    void update(int32_t delta_millis);
+
+    /**
+     * Returns whether an eating session is in progress.
+     */
+    [[nodiscard]] bool is_eating() const;
+
+    /**
+     * Returns the number of meals in the ring.
+     */
+    [[nodiscard]] size_t get_count() const;
+
+    /**
+     * Returns a recorded meal; age 0 is the most recent one. Only valid for
+     * ages below get_count().
+     */
+    [[nodiscard]] const Meal &get_meal(size_t age) const;
+
+    /**
+     * Returns the most recent timed meal, or nullptr if there is none in
+     * the ring.
+     */
+    [[nodiscard]] const Meal *get_last_timed() const;
+
+    /**
+     * Returns a counter that is incremented for every recorded meal.
+     */
+    [[nodiscard]] uint32_t get_sequence() const;
+
+    /**
+     * Returns the amount eaten today.
+     */
+    [[nodiscard]] float get_today() const;
+
+    /**
+     * Returns the amount eaten during the previous day.
+     */
+    [[nodiscard]] float get_yesterday() const;
+};
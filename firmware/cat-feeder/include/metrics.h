@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "format.h"
+#include "fsm.h"
+#include "http.h"
+
+/**
+ * Minimal HTTP server exposing /metrics in the Prometheus text format:
+ * published sensors, error bits, the main loop duration histogram and
+ * sample/MQTT counters. Serves one connection at a time and does one step
+ * of work per poll() (accepting, reading the request, or sending one
+ * buffer), so it never holds up the main loop. The HTTP exchange generates
+ * the response item by item into a fixed buffer; nothing is allocated.
+ */
+class MetricsServer : public HttpExchange::Body {
+private:
+    /**
+     * TCP port.
+     */
+    static constexpr uint16_t PORT = 80;
+
+    /**
+     * Time after which an unfinished connection is dropped.
+     */
+    static constexpr uint32_t TIMEOUT_MILLIS = 2000;
+
+    /**
+     * Connection phases.
+     */
+    enum class Phase : uint8_t {
+        IDLE,
+        REQUEST,
+        RESPONSE,
+    };
+
+    /**
+     * Body sections, generated in order.
+     */
+    enum class Section : uint8_t {
+        SENSORS,
+        ERRORS,
+        LOOP_HISTOGRAM,
+        COUNTERS,
+        COUNT,
+    };
+
+    /**
+     * State machine providing the values.
+     */
+    const StateMachine &fsm;
+
+    /**
+     * Listening socket.
+     */
+    WiFiServer server{PORT};
+
+    /**
+     * Connection being served.
+     */
+    WiFiClient client;
+
+    /**
+     * Current connection phase.
+     */
+    Phase phase = Phase::IDLE;
+
+    /**
+     * millis() at which the connection was accepted.
+     */
+    uint32_t accept_millis = 0;
+
+    /**
+     * Request parsing and response generation.
+     */
+    HttpExchange exchange{"/metrics", "text/plain; version=0.0.4", *this, static_cast<uint8_t>(Section::COUNT)};
+
+    /**
+     * Reads request bytes, returning true once the headers are complete.
+     */
+    bool read_request();
+
+    /**
+     * Closes the connection.
+     */
+    void close();
+
+public:
+    explicit MetricsServer(const StateMachine &fsm);
+
+    /**
+     * Starts listening.
+     */
+    void begin();
+
+    /**
+     * Does one step of work.
+     */
+    void poll();
+
+    bool render(Formatter &f, uint8_t section, size_t item) const override;
+};
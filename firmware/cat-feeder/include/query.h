@@ -0,0 +1,163 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoHA.h>
+#include <optional>
+#include "weightlog.h"
+
+/**
+ * Request/response access to the weight log over MQTT. A request is a
+ * message on REQUEST_TOPIC with the space-separated decimal fields
+ *
+ *     <id> <from> <to> <resolution>
+ *
+ * where from and to are an inclusive UNIX time range and resolution is a
+ * bucket size in seconds (0 for raw records); trailing fields may be
+ * omitted. The matching records are streamed back on RESPONSE_TOPIC as JSON
+ * chunks of the form
+ *
+ *     {"id":1,"seq":0,"r":[[time,type,grams],...],"done":0}
+ *
+ * where type is the WeightLog::Type index; downsampled records carry the
+ * bucket start time and the mean value. The last chunk has "done":1 and
+ * the total record count in "n". A new request aborts the one in progress.
+ * The response covers the log as it was when the request arrived; if the
+ * log files rotate before it is complete, the last chunk also carries
+ * "aborted":1 and the request should be repeated.
+ *
+ * Work is paced from poll(): each call decodes at most DECODE_BUDGET log
+ * records and publishes at most one chunk of at most CHUNK_SIZE bytes, so
+ * a large query never holds up the main loop.
+ */
+class HistoryQuery {
+public:
+    /**
+     * Topic on which requests are received.
+     */
+    static constexpr const char *REQUEST_TOPIC = "cat-feeder/history/request";
+
+    /**
+     * Topic on which responses are published.
+     */
+    static constexpr const char *RESPONSE_TOPIC = "cat-feeder/history/response";
+
+    /**
+     * Maximum size of the record list in a single chunk.
+     */
+    static constexpr size_t CHUNK_SIZE = 512;
+
+    /**
+     * Maximum number of log records decoded per poll.
+     */
+    static constexpr size_t DECODE_BUDGET = 256;
+
+private:
+    /**
+     * Downsampling bucket for one record type.
+     */
+    struct Accumulator {
+        uint32_t start;
+        int32_t sum;
+        uint16_t count;
+    };
+
+    /**
+     * MQTT client.
+     */
+    HAMqtt &mqtt;
+
+    /**
+     * Log being queried.
+     */
+    const WeightLog &log;
+
+    /**
+     * Reader for the query in progress; empty if there is none.
+     */
+    std::optional<WeightLog::Reader> reader;
+
+    /**
+     * Request parameters.
+     */
+    uint32_t id = 0;
+    uint32_t from = 0;
+    uint32_t to = 0;
+    uint32_t resolution = 0;
+
+    /**
+     * Downsampling state per record type.
+     */
+    Accumulator accumulators[static_cast<size_t>(WeightLog::Type::COUNT)] = {};
+
+    /**
+     * Whether the reader is exhausted and the accumulators have been
+     * flushed.
+     */
+    bool exhausted = false;
+
+    /**
+     * Record produced but not yet added to a chunk.
+     */
+    WeightLog::Record pending = {};
+
+    /**
+     * Whether pending is valid.
+     */
+    bool pending_valid = false;
+
+    /**
+     * Records of the chunk being built, without the surrounding JSON.
+     */
+    char records[CHUNK_SIZE] = {0};
+
+    /**
+     * Length of records.
+     */
+    size_t records_length = 0;
+
+    /**
+     * Sequence number of the next chunk.
+     */
+    uint16_t sequence = 0;
+
+    /**
+     * Number of records sent so far.
+     */
+    uint32_t sent = 0;
+
+    /**
+     * Produces the next output record, decoding and downsampling log
+     * records within the given budget. Returns false if the budget ran out
+     * or the log is exhausted.
+     */
+    bool produce(WeightLog::Record &out, size_t &budget);
+
+    /**
+     * Adds a record to the chunk being built. Returns false if it doesn't
+     * fit.
+     */
+    bool append(const WeightLog::Record &record);
+
+    /**
+     * Publishes the chunk being built and starts the next one.
+     */
+    void publish(bool done);
+
+public:
+    HistoryQuery(HAMqtt &mqtt, const WeightLog &log);
+
+    /**
+     * Subscribes to the request topic. Call on every (re)connect.
+     */
+    void on_connected();
+
+    /**
+     * Handles an incoming message. Returns whether it was a history request.
+     */
+    bool on_message(const char *topic, const uint8_t *payload, uint16_t length);
+
+    /**
+     * Makes progress on the query in progress, if any.
+     */
+    void poll();
+};
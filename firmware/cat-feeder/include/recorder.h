@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+#include "blit.h"
+
+/**
+ * Adafruit_GFX and BlitTarget pass-through layer that counts the primitives
+ * and blits sent through it and estimates what they cost on the SPI bus.
+ * The targets can be the real display, or an in-memory canvas such as
+ * GFXcanvas16 with a CanvasBlit to render off-device.
+ */
+class RenderRecorder : public Adafruit_GFX, public BlitTarget {
+public:
+    /**
+     * Render statistics since the last reset.
+     */
+    struct Stats {
+        /**
+         * Number of drawing primitives (pixels, lines, rectangles).
+         */
+        uint32_t calls;
+
+        /**
+         * Number of pixels covered by those primitives.
+         */
+        uint32_t pixels;
+
+        /**
+         * Number of outermost startWrite/endWrite windows.
+         */
+        uint32_t transactions;
+
+        /**
+         * Number of bytes that would be sent to a GC9A01A for this.
+         */
+        uint32_t spi_bytes;
+    };
+
+private:
+    /**
+     * Where the primitives are forwarded to.
+     */
+    Adafruit_GFX &target;
+
+    /**
+     * Where the blits are forwarded to.
+     */
+    BlitTarget &blit_target;
+
+    /**
+     * SPI clock frequency used for the time estimate.
+     */
+    uint32_t spi_frequency;
+
+    /**
+     * startWrite nesting depth.
+     */
+    uint8_t write_depth = 0;
+
+    /**
+     * Statistics since the last reset.
+     */
+    Stats stats = {};
+
+    /**
+     * Each primitive sends a column and row address window plus a memory
+     * write command before the pixel data: 3 command bytes, 8 data bytes.
+     */
+    static constexpr uint32_t BYTES_PER_CALL = 11;
+
+    /**
+     * Records a primitive covering the given number of pixels.
+     */
+    void record(uint32_t pixels);
+
+public:
+    RenderRecorder(Adafruit_GFX &target, BlitTarget &blit_target, uint32_t spi_frequency = 24000000);
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void startWrite() override;
+    void writePixel(int16_t x, int16_t y, uint16_t color) override;
+    void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void endWrite() override;
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void fillScreen(uint16_t color) override;
+
+    void blit(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels) override;
+
+    /**
+     * Returns the statistics gathered since the last reset.
+     */
+    [[nodiscard]] const Stats &get_stats() const;
+
+    /**
+     * Returns the estimated SPI transfer time for the statistics gathered
+     * since the last reset in microseconds.
+     */
+    [[nodiscard]] uint32_t get_spi_micros() const;
+
+    /**
+     * Resets the statistics.
+     */
+    void reset();
+};
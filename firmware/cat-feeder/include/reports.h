@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include "text.h"
+
+// What the state machine reports for display, kept free of hardware access
+// so the rendering can be tested on the host.
+
+/**
+ * Result of previous feed.
+ */
+enum struct FeedResult {
+    /**
+     * No feed has been performed yet.
+     */
+    NONE,
+
+    /**
+     * Successful feed; arg is amount of milligrams.
+     */
+    SUCCESS,
+
+    /**
+     * Failed to initiate feed due to noise on sensors; arg is number of
+     * consecutively failed attempts.
+     */
+    SENSOR_RETRY,
+};
+
+/**
+ * Report for result of previous feed.
+ */
+struct FeedReport {
+    FeedResult result;
+    int arg;
+    unsigned long millis;
+};
+
+/**
+ * Feeding status report. If large is set, only up to 10 characters of
+ * detail1 will be used and detail2 is unused, allowing this text to be
+ * printed at 2x scale where detail1+detail2 would normally be. progress
+ * is the feed cycle progress in per mille, or -1 if we're not feeding.
+ */
+struct StateReport {
+    char header[21];
+    char detail1[21];
+    char detail2[21];
+    bool large;
+    int16_t progress;
+};
+
+/**
+ * Severity level for an error message.
+ */
+enum struct ErrorSeverity {
+    OKAY,
+    WARNING,
+    ERROR
+};
+
+/**
+ * Status report.
+ */
+struct ErrorReport {
+    ErrorCode code;
+    ErrorSeverity severity;
+};
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoHA.h>
+#include <Adafruit_GFX.h>
+
+#include "arc.h"
+#include "blit.h"
+#include "reports.h"
+#include "sequence.h"
+#include "text.h"
+#include "theme.h"
+
+/**
+ * Display pages of the user interface, kept free of hardware access so they
+ * can be rendered on the host. Everything is drawn through an Adafruit_GFX
+ * and a BlitTarget: text lines are composed in an off-screen canvas and
+ * blitted, the progress arc and full-screen clears go through gfx. The main
+ * page is drawn piecewise, one update() call per piece, so no single call
+ * holds the rendering core for long.
+ */
+class Screen {
+public:
+    /**
+     * Immutable copy of everything the main page shows, taken on the main
+     * core.
+     */
+    struct Snapshot {
+        ErrorReport error_report;
+        StateReport state_report;
+        FeedReport feed_report;
+        bool maintenance;
+        int wifi_status;
+        HAMqtt::ConnectionState mqtt_state;
+        uint8_t ip[4];
+        unsigned long micros;
+    };
+
+    /**
+     * Values shown on the diagnostics page, taken on the main core.
+     */
+    struct DiagnosticsSnapshot {
+        uint32_t loop_p99_micros;
+        uint32_t sample_rate_decihertz[2];
+        uint32_t dropped_samples;
+        uint32_t mqtt_publishes;
+        uint32_t mqtt_connects;
+        uint32_t free_heap;
+        uint32_t stack_used[2];
+    };
+
+private:
+    /**
+     * Number of lines on the diagnostics page.
+     */
+    static constexpr size_t DIAGNOSTICS_LINES = 9;
+
+    /**
+     * Graphics target for everything but the text lines.
+     */
+    Adafruit_GFX &gfx;
+
+    /**
+     * Target of the line canvas blits.
+     */
+    BlitTarget &blitter;
+
+    /**
+     * Off-screen buffer for up to two lines of text at 2x scale. Text is
+     * rendered here and then sent to the display with a single address
+     * window and SPI transaction, instead of one per character cell.
+     */
+    GFXcanvas16 line_canvas{240, 32};
+
+    /**
+     * Feed progress gauge.
+     */
+    ProgressArc progress_arc;
+
+    /**
+     * Piece of the main page to update next.
+     */
+    uint8_t update_state = 0;
+
+    /**
+     * String representation of the feed report.
+     */
+    char feed_report_string[21] = {};
+
+    /**
+     * String representation of system status: error messages from state
+     * machine, or otherwise the WiFi state.
+     */
+    char status_string[21] = {};
+
+    /**
+     * Whether the status string above is "idle enough" to be grayed out.
+     */
+    bool status_grayed = false;
+
+    /**
+     * Text currently on the display for each diagnostics line, so only
+     * lines that changed are redrawn.
+     */
+    char diagnostics_lines[DIAGNOSTICS_LINES][21] = {};
+
+    /**
+     * Screen foreground color for this update cycle.
+     */
+    uint16_t color_fg = 0;
+
+    /**
+     * Screen grayed-out foreground color for this update cycle.
+     */
+    uint16_t color_gr = 0;
+
+    /**
+     * Screen background color for this update cycle.
+     */
+    uint16_t color_bg = 0;
+
+    /**
+     * Progress arc fill color for this update cycle.
+     */
+    uint16_t color_arc = 0;
+
+    /**
+     * Progress arc track color for this update cycle.
+     */
+    uint16_t color_track = 0;
+
+    /**
+     * Backlight brightness for this update cycle.
+     */
+    uint8_t brightness = 0;
+
+    /**
+     * Status LED pattern and flash count for this update cycle.
+     */
+    LedPattern led_pattern = LedPattern::OFF;
+    uint8_t led_count = 0;
+
+    /**
+     * Loads the colors and brightness for the next update cycle from the
+     * given palette.
+     */
+    void apply_palette(PaletteId id);
+
+    /**
+     * Renders a single line of text into the line canvas at the given row.
+     */
+    void render_line(int16_t row, const char *buffer, uint8_t scale, bool grayed=false);
+
+    /**
+     * Clears rows of the line canvas.
+     */
+    void clear_lines(int16_t row, int16_t rows);
+
+    /**
+     * Sends the first rows of the line canvas to the display at the given
+     * y coordinate.
+     */
+    void push_lines(int16_t y, int16_t rows);
+
+    /**
+     * Works out colors, LED pattern and strings for a frame.
+     */
+    void preprocess(const Snapshot &snapshot);
+
+public:
+    Screen(Adafruit_GFX &gfx, BlitTarget &blitter);
+
+    /**
+     * Clears the area of the main page and shows a booting status line.
+     */
+    void begin();
+
+    /**
+     * Clears the screen and forgets what was on it, to show either page
+     * from scratch.
+     */
+    void clear(bool diagnostics);
+
+    /**
+     * Returns whether the next update() starts a new frame of the main
+     * page, so a new snapshot may be passed in.
+     */
+    [[nodiscard]] bool at_frame_start() const;
+
+    /**
+     * Draws the next piece of the main page. The snapshot must not change
+     * until the frame is complete. Returns true once it is.
+     */
+    bool update(const Snapshot &snapshot);
+
+    /**
+     * Redraws the lines of the diagnostics page that changed.
+     */
+    void update_diagnostics(const DiagnosticsSnapshot &diagnostics);
+
+    /**
+     * Draws a line of text at 2x scale at the given y coordinate.
+     */
+    void draw_line(int16_t y, const char *text);
+
+    /**
+     * Returns the backlight brightness for the current frame.
+     */
+    [[nodiscard]] uint8_t get_brightness() const;
+
+    /**
+     * Returns the status LED pattern and flash count for the current frame.
+     */
+    [[nodiscard]] LedPattern get_led_pattern() const;
+    [[nodiscard]] uint8_t get_led_count() const;
+};
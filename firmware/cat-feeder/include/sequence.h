@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Status LED pattern shapes.
+ */
+enum class LedPattern : uint8_t {
+    /**
+     * LED off.
+     */
+    OFF,
+
+    /**
+     * LED on.
+     */
+    ON,
+
+    /**
+     * Square wave, 0.8s period.
+     */
+    BLINK,
+
+    /**
+     * Triangle wave, 2s period.
+     */
+    BREATHE,
+
+    /**
+     * The given number of short flashes followed by a pause.
+     */
+    FLASH,
+};
+
+/**
+ * Pattern playback for the status LED, kept free of hardware access so it
+ * can be tested on the host. A setting packs the pattern in the low byte
+ * and the flash count in the high byte, so it fits one atomic word; next()
+ * is called once per 50ms step and returns the brightness for that step.
+ */
+class LedSequence {
+private:
+    /**
+     * Setting currently being played.
+     */
+    uint16_t playing = 0;
+
+    /**
+     * Current step within the pattern, wrapped at the end of its period so
+     * the counter never overflows mid-period.
+     */
+    uint16_t step = 0;
+
+public:
+    /**
+     * Packs a pattern and flash count into a setting.
+     */
+    [[nodiscard]] static constexpr uint16_t setting(const LedPattern pattern, const uint8_t count) {
+        return static_cast<uint16_t>(static_cast<uint8_t>(pattern) | count << 8);
+    }
+
+    /**
+     * Returns the number of steps after which a pattern repeats.
+     */
+    [[nodiscard]] static uint16_t period(LedPattern pattern, uint8_t count);
+
+    /**
+     * Returns the brightness for the given step of a pattern, which must be
+     * less than its period.
+     */
+    [[nodiscard]] static uint8_t level(LedPattern pattern, uint8_t count, uint16_t step);
+
+    /**
+     * Returns the brightness for the next step of the given setting.
+     * Playback restarts from the beginning when the setting differs from
+     * the previous call.
+     */
+    uint8_t next(uint16_t current);
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Statistics policy computing the mean and variance of a window of raw
+ * samples. The window size is a compile-time power of two, so the
+ * divisions become shifts and a multiplication by an exact reciprocal.
+ * Kept apart from the loadcell driver so it can be tested on the host.
+ */
+struct MeanVariance {
+    /**
+     * Computes the rounded mean and the population variance of the
+     * 2^WINDOW_LOG2 samples in raw measurement units.
+     */
+    template<uint8_t WINDOW_LOG2>
+    static void compute(const int32_t *samples, int32_t &mean, float &variance) {
+        constexpr size_t WINDOW = size_t(1) << WINDOW_LOG2;
+        int64_t accum = WINDOW / 2;
+        for (size_t i = 0; i < WINDOW; i++) {
+            accum += samples[i];
+        }
+        mean = static_cast<int32_t>(accum >> WINDOW_LOG2);
+
+        uint64_t squares = 0;
+        for (size_t i = 0; i < WINDOW; i++) {
+            const int64_t diff = samples[i] - mean;
+            squares += static_cast<uint64_t>(diff * diff);
+        }
+        variance = static_cast<float>(squares) * (1.0f / static_cast<float>(WINDOW));
+    }
+};
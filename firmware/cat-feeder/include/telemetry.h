@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "datagrams.h"
+
+// Uncomment to stream raw loadcell samples, limit switch edges, motor
+// changes and state transitions over UDP to the host below. Receive with
+// tools/telemetry_receiver.py.
+//#define TELEMETRY_ENABLE
+
+/**
+ * High-rate binary event stream over UDP. Events are buffered in a
+ * TelemetryBuffer; the main loop sends the filled datagram at a fixed
+ * cadence while the other keeps filling. If both are full, events are
+ * dropped and counted rather than waiting for the network.
+ */
+class Telemetry {
+public:
+    /**
+     * Event types.
+     */
+    using Event = TelemetryEvent;
+
+#ifdef TELEMETRY_ENABLE
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+
+private:
+    /**
+     * Receiving host and port.
+     */
+    static constexpr uint8_t HOST[4] = {192, 168, 1, 7};
+    static constexpr uint16_t PORT = 5005;
+
+    /**
+     * Datagram size; fits a standard Ethernet MTU with room for headers.
+     */
+    static constexpr size_t DATAGRAM_SIZE = ENABLED ? 1400 : 16;
+
+    /**
+     * Interval at which partially filled datagrams are sent.
+     */
+    static constexpr uint32_t CADENCE_MILLIS = 50;
+
+    /**
+     * UDP socket.
+     */
+    WiFiUDP udp;
+
+    /**
+     * Storage of the ping-pong datagram buffers.
+     */
+    uint8_t datagrams[2][DATAGRAM_SIZE] = {};
+
+    /**
+     * Datagram buffering.
+     */
+    TelemetryBuffer buffer{datagrams[0], DATAGRAM_SIZE};
+
+    /**
+     * Datagrams the network stack refused.
+     */
+    uint32_t send_failures = 0;
+
+    /**
+     * millis() at the last send.
+     */
+    uint32_t send_millis = 0;
+
+    /**
+     * Out-of-line part of record().
+     */
+    void append(Event event, uint8_t arg, int32_t value);
+
+public:
+    /**
+     * Opens the socket.
+     */
+    void begin();
+
+    /**
+     * Records an event. Does nothing unless TELEMETRY_ENABLE is defined.
+     */
+    void record(const Event event, const uint8_t arg, const int32_t value) {
+        if (ENABLED) append(event, arg, value);
+    }
+
+    /**
+     * Sends a buffered datagram if one is due. Never blocks.
+     */
+    void poll();
+
+    /**
+     * Returns the number of events dropped because of backpressure.
+     */
+    [[nodiscard]] uint32_t get_dropped() const;
+
+    /**
+     * Returns the number of datagrams the network stack refused.
+     */
+    [[nodiscard]] uint32_t get_send_failures() const;
+};
+
+extern Telemetry telemetry;
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <Arduino.h>
+#include <utility>
+
+/**
+ * Error and warning conditions reported by the state machine, in order of
+ * decreasing priority.
+ */
+enum class ErrorCode : uint8_t {
+    NONE,
+    MOTOR_TIMEOUT,
+    SENSOR_TIMEOUT,
+    RESERVOIR_NOISY,
+    BOWL_NOISY,
+    SENSOR_DISAGREE,
+    SENSOR_SANITY,
+    POWER_LOSS,
+    JAMMED,
+    JAMMED_MAYBE,
+    RESERVOIR_LOW,
+    REFILL_SOON,
+    COUNT
+};
+
+/**
+ * Returns the bit used for the given error code in an error mask. Codes are
+ * ordered by priority, and the most significant bit belongs to code 0 (NONE,
+ * never set), so the leading zero count of a nonzero mask is the
+ * highest-priority active code.
+ */
+constexpr uint32_t error_bit(const ErrorCode code) {
+    return 0x80000000u >> static_cast<uint8_t>(code);
+}
+static_assert(static_cast<size_t>(ErrorCode::COUNT) <= 32, "too many error codes for an error mask");
+
+/**
+ * Returns the highest-priority error code in the given mask, or
+ * ErrorCode::NONE if the mask is empty.
+ */
+constexpr ErrorCode error_highest(const uint32_t mask) {
+    if (!mask) return ErrorCode::NONE;
+    return static_cast<ErrorCode>(__builtin_clz(mask));
+}
+
+/**
+ * User-visible strings other than error messages.
+ */
+enum class Text : uint8_t {
+    LAST_FEED,
+    FEED_NONE,
+    FEED_RESULT,
+    FEED_NOISE,
+    MAINTENANCE,
+    JAMMED,
+    COOLDOWN,
+    DEFICIT,
+    TARE_RESERVOIR,
+    TARE_BOWL,
+    FEEDING,
+    WIFI_IDLE,
+    WIFI_NO_SSID,
+    WIFI_SCAN_COMPLETE,
+    WIFI_CONNECT_FAILED,
+    WIFI_CONNECTION_LOST,
+    WIFI_DISCONNECTED,
+    WIFI_STATUS,
+    MQTT_CONNECTING,
+    MQTT_CONNECTION_TIMEOUT,
+    MQTT_CONNECTION_LOST,
+    MQTT_CONNECTION_FAILED,
+    MQTT_DISCONNECTED,
+    MQTT_BAD_PROTOCOL,
+    MQTT_BAD_CLIENT_ID,
+    MQTT_UNAVAILABLE,
+    MQTT_BAD_CREDENTIALS,
+    MQTT_UNAUTHORIZED,
+    BOOTING,
+    DIAGNOSTICS,
+    DIAGNOSTICS_LOOP,
+    DIAGNOSTICS_RESERVOIR,
+    DIAGNOSTICS_BOWL,
+    DIAGNOSTICS_DROPPED,
+    DIAGNOSTICS_PUBLISHES,
+    DIAGNOSTICS_CONNECTS,
+    DIAGNOSTICS_HEAP,
+    DIAGNOSTICS_STACK,
+    COUNT
+};
+
+// String tables. Define UI_LANGUAGE as a quoted header name (for example
+// -DUI_LANGUAGE='"text_nl.h"') to use a translation; it must define
+// ERROR_TEXTS and TEXTS in the same order as the enums above. Strings must
+// fit in TEXT_MAX_LENGTH characters, which is checked below.
+#ifdef UI_LANGUAGE
+#include UI_LANGUAGE
+#else
+inline constexpr const char *ERROR_TEXTS[] = {
+    "No error",
+    "Motor timeout",
+    "Sensor timeout",
+    "Reservoir noisy",
+    "Bowl noisy",
+    "Sensor disagree",
+    "Sensor sanity",
+    "Power loss",
+    "Jammed/empty",
+    "Jammed/empty?",
+    "Reservoir low",
+    "Refill soon",
+};
+
+inline constexpr const char *TEXTS[] = {
+    "Last feed",
+    "None",
+    "Feed result",
+    "Noise on sensor (x",
+    "Maintenance",
+    "JAMMED",
+    "Cooldown",
+    "Deficit",
+    "Tare reservoir",
+    "Tare bowl",
+    "Feeding",
+    "WiFi: idle",
+    "WiFi: no SSID",
+    "WiFi: scan complete",
+    "WiFi: connect failed",
+    "WiFi: conn. lost",
+    "WiFi: disconnected",
+    "WiFi: status ",
+    "MQTT: connecting",
+    "MQTT: conn. timeout",
+    "MQTT: conn. lost",
+    "MQTT: connect failed",
+    "MQTT: disconnected",
+    "MQTT: bad protocol",
+    "MQTT: bad client ID",
+    "MQTT: unavailable",
+    "MQTT: bad login",
+    "MQTT: unauthorized",
+    "Starting up",
+    "Diagnostics",
+    "Loop p99 ",
+    "Res ",
+    "Bowl ",
+    "Dropped ",
+    "MQTT tx ",
+    "MQTT conn ",
+    "Heap ",
+    "Stack ",
+};
+#endif
+
+static_assert(sizeof(ERROR_TEXTS) / sizeof(ERROR_TEXTS[0]) == static_cast<size_t>(ErrorCode::COUNT), "error text table out of sync");
+static_assert(sizeof(TEXTS) / sizeof(TEXTS[0]) == static_cast<size_t>(Text::COUNT), "text table out of sync");
+
+/**
+ * Longest string the display lines and their 21-byte buffers can hold.
+ */
+inline constexpr size_t TEXT_MAX_LENGTH = 20;
+
+/**
+ * Returns the length of a string at compile time.
+ */
+constexpr size_t text_length(const char *s) {
+    size_t length = 0;
+    while (s[length]) length++;
+    return length;
+}
+
+/**
+ * Checks entry INDEX of a string table; a failure names the table and index
+ * in the instantiation backtrace.
+ */
+template<const char *const *TABLE, size_t INDEX>
+struct TextFits {
+    static_assert(text_length(TABLE[INDEX]) <= TEXT_MAX_LENGTH, "string longer than TEXT_MAX_LENGTH");
+    static constexpr bool value = true;
+};
+
+/**
+ * Instantiates TextFits for every entry of a string table.
+ */
+template<const char *const *TABLE, size_t... INDICES>
+constexpr bool texts_fit(std::index_sequence<INDICES...>) {
+    return (TextFits<TABLE, INDICES>::value && ...);
+}
+
+static_assert(texts_fit<ERROR_TEXTS>(std::make_index_sequence<static_cast<size_t>(ErrorCode::COUNT)>()), "error text too long");
+static_assert(texts_fit<TEXTS>(std::make_index_sequence<static_cast<size_t>(Text::COUNT)>()), "text too long");
+
+/**
+ * Returns the message for an error code.
+ */
+constexpr const char *text(const ErrorCode id) {
+    return ERROR_TEXTS[static_cast<size_t>(id)];
+}
+
+/**
+ * Returns a user-visible string.
+ */
+constexpr const char *text(const Text id) {
+    return TEXTS[static_cast<size_t>(id)];
+}
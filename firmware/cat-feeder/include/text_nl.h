@@ -0,0 +1,59 @@
+#pragma once
+
+// Dutch translation of the string tables in text.h.
+
+inline constexpr const char *ERROR_TEXTS[] = {
+    "Geen fout",
+    "Motor time-out",
+    "Sensor time-out",
+    "Voorraad onrustig",
+    "Bak onrustig",
+    "Sensoren oneens",
+    "Sensor onlogisch",
+    "Stroomuitval",
+    "Vast/leeg",
+    "Vast/leeg?",
+    "Voorraad laag",
+    "Bijvullen",
+};
+
+inline constexpr const char *TEXTS[] = {
+    "Laatste voer",
+    "Geen",
+    "Voerresultaat",
+    "Sensorruis (x",
+    "Onderhoud",
+    "VAST",
+    "Wachttijd",
+    "Tekort",
+    "Tarra voorraad",
+    "Tarra bak",
+    "Voeren",
+    "WiFi: inactief",
+    "WiFi: geen SSID",
+    "WiFi: scan klaar",
+    "WiFi: verb. mislukt",
+    "WiFi: verb. weg",
+    "WiFi: niet verbonden",
+    "WiFi: status ",
+    "MQTT: verbinden",
+    "MQTT: time-out",
+    "MQTT: verb. weg",
+    "MQTT: verb. mislukt",
+    "MQTT: verbroken",
+    "MQTT: fout protocol",
+    "MQTT: fout client-ID",
+    "MQTT: onbereikbaar",
+    "MQTT: fout login",
+    "MQTT: geen toegang",
+    "Opstarten",
+    "Diagnose",
+    "Lus p99 ",
+    "Voorr. ",
+    "Bak ",
+    "Gemist ",
+    "MQTT tx ",
+    "MQTT verb. ",
+    "Heap ",
+    "Stack ",
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Display colors (RGB565) and backlight brightness for a UI state. The text
+ * lines use fg, gr and bg; the progress arc sits outside the lines on the
+ * black border of the screen, so it has its own fill and track colors.
+ */
+struct Palette {
+    uint16_t fg;
+    uint16_t gr;
+    uint16_t bg;
+    uint16_t arc;
+    uint16_t track;
+    uint8_t brightness;
+};
+
+/**
+ * UI states that have their own palette.
+ */
+enum class PaletteId : uint8_t {
+    OPERATIONAL,
+    MAINTENANCE,
+    WARNING,
+    ERROR,
+    DIAGNOSTICS,
+    COUNT
+};
+
+// Palette table. Define UI_THEME as a quoted header name to use a different
+// theme; it must define PALETTES in the same order as PaletteId.
+#ifdef UI_THEME
+#include UI_THEME
+#else
+inline constexpr Palette PALETTES[] = {
+    {0b1100011111100000, 0b0110010000000000, 0, 0b1100011111100000, 0b0110010000000000, 32},
+    {0b0000011111111000, 0b0000010000001100, 0, 0b0000011111111000, 0b0000010000001100, 255},
+    {0, 0b1000001000000000, 0b1111110000000000, 0b1111110000000000, 0b1000001000000000, 255},
+    {0, 0b1000000000000000, 0b1111100000000000, 0b1111100000000000, 0b1000000000000000, 255},
+    {0b1111111111111111, 0b1000010000010000, 0, 0b1111111111111111, 0b1000010000010000, 255},
+};
+#endif
+
+static_assert(sizeof(PALETTES) / sizeof(PALETTES[0]) == static_cast<size_t>(PaletteId::COUNT), "palette table out of sync");
+
+/**
+ * Returns the palette for a UI state.
+ */
+constexpr const Palette &palette(const PaletteId id) {
+    return PALETTES[static_cast<size_t>(id)];
+}
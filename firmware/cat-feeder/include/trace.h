@@ -0,0 +1,169 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Uncomment to record subsystem calls, state transitions, samples, limit
+// switch edges and MQTT publishes into an event ring. Dump it with the
+// "trace" serial command and convert the dump with tools/trace_to_chrome.py
+// to open it in Perfetto or chrome://tracing.
+//#define TRACE_ENABLE
+
+/**
+ * Timeline of recent events per core, for debugging timing problems.
+ * Each core writes only its own ring, so recording an event is a timer
+ * read and a few stores with no locking. Older events are overwritten.
+ * When TRACE_ENABLE is not defined, the rings are empty and recording
+ * compiles to nothing.
+ */
+class Trace {
+public:
+    /**
+     * Event types.
+     */
+    enum class Event : uint8_t {
+        /**
+         * Start of a subsystem call; argument is the Scope.
+         */
+        BEGIN,
+
+        /**
+         * End of a subsystem call; argument is the Scope.
+         */
+        END,
+
+        /**
+         * State machine transition; argument is the new state, value the
+         * time spent in the previous one in milliseconds.
+         */
+        STATE,
+
+        /**
+         * HX711 sample arrival; argument is the Loadcell::Sensor, value the
+         * raw sample.
+         */
+        SAMPLE,
+
+        /**
+         * Limit switch edge; argument is the new level.
+         */
+        LIMIT,
+
+        /**
+         * Motor output change; argument is the new level.
+         */
+        MOTOR,
+
+        /**
+         * MQTT state publish; value is the running publish count.
+         */
+        PUBLISH,
+
+        COUNT,
+    };
+
+    /**
+     * Traced subsystem calls.
+     */
+    enum class Scope : uint8_t {
+        UI_UPDATE,
+        FSM_UPDATE,
+        LOADCELL_UPDATE,
+        MQTT_LOOP,
+        DISCOVERY,
+        HISTORY_QUERY,
+        METRICS,
+        TELEMETRY,
+        CONSOLE,
+        UI_RENDER,
+        COUNT,
+    };
+
+#ifdef TRACE_ENABLE
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+
+    /**
+     * Records BEGIN on construction and END on destruction.
+     */
+    class Span {
+    private:
+        /**
+         * Traced call.
+         */
+        const Scope scope;
+
+    public:
+        explicit Span(Scope scope);
+        ~Span();
+    };
+
+private:
+    /**
+     * Events kept per core; a power of two.
+     */
+    static constexpr size_t RING_SIZE = ENABLED ? 512 : 1;
+
+    /**
+     * A recorded event.
+     */
+    struct Record {
+        uint32_t micros;
+        Event event;
+        uint8_t arg;
+        int32_t value;
+    };
+
+    /**
+     * Event rings per core.
+     */
+    Record rings[2][RING_SIZE] = {};
+
+    /**
+     * Total number of events recorded per core; the ring index is this
+     * modulo RING_SIZE.
+     */
+    uint32_t heads[2] = {0, 0};
+
+    /**
+     * Set while dumping, so the rings don't change underneath.
+     */
+    volatile bool frozen = false;
+
+    static_assert((RING_SIZE & (RING_SIZE - 1)) == 0, "ring size must be a power of two");
+
+public:
+    /**
+     * Records an event on the calling core. Does nothing unless
+     * TRACE_ENABLE is defined.
+     */
+    void record(const Event event, const uint8_t arg, const int32_t value = 0) {
+        if (!ENABLED || frozen) return;
+        const unsigned core = get_core_num();
+        Record &r = rings[core][heads[core]++ & (RING_SIZE - 1)];
+        r.micros = time_us_32();
+        r.event = event;
+        r.arg = arg;
+        r.value = value;
+    }
+
+    /**
+     * Prints the rings as CSV lines of core, micros, event, argument and
+     * value, oldest first per core. Recording pauses meanwhile.
+     */
+    void dump(Print &out);
+};
+
+/**
+ * Global event trace.
+ */
+extern Trace trace;
+
+inline Trace::Span::Span(const Scope scope) : scope(scope) {
+    trace.record(Event::BEGIN, static_cast<uint8_t>(scope));
+}
+
+inline Trace::Span::~Span() {
+    trace.record(Event::END, static_cast<uint8_t>(scope));
+}
@@ -2,99 +2,274 @@
 
 #include <Arduino.h>
 #include <ArduinoHA.h>
-#include <Adafruit_GC9A01A.h>
+#include <Adafruit_GFX.h>
 
+#include "blit.h"
 #include "fsm.h"
+#include "led.h"
+#include "mailbox.h"
 #include "pins.h"
+#include "recorder.h"
+#include "screen.h"
 
+//#define DEBUG_UI_RECORD
+
+/**
+ * Network and memory state shown on the display, read on the main core.
+ * Keeps the user interface independent of the WiFi driver and allocator.
+ */
+class SystemStatus {
+public:
+    /**
+     * Returns the WiFi status, one of the WL_ constants.
+     */
+    virtual int wifi_status() = 0;
+
+    /**
+     * Returns the local IP address, or zeros if there is none.
+     */
+    virtual void local_ip(uint8_t ip[4]) = 0;
+
+    /**
+     * Returns the free heap in bytes.
+     */
+    virtual uint32_t free_heap() = 0;
+
+protected:
+    ~SystemStatus() = default;
+};
+
+/**
+ * User interface. Rendering and button handling run on the second core and
+ * only communicate with the main loop through a snapshot mailbox and an
+ * event queue, so display traffic never delays the state machine. The
+ * display is passed in as a graphics target, a blit target and a panel
+ * control, and its pages are drawn by a Screen.
+ */
 class UserInterface {
+public:
+    /**
+     * SPI clock frequency for the display. The RP2040 can go up to 62.5MHz;
+     * use the display benchmark to check what the wiring can handle.
+     */
+    static constexpr uint32_t SPI_FREQUENCY = 40000000;
+
 private:
+    using Snapshot = Screen::Snapshot;
+    using DiagnosticsSnapshot = Screen::DiagnosticsSnapshot;
+
     /**
-     * Low-level display driver.
+     * Button events sent from the rendering core to the main core.
      */
-    Adafruit_GC9A01A tft;
+    enum class ButtonEvent : uint8_t {
+        SET,
+        FEED,
+        UP,
+        DOWN,
+        LOCK,
+        MIC,
+    };
 
     /**
-     * Reference to the state machine that we're representing.
+     * Time between diagnostics page updates.
      */
-    StateMachine &fsm;
+    static constexpr unsigned long DIAGNOSTICS_INTERVAL_MILLIS = 1000;
 
     /**
-     * Reference to the MQTT connection.
+     * Minimum time between snapshots.
      */
-    HAMqtt &mqtt;
+    static constexpr unsigned long SNAPSHOT_INTERVAL_MILLIS = 20;
+
+public:
+    /**
+     * Display throughput at a number of SPI clock frequencies.
+     */
+    struct BenchmarkResult {
+        static constexpr size_t NUM_SETTINGS = 5;
+        struct Setting {
+            uint32_t frequency;
+            uint32_t fill_micros;
+            uint32_t line_micros;
+        } settings[NUM_SETTINGS];
+    };
+
+private:
+    /**
+     * SPI clock frequencies tested by the benchmark.
+     */
+    static constexpr uint32_t BENCHMARK_FREQUENCIES[BenchmarkResult::NUM_SETTINGS] = {
+        10000000, 20000000, 31250000, 40000000, 62500000
+    };
+
+    /**
+     * Set by the main core to request a benchmark run.
+     */
+    std::atomic<bool> benchmark_requested{false};
+
+    /**
+     * Benchmark results from the rendering core to the main core.
+     */
+    Mailbox<BenchmarkResult> benchmark_mailbox;
+
+    /**
+     * Sequence number of the most recently retrieved benchmark result.
+     */
+    uint32_t benchmark_sequence = 0;
+
+    /**
+     * Measures display throughput at each benchmark frequency, then restores
+     * the configured frequency and redraws the current page from scratch.
+     */
+    void run_benchmark();
+
+    /**
+     * Snapshots from the main core to the rendering core.
+     */
+    Mailbox<Snapshot> snapshot_mailbox;
+
+    /**
+     * Button events from the rendering core to the main core.
+     */
+    Queue<ButtonEvent, 8> button_queue;
 
     /**
-     * To reduce the duration of individual update calls, the display is
-     * updated piecewise. This tracks which piece we're updating next.
+     * Time at which the most recent snapshot was posted.
      */
-    uint8_t display_update_state = 0;
+    unsigned long snapshot_millis = 0;
 
     /**
-     * Error report that we're displaying this update cycle.
+     * Sequence number of the snapshot being rendered.
      */
-    StateMachine::ErrorReport error_report = {};
+    uint32_t snapshot_sequence = 0;
 
     /**
-     * State report that we're displaying this update cycle.
+     * Snapshot being rendered.
      */
-    StateMachine::StateReport state_report = {};
+    Snapshot snapshot = {};
 
     /**
-     * Feed report that we're displaying this update cycle.
+     * Whether the diagnostics page is shown. Written by the rendering core.
      */
-    StateMachine::FeedReport feed_report = {};
+    std::atomic<bool> diagnostics_shown{false};
 
     /**
-     * String representation of the feed report.
+     * Diagnostics from the main core to the rendering core.
      */
-    char feed_report_string[21] = {};
+    Mailbox<DiagnosticsSnapshot> diagnostics_mailbox;
 
     /**
-     * String representation of system status: error messages from state
-     * machine, or otherwise the WiFi state.
+     * Whether the diagnostics page was shown during the previous update of
+     * the main core.
      */
-    char status_string[21] = {};
+    bool diagnostics_was_shown = false;
 
     /**
-     * Whether the status string above is "idle enough" to be grayed out.
+     * Time at which the most recent diagnostics snapshot was posted.
      */
-    bool status_grayed = false;
+    unsigned long diagnostics_millis = 0;
 
     /**
-     * Screen foreground color for this update cycle.
+     * Loop timing histogram at the time of the previous diagnostics
+     * snapshot, to compute the percentile over the last interval.
      */
-    uint16_t color_fg = 0;
+    Histogram diagnostics_prev_loop;
 
     /**
-     * Screen grayed-out foreground color for this update cycle.
+     * Loadcell statistics at the time of the previous diagnostics snapshot.
      */
-    uint16_t color_gr = 0;
+    Loadcell::Stats diagnostics_prev_loadcell = {};
 
     /**
-     * Screen background color for this update cycle.
+     * Sequence number of the diagnostics snapshot being rendered.
      */
-    uint16_t color_bg = 0;
+    uint32_t diagnostics_sequence = 0;
 
     /**
-     * Backlight brightness.
+     * Diagnostics snapshot being rendered.
      */
-    uint8_t brightness = 0;
+    DiagnosticsSnapshot diagnostics_snapshot = {};
 
     /**
-     * Renders a single line of text.
+     * Set while the diagnostics button chord is held, to suppress the
+     * release events of the individual buttons.
      */
-    void render_line(size_t y, const char *buffer, size_t scale, bool grayed=false);
+    bool chord_latched = false;
 
     /**
-     * Preprocess what should be on the screen.
+     * Takes a diagnostics snapshot and posts it to the rendering core.
      */
-    void display_preprocess();
+    void post_diagnostics();
 
     /**
-     * Updates the display.
+     * Shows or hides the diagnostics page.
      */
-    void display_update();
+    void show_diagnostics(bool show);
+
+#ifdef DEBUG_UI_RECORD
+    /**
+     * Worst-case time from snapshot to completed frame since the last report.
+     */
+    unsigned long max_latency_micros = 0;
+#endif
+
+#ifdef DEBUG_UI_RECORD
+    /**
+     * Render statistics recorder that gfx and blitter point to.
+     */
+    RenderRecorder &recorder;
+#endif
+
+    /**
+     * Graphics target that all rendering goes through. This is either the
+     * display driver itself or a render statistics recorder.
+     */
+    Adafruit_GFX &gfx;
+
+    /**
+     * Target of the line canvas blits; the panel or the recorder, like gfx.
+     */
+    BlitTarget &blitter;
+
+    /**
+     * Display settings.
+     */
+    PanelControl &panel;
+
+    /**
+     * Source of the network and memory state.
+     */
+    SystemStatus &status;
+
+    /**
+     * Display pages.
+     */
+    Screen screen{gfx, blitter};
+
+    /**
+     * Front panel status LED.
+     */
+    StatusLed status_led;
+
+    /**
+     * Reference to the state machine that we're representing.
+     */
+    StateMachine &fsm;
+
+    /**
+     * Reference to the MQTT connection.
+     */
+    HAMqtt &mqtt;
+
+    /**
+     * Takes a snapshot of the state machine and network state and posts it
+     * to the rendering core.
+     */
+    void post_snapshot();
+
+    /**
+     * Sets the backlight and status LED for a completed frame.
+     */
+    void finish_frame();
 
     /**
      * Trivially debounced button class.
@@ -107,6 +282,7 @@ private:
         explicit Button(int pin);
         void begin();
         bool update();
+        [[nodiscard]] bool held() const;
     };
 
     /**
@@ -120,7 +296,8 @@ private:
     Button key_feed {PIN_KEY_FEED};
 
     /**
-     * Debounce logic for up button, used to tare reservoir.
+     * Debounce logic for up button, used to tare reservoir. Together with
+     * the down button, toggles the diagnostics page.
      */
     Button key_up {PIN_KEY_UP};
 
@@ -140,18 +317,45 @@ private:
     Button key_mic {PIN_KEY_MIC};
 
 public:
+#ifdef DEBUG_UI_RECORD
+    /**
+     * Renders through the given recorder, which forwards to the display.
+     */
+    UserInterface(StateMachine &fsm, HAMqtt &mqtt, RenderRecorder &recorder, PanelControl &panel, SystemStatus &status);
+#else
     /**
-     * Constructor.
+     * Renders through the given graphics and blit targets.
      */
-    UserInterface(StateMachine &fsm, HAMqtt &mqtt);
+    UserInterface(StateMachine &fsm, HAMqtt &mqtt, Adafruit_GFX &gfx, BlitTarget &blitter, PanelControl &panel, SystemStatus &status);
+#endif
 
     /**
-     * Initializes things.
+     * Initializes the display and buttons. Called from the rendering core
+     * once the display driver has been started.
      */
     void begin();
 
     /**
-     * Updates the user interface.
+     * Posts state to the rendering core and handles button events. Called
+     * from the main loop.
      */
     void update();
+
+    /**
+     * Renders the display and polls the buttons. Called from the rendering
+     * core's loop.
+     */
+    void render();
+
+    /**
+     * Requests a display throughput benchmark. The display is blanked for
+     * about a second while it runs.
+     */
+    void request_benchmark();
+
+    /**
+     * Retrieves the result of a benchmark, returning whether one completed
+     * since the previous call.
+     */
+    bool get_benchmark_result(BenchmarkResult &result);
 };
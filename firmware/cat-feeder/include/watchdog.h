@@ -0,0 +1,213 @@
+#pragma once
+
+#include <Arduino.h>
+#include "deadlines.h"
+#include "format.h"
+
+/**
+ * Hang detection. The main loop and the render loop announce which
+ * subsystem they are about to run with enter(); each subsystem has a time
+ * budget. A timer interrupt on each core checks the budgets and feeds the
+ * hardware watchdog while they hold. When one is exceeded, the interrupt
+ * forces the motor output low, stores the subsystem, the state machine
+ * state and the interrupted PC and LR in the watchdog scratch registers
+ * (which survive the reset) and reboots. The record is picked up by
+ * begin() on the next boot.
+ *
+ * While feeding, the motor output is also forced low as soon as any
+ * subsystem on core 0 runs longer than FEED_BUDGET_MILLIS, without a
+ * reset, so a slow MQTT reconnect or console command can't keep the motor
+ * running for the length of its own budget. The state machine drives the
+ * output again on its next update.
+ *
+ * If interrupts themselves stop, the hardware watchdog resets the chip
+ * without a record; the motor output then falls back to its reset state.
+ */
+class Watchdog {
+public:
+    /**
+     * Supervised subsystems.
+     */
+    enum class Subsystem : uint8_t {
+        LOOP,
+        UI,
+        FSM,
+        MQTT,
+        DISCOVERY,
+        HISTORY_QUERY,
+        METRICS,
+        TELEMETRY,
+        CONSOLE,
+        WIFI,
+        RENDER,
+        COUNT,
+    };
+
+    /**
+     * Cause of the previous reset, as far as known.
+     */
+    struct ResetRecord {
+        enum class Cause : uint8_t {
+            /**
+             * Power-on or external reset.
+             */
+            POWER_ON,
+
+            /**
+             * A subsystem exceeded its budget; the other fields are valid.
+             */
+            HANG,
+
+            /**
+             * The hardware watchdog expired without a record, meaning
+             * interrupts stopped.
+             */
+            WATCHDOG,
+        };
+
+        Cause cause;
+        Subsystem subsystem;
+        uint8_t core;
+        uint8_t state;
+        uint32_t overdue_millis;
+        uint32_t pc;
+        uint32_t lr;
+    };
+
+private:
+    /**
+     * Time budget per subsystem in milliseconds. MQTT includes connecting,
+     * which blocks for the socket timeout; the console includes printing
+     * the history and the trace.
+     */
+    static constexpr uint32_t BUDGETS[static_cast<size_t>(Subsystem::COUNT)] = {
+        1000,   // LOOP
+        1000,   // UI
+        5000,   // FSM, including flash writes
+        20000,  // MQTT
+        1000,   // DISCOVERY
+        1000,   // HISTORY_QUERY
+        1000,   // METRICS
+        1000,   // TELEMETRY
+        5000,   // CONSOLE
+        5000,   // WIFI, starting association
+        5000,   // RENDER, including the display benchmark
+    };
+
+    /**
+     * Time any subsystem on core 0 may run while feeding before the motor
+     * output is forced low.
+     */
+    static constexpr uint32_t FEED_BUDGET_MILLIS = 1000;
+
+    /**
+     * Interval between deadline checks.
+     */
+    static constexpr uint32_t CHECK_MICROS = 100000;
+
+    /**
+     * Hardware watchdog timeout; covers the longest time interrupts are
+     * disabled for a flash erase.
+     */
+    static constexpr uint32_t HARDWARE_TIMEOUT_MILLIS = 3000;
+
+    /**
+     * Time after which a core reports the other core's overrun itself,
+     * without its PC, because the other core's interrupt didn't.
+     */
+    static constexpr uint32_t CROSS_CORE_GRACE_MILLIS = 1000;
+
+    /**
+     * Marker in scratch register 0 identifying a hang record.
+     */
+    static constexpr uint32_t MAGIC = 0xCF000000;
+
+    /**
+     * Deadline per core.
+     */
+    Deadlines deadlines;
+
+    /**
+     * Hardware alarm used for the deadline checks per core, -1 if none.
+     */
+    int alarms[2] = {-1, -1};
+
+    /**
+     * Current state machine state, for the record.
+     */
+    volatile uint8_t state = 0;
+
+    /**
+     * Whether the state machine is in a feed state.
+     */
+    volatile bool feeding = false;
+
+    /**
+     * Set once a reset has been initiated.
+     */
+    volatile bool tripped = false;
+
+    /**
+     * Cause of the previous reset.
+     */
+    ResetRecord reset_record = {};
+
+    /**
+     * Claims a hardware alarm on the calling core and starts the checks.
+     */
+    void start_checks();
+
+    /**
+     * Writes the record and reboots.
+     */
+    [[noreturn]] void trip(unsigned core, const Deadlines::Expiry &expiry, uint32_t pc, uint32_t lr);
+
+public:
+    /**
+     * Reads the previous reset record and starts supervising core 0 and
+     * the hardware watchdog. Call at the end of setup().
+     */
+    void begin();
+
+    /**
+     * Starts supervising core 1. Call at the end of setup1().
+     */
+    void begin_core();
+
+    /**
+     * Announces that the calling core starts running the given subsystem.
+     */
+    void enter(const Subsystem subsystem) {
+        const unsigned core = get_core_num();
+        deadlines.enter(core, static_cast<uint8_t>(subsystem), millis(), BUDGETS[static_cast<size_t>(subsystem)]);
+    }
+
+    /**
+     * Records the current state machine state and whether it feeds.
+     */
+    void set_state(const uint8_t new_state, const bool new_feeding) {
+        state = new_state;
+        feeding = new_feeding;
+    }
+
+    /**
+     * Timer interrupt body; frame is the exception stack frame of the
+     * interrupted code.
+     */
+    void check(const uint32_t *frame);
+
+    /**
+     * Returns the cause of the previous reset.
+     */
+    [[nodiscard]] const ResetRecord &get_reset_record() const;
+
+    /**
+     * Describes the previous reset in human-readable form.
+     */
+    void describe_reset(Formatter &f) const;
+};
+
+/**
+ * Global watchdog.
+ */
+extern Watchdog watchdog;
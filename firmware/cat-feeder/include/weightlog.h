@@ -0,0 +1,351 @@
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+/**
+ * Compressed, append-only log of timestamped weight and feed records in the
+ * LittleFS partition. Records are packed into fixed-size blocks, each
+ * protected by a CRC, so a torn write loses at most one block. Within a
+ * block, timestamps are stored as zig-zag varint delta-of-deltas and values
+ * as zig-zag varint deltas against the previous value of the same type;
+ * with readouts at a steady interval, a typical record takes 2-3 bytes.
+ *
+ * Two files of at most MAX_FILE_BLOCKS blocks are used: when the current
+ * file is full, it replaces the previous one. The partially filled block is
+ * kept in RAM and mirrored to a separate tail file on a schedule.
+ */
+class WeightLog {
+public:
+    /**
+     * Record types.
+     */
+    enum class Type : uint8_t {
+        RESERVOIR,
+        BOWL,
+        FEED,
+        MEAL,
+        COUNT
+    };
+
+    /**
+     * A decoded record.
+     */
+    struct Record {
+        /**
+         * UNIX time in seconds.
+         */
+        uint32_t time;
+
+        /**
+         * What the value represents.
+         */
+        Type type;
+
+        /**
+         * Weight in decigrams.
+         */
+        int32_t value;
+    };
+
+    /**
+     * Size of a block in bytes.
+     */
+    static constexpr size_t BLOCK_SIZE = 256;
+
+    /**
+     * Maximum number of blocks per file; two files are kept, so the log uses
+     * at most 384kB of the filesystem.
+     */
+    static constexpr size_t MAX_FILE_BLOCKS = 768;
+
+    /**
+     * Streaming reader over the whole log, oldest record first. Keeps the
+     * decoder state and a copy of the RAM block as it was when the reader
+     * was created; blocks are read from flash byte by byte, and each
+     * block's CRC is checked in a separate pass before it is decoded.
+     * Blocks that fail the check are skipped.
+     *
+     * A reader may be kept across appends: blocks flushed after it was
+     * created are not read, since their records are in the copy. If the
+     * files rotate meanwhile, the reader is aborted and returns no more
+     * records.
+     */
+    class Reader {
+    private:
+        friend class WeightLog;
+
+        /**
+         * Log being read.
+         */
+        const WeightLog &log;
+
+        /**
+         * File being read.
+         */
+        File file;
+
+        /**
+         * Source being read: 0 = previous file, 1 = current file, 2 = RAM
+         * block, 3 = done.
+         */
+        uint8_t source = 0;
+
+        /**
+         * Offset of the current block within the file.
+         */
+        uint32_t block_offset = 0;
+
+        /**
+         * Number of records remaining in the current block, 0 if a new block
+         * must be started.
+         */
+        uint8_t remaining = 0;
+
+        /**
+         * Read position within the RAM block.
+         */
+        size_t position = 0;
+
+        /**
+         * Decoder state for the current block.
+         */
+        uint32_t prev_time = 0;
+        int32_t prev_delta = 0;
+        int32_t prev_value[static_cast<size_t>(Type::COUNT)] = {};
+
+        /**
+         * Number of blocks skipped because of a bad CRC.
+         */
+        uint32_t corrupt = 0;
+
+        /**
+         * Copy of the RAM block and its record count and base time.
+         */
+        uint8_t block[BLOCK_SIZE];
+        uint8_t block_count;
+        uint32_t block_base_time;
+
+        /**
+         * Number of blocks in the current file when the reader was created.
+         */
+        uint32_t file_blocks;
+
+        /**
+         * Rotation count of the log when the reader was created.
+         */
+        uint32_t rotations;
+
+        /**
+         * Whether the files rotated while reading.
+         */
+        bool aborted = false;
+
+        /**
+         * Reads the next byte from the current source, or returns -1.
+         */
+        int read_byte();
+
+        /**
+         * Reads an unsigned varint from the current source.
+         */
+        bool read_varint(uint64_t &value);
+
+        /**
+         * Advances to the next block with a valid header and CRC, opening
+         * the next source as needed. Returns false when the log is
+         * exhausted.
+         */
+        bool start_block();
+
+    public:
+        explicit Reader(const WeightLog &log);
+
+        /**
+         * Decodes the next record. Returns false at the end of the log.
+         */
+        bool next(Record &record);
+
+        /**
+         * Returns the number of blocks skipped because of a bad CRC.
+         */
+        [[nodiscard]] uint32_t get_corrupt() const;
+
+        /**
+         * Returns whether reading stopped early because the files rotated.
+         */
+        [[nodiscard]] bool is_aborted() const;
+    };
+
+private:
+    /**
+     * Current file name.
+     */
+    static constexpr const char *FILE_NAME = "/wlog.bin";
+
+    /**
+     * Previous file name.
+     */
+    static constexpr const char *FILE_NAME_OLD = "/wlog.old";
+
+    /**
+     * Tail block file name.
+     */
+    static constexpr const char *FILE_NAME_TAIL = "/wlog.tail";
+
+    /**
+     * Temporary file name used while writing the tail block.
+     */
+    static constexpr const char *FILE_NAME_TEMP = "/wlog.tmp";
+
+    /**
+     * Block header layout: base time (4), payload length (2), record count
+     * (1), format marker (1).
+     */
+    static constexpr size_t HEADER_SIZE = 8;
+
+    /**
+     * Size of the CRC at the end of a block.
+     */
+    static constexpr size_t CRC_SIZE = 4;
+
+    /**
+     * Payload capacity of a block.
+     */
+    static constexpr size_t PAYLOAD_SIZE = BLOCK_SIZE - HEADER_SIZE - CRC_SIZE;
+
+    /**
+     * Format marker in the block header.
+     */
+    static constexpr uint8_t FORMAT = 0xD1;
+
+    /**
+     * Minimum interval between tail block saves.
+     */
+    static constexpr uint32_t TAIL_SAVE_MILLIS = 3600000;
+
+    /**
+     * Timestamps before this are considered unsynchronized.
+     */
+    static constexpr uint32_t MIN_VALID_TIME = 1577836800;
+
+    /**
+     * Block being filled.
+     */
+    uint8_t block[BLOCK_SIZE] = {};
+
+    /**
+     * Payload bytes used in the block being filled.
+     */
+    uint16_t length = 0;
+
+    /**
+     * Records in the block being filled.
+     */
+    uint8_t count = 0;
+
+    /**
+     * Time of the first record in the block being filled.
+     */
+    uint32_t base_time = 0;
+
+    /**
+     * Encoder state for the block being filled.
+     */
+    uint32_t prev_time = 0;
+    int32_t prev_delta = 0;
+    int32_t prev_value[static_cast<size_t>(Type::COUNT)] = {};
+
+    /**
+     * Whether the block in RAM differs from the tail file.
+     */
+    bool tail_dirty = false;
+
+    /**
+     * millis() at the last tail save.
+     */
+    uint32_t tail_millis = 0;
+
+    /**
+     * Number of records dropped because the clock was not set yet.
+     */
+    uint32_t dropped = 0;
+
+    /**
+     * Number of blocks in the current file.
+     */
+    uint32_t file_blocks = 0;
+
+    /**
+     * Incremented whenever the current file replaces the previous one.
+     */
+    uint32_t rotations = 0;
+
+    /**
+     * Encodes a record into buf, using and updating the encoder state only
+     * if update is set. Returns the number of bytes.
+     */
+    size_t encode(uint8_t *buf, uint32_t time, Type type, int32_t value, bool update);
+
+    /**
+     * Starts a new block with the given base time.
+     */
+    void reset_block(uint32_t time);
+
+    /**
+     * Writes the header and CRC of the RAM block.
+     */
+    void seal_block();
+
+    /**
+     * Appends the RAM block to the current file, rotating files as needed,
+     * and starts a new block.
+     */
+    void flush_block();
+
+    /**
+     * Returns whether the last block of the given file holds the records of
+     * the given sealed tail block, meaning the tail was already flushed.
+     */
+    static bool ends_with(const char *name, const uint8_t *tail);
+
+public:
+    /**
+     * Restores the partially filled block from the tail file. The filesystem
+     * must be mounted.
+     */
+    void begin();
+
+    /**
+     * Appends a record stamped with the current time. Dropped if the clock
+     * has not been set yet.
+     */
+    void append(Type type, float grams);
+
+    /**
+     * Appends a record with the given UNIX time, which must not be before
+     * that of the previous record.
+     */
+    void append(Type type, float grams, uint32_t time);
+
+    /**
+     * Returns whether the tail block should be saved.
+     */
+    [[nodiscard]] bool is_save_due() const;
+
+    /**
+     * Saves the partially filled block to the tail file.
+     */
+    bool save_tail();
+
+    /**
+     * Returns the number of records dropped because the clock was not set.
+     */
+    [[nodiscard]] uint32_t get_dropped() const;
+
+    /**
+     * Computes the CRC-32 (IEEE) of a buffer, continuing from crc, which
+     * should be 0 for the first buffer.
+     */
+    [[nodiscard]] static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t size);
+};
@@ -0,0 +1,75 @@
+#include "arc.h"
+
+#include <algorithm>
+
+void ProgressArc::draw_steps(Adafruit_GFX &gfx, const int16_t from, const int16_t to, const uint16_t color) const {
+    for (int16_t i = from; i < to; i++) {
+        const Spoke &a = spokes[i];
+        const Spoke &b = spokes[i + 1];
+        gfx.fillTriangle(
+            CENTER + a.inner_x, CENTER + a.inner_y,
+            CENTER + a.outer_x, CENTER + a.outer_y,
+            CENTER + b.outer_x, CENTER + b.outer_y,
+            color);
+        gfx.fillTriangle(
+            CENTER + a.inner_x, CENTER + a.inner_y,
+            CENTER + b.outer_x, CENTER + b.outer_y,
+            CENTER + b.inner_x, CENTER + b.inner_y,
+            color);
+    }
+}
+
+void ProgressArc::begin(Adafruit_GFX &gfx) {
+    for (int16_t i = 0; i <= NUM_STEPS; i++) {
+        const float degrees = static_cast<float>(i * SWEEP_DEGREES) / NUM_STEPS - SWEEP_DEGREES / 2.0f;
+        const float radians = degrees * static_cast<float>(M_PI) / 180.0f;
+        const float s = sinf(radians);
+        const float c = cosf(radians);
+        spokes[i].inner_x = static_cast<int8_t>(lroundf(s * RADIUS_INNER));
+        spokes[i].inner_y = static_cast<int8_t>(lroundf(-c * RADIUS_INNER));
+        spokes[i].outer_x = static_cast<int8_t>(lroundf(s * RADIUS_OUTER));
+        spokes[i].outer_y = static_cast<int8_t>(lroundf(-c * RADIUS_OUTER));
+    }
+    steps_filled = -1;
+
+    // The lowest points of the arc are the inner ends of the outermost
+    // spokes.
+    const int16_t bottom = CENTER + std::max(spokes[0].inner_y, spokes[NUM_STEPS].inner_y);
+    gfx.fillRect(CENTER - RADIUS_OUTER, CENTER - RADIUS_OUTER, 2 * RADIUS_OUTER + 1, bottom - (CENTER - RADIUS_OUTER) + 1, BACKGROUND);
+}
+
+void ProgressArc::invalidate() {
+    steps_filled = -1;
+}
+
+void ProgressArc::update(Adafruit_GFX &gfx, const int16_t progress, const uint16_t fill, const uint16_t track) {
+    // Hide the arc when there is no progress to show.
+    if (progress < 0) {
+        if (steps_filled >= 0) {
+            draw_steps(gfx, 0, NUM_STEPS, BACKGROUND);
+            steps_filled = -1;
+        }
+        return;
+    }
+
+    // A color change or a decrease in progress requires a full redraw.
+    int16_t target = static_cast<int16_t>(static_cast<int32_t>(progress) * NUM_STEPS / 1000);
+    if (target > NUM_STEPS) target = NUM_STEPS;
+    if (fill != color_fill || track != color_track || target < steps_filled) {
+        steps_filled = -1;
+        color_fill = fill;
+        color_track = track;
+    }
+    if (steps_filled < 0) {
+        draw_steps(gfx, target, NUM_STEPS, track);
+        draw_steps(gfx, 0, target, fill);
+        steps_filled = target;
+        return;
+    }
+
+    // Incremental update: only rasterize the newly covered steps.
+    if (target > steps_filled) {
+        draw_steps(gfx, steps_filled, target, fill);
+        steps_filled = target;
+    }
+}
@@ -0,0 +1,41 @@
+#include "blit.h"
+
+#include <algorithm>
+
+PanelBlit::PanelBlit(Adafruit_SPITFT &panel) : panel(panel) {
+}
+
+void PanelBlit::blit(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const uint16_t *pixels) {
+    panel.startWrite();
+    panel.setAddrWindow(x, y, w, h);
+    // writePixels() only reads the buffer when it's sent little-endian.
+    panel.writePixels(const_cast<uint16_t *>(pixels), static_cast<uint32_t>(w) * h);
+    panel.endWrite();
+}
+
+CanvasBlit::CanvasBlit(GFXcanvas16 &canvas) : canvas(canvas) {
+}
+
+void CanvasBlit::blit(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const uint16_t *pixels) {
+    const int16_t width = canvas.width();
+    const int16_t height = canvas.height();
+    const int16_t x0 = std::max<int16_t>(x, 0);
+    const int16_t x1 = std::min<int16_t>(x + w, width);
+    if (x0 >= x1) return;
+    uint16_t *buffer = canvas.getBuffer();
+    for (int16_t row = std::max<int16_t>(y, 0); row < std::min<int16_t>(y + h, height); row++) {
+        const uint16_t *source = pixels + static_cast<size_t>(row - y) * w + (x0 - x);
+        std::copy(source, source + (x1 - x0), buffer + static_cast<size_t>(row) * width + x0);
+    }
+}
+
+SPIPanelControl::SPIPanelControl(Adafruit_SPITFT &panel) : panel(panel) {
+}
+
+void SPIPanelControl::set_spi_speed(const uint32_t frequency) {
+    panel.setSPISpeed(frequency);
+}
+
+void SPIPanelControl::set_rotation(const uint8_t rotation) {
+    panel.setRotation(rotation);
+}
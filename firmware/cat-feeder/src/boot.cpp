@@ -0,0 +1,61 @@
+#include "boot.h"
+
+Boot boot;
+
+/**
+ * Phase names for serial and JSON output.
+ */
+static constexpr const char *PHASE_NAMES[] = {
+    "display", "setup", "first_frame", "first_measurement", "wifi", "mqtt", "discovery",
+};
+static_assert(sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]) == static_cast<size_t>(Boot::Phase::COUNT), "phase names");
+
+void Boot::mark(const Phase phase) {
+    const auto index = static_cast<size_t>(phase);
+    if (marked[index]) return;
+    phase_millis[index] = millis();
+    marked[index] = true;
+}
+
+[[nodiscard]] bool Boot::is_marked(const Phase phase) const {
+    return marked[static_cast<size_t>(phase)];
+}
+
+[[nodiscard]] uint32_t Boot::get_millis(const Phase phase) const {
+    return phase_millis[static_cast<size_t>(phase)];
+}
+
+[[nodiscard]] bool Boot::is_complete() const {
+    for (const bool m : marked) {
+        if (!m) return false;
+    }
+    return true;
+}
+
+[[nodiscard]] uint32_t Boot::get_completion_millis() const {
+    uint32_t latest = 0;
+    for (size_t i = 0; i < static_cast<size_t>(Phase::COUNT); i++) {
+        if (marked[i] && phase_millis[i] > latest) latest = phase_millis[i];
+    }
+    return latest;
+}
+
+void Boot::report(Print &out) {
+    for (size_t i = 0; i < static_cast<size_t>(Phase::COUNT); i++) {
+        if (!marked[i] || reported[i]) continue;
+        reported[i] = true;
+        out.printf("Boot: %s at %lums\n", PHASE_NAMES[i], static_cast<unsigned long>(phase_millis[i]));
+    }
+}
+
+void Boot::summarize(Formatter &f) const {
+    f.character('{');
+    bool first = true;
+    for (size_t i = 0; i < static_cast<size_t>(Phase::COUNT); i++) {
+        if (!marked[i]) continue;
+        if (!first) f.character(',');
+        first = false;
+        f.character('"').text(PHASE_NAMES[i]).text("\":").natural(phase_millis[i]);
+    }
+    f.character('}');
+}
@@ -0,0 +1,20 @@
+#include "console.h"
+#include "trace.h"
+
+const char *Console::poll() {
+    const Trace::Span span(Trace::Scope::CONSOLE);
+    while (Serial.available()) {
+        const int c = Serial.read();
+        if (c < 0) break;
+        if (c == '\r' || c == '\n') {
+            if (!length) continue;
+            line[length] = 0;
+            length = 0;
+            return line;
+        }
+        if (length < sizeof(line) - 1) {
+            line[length++] = static_cast<char>(c);
+        }
+    }
+    return nullptr;
+}
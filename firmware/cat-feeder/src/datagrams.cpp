@@ -0,0 +1,65 @@
+#include "datagrams.h"
+#include "hot.h"
+
+TelemetryBuffer::TelemetryBuffer(uint8_t *const storage, const size_t datagram_size) :
+    storage(storage),
+    datagram_size(datagram_size) {
+}
+
+bool TelemetryBuffer::swap() {
+    const uint8_t other = active ^ 1;
+    if (ready[other]) return false;
+    uint8_t *header = storage + active * datagram_size;
+    header[0] = 'C';
+    header[1] = 'F';
+    header[2] = VERSION;
+    header[3] = static_cast<uint8_t>((lengths[active] - HEADER_SIZE) / RECORD_SIZE);
+    header[4] = sequence;
+    header[5] = sequence >> 8;
+    header[6] = dropped;
+    header[7] = dropped >> 8;
+    sequence++;
+    ready[active] = true;
+    active = other;
+    lengths[active] = HEADER_SIZE;
+    return true;
+}
+
+void HOT(TelemetryBuffer::append)(const TelemetryEvent event, const uint8_t arg, const int32_t value, const uint32_t now_micros) {
+    if (lengths[active] + RECORD_SIZE > datagram_size && !swap()) {
+        dropped++;
+        return;
+    }
+    uint8_t *record = storage + active * datagram_size + lengths[active];
+    const auto raw = static_cast<uint32_t>(value);
+    record[0] = now_micros;
+    record[1] = now_micros >> 8;
+    record[2] = now_micros >> 16;
+    record[3] = now_micros >> 24;
+    record[4] = static_cast<uint8_t>(event);
+    record[5] = arg;
+    record[6] = raw;
+    record[7] = raw >> 8;
+    record[8] = raw >> 16;
+    record[9] = raw >> 24;
+    lengths[active] += RECORD_SIZE;
+}
+
+bool TelemetryBuffer::seal() {
+    return lengths[active] > HEADER_SIZE && swap();
+}
+
+[[nodiscard]] TelemetryBuffer::Datagram TelemetryBuffer::sealed() const {
+    // The active buffer is never sealed.
+    const uint8_t index = active ^ 1;
+    if (!ready[index]) return {nullptr, 0};
+    return {storage + index * datagram_size, lengths[index]};
+}
+
+void TelemetryBuffer::release() {
+    ready[active ^ 1] = false;
+}
+
+[[nodiscard]] uint32_t TelemetryBuffer::get_dropped() const {
+    return dropped;
+}
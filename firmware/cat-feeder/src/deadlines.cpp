@@ -0,0 +1,27 @@
+#include "deadlines.h"
+
+void Deadlines::enter(const size_t slot, const uint8_t subsystem, const uint32_t now, const uint32_t budget) {
+    Slot &s = slots[slot];
+
+    // Push the deadline out before naming the new subsystem, so an
+    // interrupt in between never blames it for the previous one's budget.
+    s.deadline = now + budget;
+    s.entered = now;
+    s.subsystem = subsystem;
+    s.armed = true;
+}
+
+[[nodiscard]] bool Deadlines::running_longer(const size_t slot, const uint32_t now, const uint32_t limit) const {
+    const Slot &s = slots[slot];
+    return s.armed && now - s.entered > limit;
+}
+
+bool Deadlines::expired(const size_t slot, const uint32_t now, const uint32_t grace, Expiry &expiry) const {
+    const Slot &s = slots[slot];
+    if (!s.armed) return false;
+    const auto overdue = static_cast<int32_t>(now - s.deadline);
+    if (overdue <= static_cast<int32_t>(grace)) return false;
+    expiry.subsystem = s.subsystem;
+    expiry.overdue_millis = static_cast<uint32_t>(overdue);
+    return true;
+}
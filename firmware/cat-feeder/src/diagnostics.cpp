@@ -0,0 +1,142 @@
+#include <unistd.h>
+#include "diagnostics.h"
+#include "hot.h"
+
+// Stack regions from the linker script. Core 0 runs on SCRATCH_Y, core 1 on
+// SCRATCH_X.
+extern "C" uint32_t __StackBottom;
+extern "C" uint32_t __StackTop;
+extern "C" uint32_t __StackOneBottom;
+extern "C" uint32_t __StackOneTop;
+
+// End of the heap, up to which sbrk() can grow it.
+extern "C" uint32_t __StackLimit;
+
+/**
+ * Pattern used to paint unused stack space.
+ */
+static constexpr uint32_t STACK_PAINT = 0xDEADBEEF;
+
+Diagnostics diagnostics;
+
+void HOT(Histogram::add)(const uint32_t micros) {
+    size_t bucket = micros ? 32 - __builtin_clz(micros) : 0;
+    if (bucket >= NUM_BUCKETS) bucket = NUM_BUCKETS - 1;
+    counts[bucket]++;
+}
+
+[[nodiscard]] uint32_t Histogram::get_count(const size_t bucket) const {
+    return counts[bucket];
+}
+
+[[nodiscard]] uint32_t Histogram::get_bound(const size_t bucket) {
+    if (bucket >= NUM_BUCKETS - 1) return 0;
+    return 1u << bucket;
+}
+
+[[nodiscard]] uint32_t Histogram::percentile(const Histogram &since, const uint32_t per_mille) const {
+    uint32_t total = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        total += counts[i] - since.counts[i];
+    }
+    if (!total) return 0;
+    const auto threshold = static_cast<uint32_t>((static_cast<uint64_t>(total) * per_mille + 999) / 1000);
+    uint32_t accum = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        accum += counts[i] - since.counts[i];
+        if (accum >= threshold) return get_bound(i);
+    }
+    return 0;
+}
+
+void HOT(Diagnostics::loop_mark)() {
+    const uint32_t now = micros();
+    if (loop_prev_micros) loop_histogram.add(now - loop_prev_micros);
+    loop_prev_micros = now;
+}
+
+static void stack_region(const unsigned core, uint32_t *&bottom, uint32_t *&top) {
+    if (core) {
+        bottom = &__StackOneBottom;
+        top = &__StackOneTop;
+    } else {
+        bottom = &__StackBottom;
+        top = &__StackTop;
+    }
+}
+
+void Diagnostics::paint_stack() {
+    const unsigned core = get_core_num();
+    uint32_t *bottom;
+    uint32_t *top;
+    stack_region(core, bottom, top);
+
+    // Leave some margin below our own frame.
+    auto *limit = static_cast<uint32_t *>(__builtin_frame_address(0)) - 32;
+    for (volatile uint32_t *p = bottom; p < limit; p++) {
+        *p = STACK_PAINT;
+    }
+    stack_painted[core] = true;
+}
+
+void Diagnostics::memory_poll() {
+    for (unsigned core = 0; core < 2; core++) {
+        if (!stack_painted[core]) continue;
+        uint32_t *bottom;
+        uint32_t *top;
+        stack_region(core, bottom, top);
+
+        // Only the words below the known high-water mark can change the
+        // result; restart at the bottom whenever a pass ends.
+        const uint32_t *limit = stack_low[core] ? stack_low[core] : top;
+        const volatile uint32_t *p = stack_cursor[core] ? stack_cursor[core] : bottom;
+        for (size_t n = 0; n < STACK_SCAN_WORDS; n++) {
+            if (p >= limit) {
+                p = bottom;
+                break;
+            }
+            if (*p != STACK_PAINT) {
+                stack_low[core] = const_cast<const uint32_t *>(p);
+                p = bottom;
+                break;
+            }
+            p++;
+        }
+        stack_cursor[core] = p;
+    }
+
+    if (millis() - heap_sample_millis >= HEAP_SAMPLE_MILLIS) {
+        heap_sample_millis = millis();
+        const uint32_t free = heap_free();
+        if (free < heap_min_free) heap_min_free = free;
+    }
+}
+
+[[nodiscard]] uint32_t Diagnostics::stack_used(const unsigned core) const {
+    if (!stack_low[core]) return 0;
+    uint32_t *bottom;
+    uint32_t *top;
+    stack_region(core, bottom, top);
+    return (top - stack_low[core]) * sizeof(uint32_t);
+}
+
+[[nodiscard]] uint32_t Diagnostics::stack_size(const unsigned core) {
+    uint32_t *bottom;
+    uint32_t *top;
+    stack_region(core, bottom, top);
+    return (top - bottom) * sizeof(uint32_t);
+}
+
+[[nodiscard]] uint32_t Diagnostics::heap_free() {
+    return rp2040.getFreeHeap();
+}
+
+[[nodiscard]] uint32_t Diagnostics::get_heap_min_free() const {
+    return heap_min_free;
+}
+
+[[nodiscard]] uint32_t Diagnostics::heap_largest_free() {
+    const auto *brk = static_cast<const uint8_t *>(sbrk(0));
+    const auto *limit = reinterpret_cast<const uint8_t *>(&__StackLimit);
+    return brk < limit ? limit - brk : 0;
+}
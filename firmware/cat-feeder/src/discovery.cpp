@@ -0,0 +1,154 @@
+#include "discovery.h"
+#include "trace.h"
+
+Discovery::Entity *Discovery::entities[MAX_ENTITIES] = {};
+size_t Discovery::count = 0;
+DiscoveryClient *Discovery::client = nullptr;
+
+DiscoveryClient::DiscoveryClient(Client &inner) : inner(inner) {
+}
+
+void DiscoveryClient::begin_hash() {
+    hash = 2166136261u;
+    hashing = true;
+}
+
+[[nodiscard]] uint32_t DiscoveryClient::end_hash() {
+    hashing = false;
+    return hash ? hash : 1;
+}
+
+int DiscoveryClient::connect(const IPAddress ip, const uint16_t port) {
+    return inner.connect(ip, port);
+}
+
+int DiscoveryClient::connect(const char *host, const uint16_t port) {
+    return inner.connect(host, port);
+}
+
+size_t DiscoveryClient::write(const uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t DiscoveryClient::write(const uint8_t *buf, const size_t size) {
+    if (!hashing) return inner.write(buf, size);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ buf[i]) * 16777619u;
+    }
+    return size;
+}
+
+int DiscoveryClient::available() {
+    return inner.available();
+}
+
+int DiscoveryClient::read() {
+    return inner.read();
+}
+
+int DiscoveryClient::read(uint8_t *buf, const size_t size) {
+    return inner.read(buf, size);
+}
+
+int DiscoveryClient::peek() {
+    return inner.peek();
+}
+
+void DiscoveryClient::flush() {
+    inner.flush();
+}
+
+void DiscoveryClient::stop() {
+    inner.stop();
+}
+
+uint8_t DiscoveryClient::connected() {
+    return inner.connected();
+}
+
+DiscoveryClient::operator bool() {
+    return static_cast<bool>(inner);
+}
+
+Discovery::Entity::Entity() : registered(Discovery::add(this)) {
+}
+
+[[nodiscard]] bool Discovery::Entity::is_retained() const {
+    return known_hash && hash == known_hash;
+}
+
+bool Discovery::add(Entity *entity) {
+    if (count >= MAX_ENTITIES) return false;
+    entities[count++] = entity;
+    return true;
+}
+
+Discovery::Discovery(HAMqtt &mqtt, DiscoveryClient &client) : mqtt(mqtt) {
+    Discovery::client = &client;
+}
+
+[[nodiscard]] uint32_t Discovery::hash(const HASerializer &serializer) {
+    // The serializer writes straight to the client, outside of any publish
+    // here, so nothing reaches the broker.
+    client->begin_hash();
+    serializer.flush();
+    return client->end_hash();
+}
+
+void Discovery::on_connected() {
+    mqtt.subscribe(STATUS_TOPIC);
+    cursor = 0;
+    round_active = true;
+}
+
+bool Discovery::on_message(const char *topic, const uint8_t *payload, const uint16_t length) {
+    if (strcmp(topic, STATUS_TOPIC)) return false;
+    if (length == 6 && !memcmp(payload, "online", 6)) resend();
+    return true;
+}
+
+void Discovery::resend() {
+    for (size_t i = 0; i < count; i++) {
+        entities[i]->known_hash = 0;
+        entities[i]->pending = true;
+    }
+    cursor = 0;
+    round_active = true;
+}
+
+void Discovery::poll(const bool busy) {
+    const Trace::Span span(Trace::Scope::DISCOVERY);
+    if (!round_active || busy || !mqtt.isConnected()) return;
+
+    for (size_t n = 0; n < count; n++) {
+        Entity *entity = entities[cursor];
+        cursor = (cursor + 1) % count;
+        if (!entity->pending) continue;
+        entity->pending = false;
+        const uint32_t start_micros = micros();
+        entity->announce();
+        const uint32_t elapsed = micros() - start_micros;
+        if (elapsed > max_announce_micros) max_announce_micros = elapsed;
+        if (entity->is_retained()) skipped++;
+        return;
+    }
+
+    // Every entity went out and we're still connected, so the broker holds
+    // the configs sent during this round.
+    for (size_t i = 0; i < count; i++) {
+        entities[i]->known_hash = entities[i]->hash;
+    }
+    round_active = false;
+}
+
+[[nodiscard]] uint32_t Discovery::get_max_announce_micros() const {
+    return max_announce_micros;
+}
+
+[[nodiscard]] uint32_t Discovery::get_skipped() const {
+    return skipped;
+}
+
+[[nodiscard]] bool Discovery::is_announcing() const {
+    return round_active;
+}
@@ -0,0 +1,117 @@
+#include "feedtrace.h"
+#include "format.h"
+
+/**
+ * JSON keys of the phases.
+ */
+static constexpr const char *PHASE_NAMES[FeedTrace::PHASES] = {
+    "pre_wait", "pre_reservoir", "pre_bowl", "run_sync", "run_a",
+    "run_b", "run_c", "post_wait", "post_bowl", "post_reservoir",
+};
+
+[[nodiscard]] uint32_t FeedTrace::Cycle::total_millis() const {
+    uint32_t total = 0;
+    for (const auto millis : phase_millis) {
+        total += millis;
+    }
+    return total;
+}
+
+void FeedTrace::begin() {
+    current = {};
+    current.start_millis = millis();
+    current.result = ABORTED;
+    active = true;
+}
+
+void FeedTrace::phase(const size_t phase, const uint32_t millis, const bool retried) {
+    if (!active || phase >= PHASES) return;
+    const uint32_t total = current.phase_millis[phase] + millis;
+    current.phase_millis[phase] = total > UINT16_MAX ? UINT16_MAX : total;
+    current.visited |= 1u << phase;
+    if (retried && current.retries[phase] < UINT8_MAX) current.retries[phase]++;
+}
+
+void FeedTrace::measured(const size_t phase, const float stddev) {
+    if (!active || phase >= PHASES) return;
+    const float centigrams = stddev * 100.0f + 0.5f;
+    current.stddev_centigrams[phase] = centigrams > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(centigrams);
+}
+
+void FeedTrace::set_result(const uint8_t result, const float grams) {
+    current.result = result;
+    current.decigrams = static_cast<int16_t>(lroundf(grams * 10.0f));
+}
+
+void FeedTrace::end() {
+    if (!active) return;
+    active = false;
+    cycles[next] = current;
+    next = (next + 1) % CYCLES;
+    if (count < CYCLES) count++;
+    sequence++;
+}
+
+[[nodiscard]] size_t FeedTrace::get_count() const {
+    return count;
+}
+
+[[nodiscard]] const FeedTrace::Cycle &FeedTrace::get_cycle(const size_t age) const {
+    return cycles[(next + CYCLES - 1 - age) % CYCLES];
+}
+
+[[nodiscard]] uint32_t FeedTrace::get_sequence() const {
+    return sequence;
+}
+
+[[nodiscard]] uint32_t FeedTrace::percentile(const size_t phase, const uint32_t per_mille) const {
+    // Insertion sort of the durations; the ring is small.
+    uint16_t sorted[CYCLES];
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!(cycles[i].visited & (1u << phase))) continue;
+        const uint16_t value = cycles[i].phase_millis[phase];
+        size_t j = n++;
+        for (; j > 0 && sorted[j - 1] > value; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = value;
+    }
+    if (!n) return 0;
+    size_t rank = (n * per_mille + 999) / 1000;
+    if (rank) rank--;
+    return sorted[rank];
+}
+
+size_t FeedTrace::summarize(char *buffer, const size_t size) const {
+    Formatter f(buffer, size);
+    f.text("{\"n\":").natural(count).text(",\"phases\":{");
+    for (size_t phase = 0; phase < PHASES; phase++) {
+        if (phase) f.character(',');
+        f.character('"').text(PHASE_NAMES[phase]).text("\":[").natural(percentile(phase, 500))
+            .character(',').natural(percentile(phase, 950)).character(']');
+    }
+    f.character('}');
+    if (count) {
+        const Cycle &last = get_cycle(0);
+        f.text(",\"last\":{\"result\":").natural(last.result).text(",\"g\":").decimal(static_cast<float>(last.decigrams) / 10.0f);
+        f.text(",\"ms\":[");
+        for (size_t phase = 0; phase < PHASES; phase++) {
+            if (phase) f.character(',');
+            f.natural(last.phase_millis[phase]);
+        }
+        f.text("],\"retries\":[");
+        for (size_t phase = 0; phase < PHASES; phase++) {
+            if (phase) f.character(',');
+            f.natural(last.retries[phase]);
+        }
+        f.text("],\"sd_cg\":[");
+        for (size_t phase = 0; phase < PHASES; phase++) {
+            if (phase) f.character(',');
+            f.natural(last.stddev_centigrams[phase]);
+        }
+        f.text("]}");
+    }
+    f.character('}');
+    return f.get_length();
+}
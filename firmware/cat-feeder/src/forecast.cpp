@@ -0,0 +1,85 @@
+#include "forecast.h"
+
+#include <cmath>
+
+void Forecaster::roll() {
+    const int32_t y = today;
+    today = 0;
+    cache_valid = false;
+    if (count < DAYS) {
+        // Still filling: the new total gets the next index.
+        sum_xy += static_cast<int32_t>(count) * y;
+        sum_y += y;
+        totals[(head + count) % DAYS] = y;
+        count++;
+        return;
+    }
+
+    // Full: drop the oldest (index 0), shift every remaining index down by
+    // one, and append the new total at index DAYS - 1.
+    const int32_t oldest = totals[head];
+    sum_y -= oldest;
+    sum_xy -= sum_y;
+    sum_xy += static_cast<int32_t>(DAYS - 1) * y;
+    sum_y += y;
+    totals[head] = y;
+    head = (head + 1) % DAYS;
+}
+
+void Forecaster::add(const float grams) {
+    today += static_cast<int32_t>(lroundf(grams * 10.0f));
+}
+
+void Forecaster::update(const int32_t delta_millis) {
+    millis_in_day += delta_millis;
+    while (millis_in_day >= DAY_MILLIS) {
+        millis_in_day -= DAY_MILLIS;
+        roll();
+    }
+}
+
+[[nodiscard]] float Forecaster::days_remaining(const float reservoir_grams, const float fallback_grams_per_day) {
+    if (!cache_valid || reservoir_grams != cache_reservoir_grams || fallback_grams_per_day != cache_fallback_grams_per_day) {
+        cache_days = compute_days_remaining(reservoir_grams, fallback_grams_per_day);
+        cache_reservoir_grams = reservoir_grams;
+        cache_fallback_grams_per_day = fallback_grams_per_day;
+        cache_valid = true;
+    }
+    return cache_days;
+}
+
+[[nodiscard]] float Forecaster::compute_days_remaining(const float reservoir_grams, const float fallback_grams_per_day) const {
+    if (reservoir_grams <= 0.0f) return 0.0f;
+
+    // Fit y = a + b*x through the daily totals, then project the rate for
+    // the next day (x = n) and its day-over-day change.
+    float rate = fallback_grams_per_day;
+    float slope = 0.0f;
+    if (count >= MIN_DAYS) {
+        const auto n = static_cast<float>(count);
+        const float sx = n * (n - 1.0f) / 2.0f;
+        const float sxx = (n - 1.0f) * n * (2.0f * n - 1.0f) / 6.0f;
+        const float sy = static_cast<float>(sum_y) / 10.0f;
+        const float sxy = static_cast<float>(sum_xy) / 10.0f;
+        slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+        const float intercept = (sy - slope * sx) / n;
+        rate = intercept + slope * n;
+    }
+
+    // Solve for d in sum(k = 0..d-1, rate + slope*k) = reservoir, i.e.
+    // slope/2 * d^2 + (rate - slope/2) * d - reservoir = 0.
+    if (fabsf(slope) < 0.01f) {
+        if (rate <= 0.0f) return MAX_DAYS;
+        return std::fmin(reservoir_grams / rate, MAX_DAYS);
+    }
+    const float b = rate - slope / 2.0f;
+    const float discriminant = b * b + 2.0f * slope * reservoir_grams;
+    if (discriminant < 0.0f) return MAX_DAYS;
+    const float days = (-b + std::sqrt(discriminant)) / slope;
+    if (days < 0.0f) return MAX_DAYS;
+    return std::fmin(days, MAX_DAYS);
+}
+
+[[nodiscard]] size_t Forecaster::get_count() const {
+    return count;
+}
@@ -0,0 +1,113 @@
+#include "format.h"
+
+#include <cmath>
+
+void Formatter::put(const char c) {
+    if (length + 1 >= size) return;
+    buffer[length++] = c;
+    buffer[length] = 0;
+}
+
+void Formatter::put_number(uint64_t magnitude, const bool negative, const bool plus, const uint8_t width, const bool zero_pad, const uint8_t decimals) {
+    // Render digits in reverse.
+    char digits[24];
+    uint8_t count = 0;
+    do {
+        if (decimals && count == decimals) digits[count++] = '.';
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude || (decimals && count <= decimals));
+
+    // Figure out padding.
+    const char sign = negative ? '-' : plus ? '+' : 0;
+    const uint8_t used = count + (sign ? 1 : 0);
+    uint8_t padding = width > used ? width - used : 0;
+    if (!zero_pad) {
+        for (; padding; padding--) put(' ');
+    }
+    if (sign) put(sign);
+    for (; padding; padding--) put('0');
+    while (count) put(digits[--count]);
+}
+
+Formatter::Formatter(char *buffer, const size_t size) : buffer(buffer), size(size) {
+    if (size) buffer[0] = 0;
+}
+
+Formatter &Formatter::text(const char *s) {
+    while (*s) put(*s++);
+    return *this;
+}
+
+Formatter &Formatter::character(const char c) {
+    put(c);
+    return *this;
+}
+
+Formatter &Formatter::integer(const int32_t value, const uint8_t width, const bool plus, const bool zero_pad) {
+    const bool negative = value < 0;
+    const uint64_t magnitude = negative ? -static_cast<int64_t>(value) : value;
+    put_number(magnitude, negative, plus, width, zero_pad, 0);
+    return *this;
+}
+
+Formatter &Formatter::natural(const uint32_t value) {
+    put_number(value, false, false, 0, false, 0);
+    return *this;
+}
+
+Formatter &Formatter::hex(const uint32_t value) {
+    put('0');
+    put('x');
+    for (int shift = 28; shift >= 0; shift -= 4) {
+        put("0123456789abcdef"[(value >> shift) & 0xF]);
+    }
+    return *this;
+}
+
+Formatter &Formatter::decimal(const float value, const uint8_t width, const bool plus) {
+    const bool negative = std::signbit(value);
+    if (!std::isfinite(value)) {
+        const char *s = std::isnan(value) ? "nan" : "inf";
+        const uint8_t used = 3 + (negative || plus ? 1 : 0);
+        for (uint8_t i = used; i < width; i++) put(' ');
+        if (negative || plus) put(negative ? '-' : '+');
+        return text(s);
+    }
+
+    // A float times ten is exact in double precision, so rounding here
+    // matches printf's rounding of the exact binary value.
+    const double tenths = std::fabs(std::rint(static_cast<double>(value) * 10.0));
+    put_number(static_cast<uint64_t>(tenths), negative, plus, width, false, 1);
+    return *this;
+}
+
+Formatter &Formatter::clock(const unsigned long seconds, const bool hours) {
+    unsigned long s = seconds;
+    unsigned long m = s / 60;
+    s -= m * 60;
+    if (hours) {
+        const unsigned long h = m / 60;
+        m -= h * 60;
+        put_number(h, false, false, 0, false, 0);
+        put(':');
+        put_number(m, false, false, 2, true, 0);
+    } else {
+        put_number(m, false, false, 0, false, 0);
+    }
+    put(':');
+    put_number(s, false, false, 2, true, 0);
+    return *this;
+}
+
+Formatter &Formatter::ip(const uint8_t address[4]) {
+    for (int i = 0; i < 4; i++) {
+        if (i) put('.');
+        put_number(address[i], false, false, 0, false, 0);
+    }
+    return *this;
+}
+
+[[nodiscard]] size_t Formatter::get_length() const {
+    return length;
+}
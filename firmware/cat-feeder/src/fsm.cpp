@@ -1,26 +1,32 @@
 #include "fsm.h"
+#include "format.h"
 #include "pins.h"
+#include "telemetry.h"
+#include "watchdog.h"
+
+void StateMachine::error_set(const ErrorCode code, const bool active) {
+    const uint32_t mask = active ? (error_mask | error_bit(code)) : (error_mask & ~error_bit(code));
+    if (mask != error_mask) {
+        error_mask = mask;
+        error_sequence++;
+    }
+}
 
-void StateMachine::error_reset() {
-    error_reservoir_stddev = false;
-    error_bowl_stddev = false;
-    error_loadcell_timeout = false;
-    error_loadcell_disagree = false;
-    error_loadcell_unreasonable = false;
-    error_limit_switch = false;
-    error_power_loss = false;
+[[nodiscard]] bool StateMachine::error_active(const ErrorCode code) const {
+    return error_mask & error_bit(code);
 }
 
-[[nodiscard]] const char *StateMachine::loadcell_limp_mode() const {
-    if (error_loadcell_timeout) return "Sensor timeout";
-    if (error_reservoir_stddev) return "Reservoir noisy";
-    if (error_bowl_stddev) return "Bowl noisy";
-    if (error_loadcell_disagree) return "Sensor disagree";
-    if (error_loadcell_unreasonable) return "Sensor sanity";
-    return nullptr;
+void StateMachine::error_reset() {
+    if (error_mask & ~ERROR_MASK_DERIVED) {
+        error_mask &= ERROR_MASK_DERIVED;
+        error_sequence++;
+    }
 }
 
-[[nodiscard]] StateMachine::FeedBlockReason StateMachine::need_to_feed() const {
+[[nodiscard]] ErrorCode StateMachine::loadcell_limp_mode() const {
+    return error_highest(error_mask & ERROR_MASK_LIMP);
+}
+[[nodiscard]] StateMachine::FeedBlockReason HOT(StateMachine::need_to_feed)() const {
     // Do not auto-feed during maintenance or fatal errors.
     switch (maintenance_mode) {
         case MaintenanceMode::OPERATIONAL: break;
@@ -37,12 +43,63 @@ void StateMachine::error_reset() {
     return FeedBlockReason::NOT_BLOCKED;
 }
 
+[[nodiscard]] int16_t StateMachine::state_progress() const {
+    unsigned long expected_millis;
+    switch (state) {
+        case State::FEED_PRE_MEASURE_WAIT:
+            expected_millis = FEED_PRE_MEASURE_MILLIS;
+            break;
+        case State::FEED_PRE_MEASURE_RESERVOIR:
+        case State::FEED_PRE_MEASURE_BOWL:
+        case State::FEED_POST_MEASURE_BOWL:
+        case State::FEED_POST_MEASURE_RESERVOIR:
+            return loadcell.get_progress();
+        case State::FEED_RUN_SYNC:
+        case State::FEED_RUN_A:
+        case State::FEED_RUN_B:
+            // The limit switch toggles about twice per motor cycle.
+            expected_millis = FEED_RUN_LIMP_MILLIS / 2;
+            break;
+        case State::FEED_RUN_C:
+            expected_millis = FEED_RUN_POST_MILLIS;
+            break;
+        case State::FEED_POST_WAIT:
+            expected_millis = FEED_TO_MEASURE_MILLIS;
+            break;
+        default:
+            return 0;
+    }
+    if (millis_since_transition >= expected_millis) return 999;
+    return static_cast<int16_t>(millis_since_transition * 1000 / expected_millis);
+}
+
+[[nodiscard]] bool StateMachine::is_feed_state(const State state) {
+    return state >= State::FEED_PRE_MEASURE_WAIT;
+}
+
+[[nodiscard]] size_t StateMachine::feed_phase(const State state) {
+    static_assert(static_cast<size_t>(State::FEED_POST_MEASURE_RESERVOIR) - static_cast<size_t>(State::FEED_PRE_MEASURE_WAIT) + 1 == FeedTrace::PHASES,
+        "feed trace phases must match the feed states");
+    return static_cast<size_t>(state) - static_cast<size_t>(State::FEED_PRE_MEASURE_WAIT);
+}
+
 void StateMachine::transition(State new_state) {
     if (new_state == state) {
         state_retries++;
     } else {
         state_retries = 0;
     }
+
+    // Trace feed cycles.
+    if (is_feed_state(state)) {
+        feed_trace.phase(feed_phase(state), millis_since_transition, new_state == state);
+        if (!is_feed_state(new_state)) feed_trace.end();
+    } else if (is_feed_state(new_state)) {
+        feed_trace.begin();
+    }
+    telemetry.record(Telemetry::Event::STATE, static_cast<uint8_t>(new_state), static_cast<int32_t>(millis_since_transition));
+    trace.record(Trace::Event::STATE, static_cast<uint8_t>(new_state), static_cast<int32_t>(millis_since_transition));
+    watchdog.set_state(static_cast<uint8_t>(new_state), is_feed_state(new_state));
     Serial.printf("Transition to %d after %d, retry %d, maint %d\n", static_cast<int>(new_state), static_cast<int>(millis_since_transition), static_cast<int>(state_retries), static_cast<int>(maintenance_mode));
     switch (new_state) {
         case State::IDLE_TARE_RESERVOIR:
@@ -69,8 +126,8 @@ void StateMachine::transition(State new_state) {
 }
 
 bool StateMachine::handle_loadcell_readout() {
-    if (error_loadcell_timeout || millis_since_transition > 10000) {
-        error_loadcell_timeout = true;
+    if (error_active(ErrorCode::SENSOR_TIMEOUT) || millis_since_transition > 10000) {
+        error_set(ErrorCode::SENSOR_TIMEOUT);
         return true;
     }
     if (loadcell.is_busy()) return false;
@@ -79,20 +136,35 @@ bool StateMachine::handle_loadcell_readout() {
             reservoir_mean.set(loadcell.get_mean(), true);
             reservoir_stddev.set(loadcell.get_stddev(), true);
             millis_since_reservoir_read = 0;
+            if (state != State::IDLE_TARE_RESERVOIR) {
+                history.add(History::Series::RESERVOIR, loadcell.get_mean());
+                weight_log.append(WeightLog::Type::RESERVOIR, loadcell.get_mean());
+            }
             break;
         case Loadcell::Sensor::BOWL:
             bowl_mean.set(loadcell.get_mean(), true);
             bowl_stddev.set(loadcell.get_stddev(), true);
             millis_since_bowl_read = 0;
+
+            // Only regular readouts go to the meal detector; feeds inform it
+            // of the dispensed amount separately.
+            if (state == State::IDLE_MEASURE_BOWL) {
+                meals.sample(loadcell.get_mean(), loadcell.get_stddev(), millis());
+            }
+            if (state != State::IDLE_TARE_BOWL) {
+                history.add(History::Series::BOWL, loadcell.get_mean());
+                weight_log.append(WeightLog::Type::BOWL, loadcell.get_mean());
+            }
             break;
     }
+    if (is_feed_state(state)) feed_trace.measured(feed_phase(state), loadcell.get_stddev());
     return true;
 }
 
 float StateMachine::estimate_dispensed_weight_grams() {
 
     // If the loadcell didn't work right before, use fallback value.
-    if (loadcell_limp_mode()) {
+    if (loadcell_limp_mode() != ErrorCode::NONE) {
         return FEED_ASSUMED_WEIGHT_GRAMS;
     }
 
@@ -106,14 +178,14 @@ float StateMachine::estimate_dispensed_weight_grams() {
 
         // If the sensors disagree by too much, fail.
         if (abs(dispensed_reservoir - dispensed_bowl) > FEED_MAX_DISAGREE_GRAMS) {
-            error_loadcell_disagree = true;
+            error_set(ErrorCode::SENSOR_DISAGREE);
             return FEED_ASSUMED_WEIGHT_GRAMS;
         }
         dispensed = (dispensed_reservoir + dispensed_bowl) / 2.0f;
 
         // Check reasonableness.
         if (dispensed < -2.0f || dispensed > FEED_ASSUMED_WEIGHT_GRAMS * 2.0f) {
-            error_loadcell_unreasonable = true;
+            error_set(ErrorCode::SENSOR_SANITY);
             return FEED_ASSUMED_WEIGHT_GRAMS;
         }
 
@@ -128,7 +200,7 @@ float StateMachine::estimate_dispensed_weight_grams() {
         // which is about +/-25%; give a bit more tolerance to avoid nuisance
         // errors.
         if (dispensed < FEED_ASSUMED_WEIGHT_GRAMS * 0.5f || dispensed > FEED_ASSUMED_WEIGHT_GRAMS * 1.5f) {
-            error_loadcell_unreasonable = true;
+            error_set(ErrorCode::SENSOR_SANITY);
             return FEED_ASSUMED_WEIGHT_GRAMS;
         }
 
@@ -156,6 +228,11 @@ void StateMachine::complete_feed() {
         }
     }
 
+    // Record for the reservoir forecast and the meal detector.
+    forecaster.add(dispensed_weight_grams);
+    meals.dispensed(dispensed_weight_grams);
+    weight_log.append(WeightLog::Type::FEED, dispensed_weight_grams);
+
     // Update deficit.
     int dispensed_weight_mg = static_cast<int>(dispensed_weight_grams * 1000.0f);
     deficit_mg -= dispensed_weight_mg;
@@ -166,13 +243,15 @@ void StateMachine::complete_feed() {
     feed_report.result = FeedResult::SUCCESS;
     feed_report.arg = dispensed_weight_mg;
     feed_report.millis = millis();
+    feed_trace.set_result(static_cast<uint8_t>(FeedResult::SUCCESS), dispensed_weight_grams);
     mqtt_last_feed.set(dispensed_weight_grams, true);
     transition(State::IDLE);
 }
 
 void StateMachine::PublishedFloatSensor::set(const float new_value, const bool force) {
+    const bool changed = new_value != value;
     value = new_value;
-    mqtt.setValue(value, force);
+    if (mqtt.setValue(value, force) && (changed || force)) diagnostics.mqtt_published();
 }
 
 StateMachine::PublishedFloatSensor::PublishedFloatSensor(const char *unique_id, const char *name, const char *unit, const char *icon, const int16_t expiry, const HABaseDeviceType::NumberPrecision precision) : mqtt(unique_id, precision) {
@@ -187,8 +266,9 @@ StateMachine::PublishedFloatSensor::PublishedFloatSensor(const char *unique_id,
 }
 
 void StateMachine::PublishedBinarySensor::set(const bool new_value, const bool force) {
+    const bool changed = new_value != value;
     value = new_value;
-    mqtt.setState(value, force);
+    if (mqtt.setState(value, force) && (changed || force)) diagnostics.mqtt_published();
 }
 
 StateMachine::PublishedBinarySensor::PublishedBinarySensor(const char *unique_id, const char *name, const char *icon, const int16_t expiry) : mqtt(unique_id) {
@@ -207,6 +287,19 @@ void StateMachine::begin() {
     pinMode(PIN_MOTOR, OUTPUT);
     digitalWrite(PIN_MOTOR, LOW);
 
+    // Restore history from flash.
+    history.load();
+    weight_log.begin();
+
+    // Initialize error set sensor.
+    mqtt_errors.setName("Active errors");
+    mqtt_errors.setIcon("mdi:alert");
+
+    // Initialize feed trace sensor.
+    mqtt_feed_trace.setName("Feed cycle duration");
+    mqtt_feed_trace.setIcon("mdi:timer-cog");
+    mqtt_feed_trace.setUnitOfMeasurement("s");
+
     // Initialize loadcell driver.
     loadcell.begin();
     loadcell.set_tare_raw(Loadcell::Sensor::RESERVOIR, -754589);
@@ -216,9 +309,13 @@ void StateMachine::begin() {
     update_prev_millis = millis();
 }
 
-void StateMachine::update() {
+void HOT(StateMachine::update)() {
+    const Trace::Span span(Trace::Scope::FSM_UPDATE);
+
     // Update owned lower-level drivers.
+    const uint32_t loadcell_start_micros = hot_bench.enter();
     loadcell.update();
+    hot_bench.leave(HotBench::Probe::LOADCELL_UPDATE, loadcell_start_micros);
 
     // Figure out time delta.
     const unsigned long current_millis = millis();
@@ -233,6 +330,11 @@ void StateMachine::update() {
     }
     mqtt_deficit.set(static_cast<float>(deficit_mg) / 1000.0f);
 
+    // Update consumption forecast and meal day clocks.
+    forecaster.update(delta_millis);
+    meals.update(delta_millis);
+    history.update(delta_millis);
+
     // Update MQTT status.
     bool force_update = false;
     if (millis_since_mqtt_string_update > 5000) {
@@ -267,9 +369,44 @@ void StateMachine::update() {
     }
     mqtt_maintenance.set(maintenance_mode == MaintenanceMode::MAINTENANCE, force_update);
     mqtt_jammed.set(maintenance_mode == MaintenanceMode::JAMMED, force_update);
-    auto er = get_error_report();
-    mqtt_error.set(er.message ? er.message : "No error", force_update);
+    error_set(ErrorCode::JAMMED, maintenance_mode == MaintenanceMode::JAMMED);
+    error_set(ErrorCode::JAMMED_MAYBE, feed_jammed_retries);
+    error_set(ErrorCode::RESERVOIR_LOW, reservoir_mean.get() < 250.0f);
+    const float days_remaining = forecaster.days_remaining(reservoir_mean.get(), static_cast<float>(grams_per_day));
+    mqtt_days_remaining.set(days_remaining, force_update);
+    mqtt_forecast_horizon.set(static_cast<float>(forecast_horizon_days), force_update);
+    error_set(ErrorCode::REFILL_SOON, days_remaining < static_cast<float>(forecast_horizon_days));
+    if (force_update || error_sequence != error_sequence_published) {
+        error_sequence_published = error_sequence;
+        mqtt_error.set(error_highest(error_mask), force_update);
+        publish_error_set();
+    }
     mqtt_grams_per_day.set(grams_per_day, force_update);
+    mqtt_eating.set(meals.is_eating(), force_update);
+    const bool new_meal = meals.get_sequence() != meals_sequence_published;
+    if (force_update || new_meal) {
+        meals_sequence_published = meals.get_sequence();
+        if (meals.get_count()) {
+            const auto &meal = meals.get_meal(0);
+            if (new_meal) {
+                history.add(History::Series::INTAKE, meal.grams);
+                weight_log.append(WeightLog::Type::MEAL, meal.grams);
+            }
+            mqtt_last_meal.set(meal.grams, force_update);
+
+            // A meal between two stable readouts has no meaningful
+            // duration; keep reporting the last one that was timed.
+            if (const auto *timed = meals.get_last_timed()) {
+                mqtt_last_meal_rate.set(timed->rate(), force_update);
+                mqtt_last_meal_duration.set(static_cast<float>(timed->duration_millis) / 60000.0f, force_update);
+            }
+        }
+    }
+    if (force_update || feed_trace.get_sequence() != feed_trace_sequence_published) {
+        publish_feed_trace();
+    }
+    mqtt_eaten_today.set(meals.get_today(), force_update);
+    mqtt_eaten_yesterday.set(meals.get_yesterday(), force_update);
 
     // Update regular timers.
     millis_since_reservoir_read += delta_millis;
@@ -279,6 +416,11 @@ void StateMachine::update() {
 
     // Read limit switch.
     bool limit = digitalRead(PIN_LIMIT) == HIGH;
+    if (limit != prev_limit) {
+        telemetry.record(Telemetry::Event::LIMIT, limit, static_cast<int32_t>(millis_since_transition));
+        trace.record(Trace::Event::LIMIT, limit);
+        prev_limit = limit;
+    }
 
     // Handle state machine.
     bool motor = false;
@@ -290,6 +432,16 @@ void StateMachine::update() {
                 break;
             }
 
+            // Mirror the history to flash when the motor is idle.
+            if (history.is_save_due()) {
+                history.save();
+                break;
+            }
+            if (weight_log.is_save_due()) {
+                weight_log.save_tail();
+                break;
+            }
+
             // Check if we need to sample one of our sensors. Read sensors
             // continuously while in maintenance mode, otherwise read once
             // every five minutes.
@@ -297,7 +449,9 @@ void StateMachine::update() {
             if (maintenance_mode == MaintenanceMode::MAINTENANCE) {
                 sensor_read_cooldown = 0;
             }
-            if (millis_since_reservoir_read > millis_since_bowl_read) {
+            if (meals.is_eating() && millis_since_bowl_read > MEAL_READ_MILLIS) {
+                transition(State::IDLE_MEASURE_BOWL);
+            } else if (millis_since_reservoir_read > millis_since_bowl_read) {
                 if (millis_since_reservoir_read > sensor_read_cooldown) {
                     transition(State::IDLE_MEASURE_RESERVOIR);
                 }
@@ -330,13 +484,13 @@ void StateMachine::update() {
             break;
 
         case State::FEED_PRE_MEASURE_WAIT:
-            if (millis_since_transition > 2000) {
+            if (millis_since_transition > FEED_PRE_MEASURE_MILLIS) {
                 transition(State::FEED_PRE_MEASURE_RESERVOIR);
             }
             break;
 
         case State::FEED_PRE_MEASURE_RESERVOIR:
-            if (!loadcell_limp_mode()) {
+            if (loadcell_limp_mode() == ErrorCode::NONE) {
                 if (!handle_loadcell_readout()) {
                     break;
                 }
@@ -355,10 +509,11 @@ void StateMachine::update() {
                     feed_report.result = FeedResult::SENSOR_RETRY;
                     feed_report.arg = feed_sensor_retries;
                     feed_report.millis = millis();
+                    feed_trace.set_result(static_cast<uint8_t>(FeedResult::SENSOR_RETRY), 0.0f);
                     transition(State::IDLE);
                     break;
                 }
-                error_reservoir_stddev = true;
+                error_set(ErrorCode::RESERVOIR_NOISY);
             }
 
             // Limp mode.
@@ -366,7 +521,7 @@ void StateMachine::update() {
             break;
 
         case State::FEED_PRE_MEASURE_BOWL:
-            if (!loadcell_limp_mode()) {
+            if (loadcell_limp_mode() == ErrorCode::NONE) {
                 if (!handle_loadcell_readout()) {
                     break;
                 }
@@ -385,10 +540,11 @@ void StateMachine::update() {
                     feed_report.result = FeedResult::SENSOR_RETRY;
                     feed_report.arg = feed_sensor_retries;
                     feed_report.millis = millis();
+                    feed_trace.set_result(static_cast<uint8_t>(FeedResult::SENSOR_RETRY), 0.0f);
                     transition(State::IDLE);
                     break;
                 }
-                error_bowl_stddev = true;
+                error_set(ErrorCode::BOWL_NOISY);
             }
 
             // Limp mode.
@@ -397,7 +553,7 @@ void StateMachine::update() {
 
         case State::FEED_RUN_SYNC:
             motor = true;
-            if (!error_limit_switch) {
+            if (!error_active(ErrorCode::MOTOR_TIMEOUT)) {
                 if (!limit) {
                     transition(State::FEED_RUN_A);
                     break;
@@ -413,7 +569,7 @@ void StateMachine::update() {
             }
 
             // Error. Assume motor already moved a bunch and continue.
-            error_limit_switch = true;
+            error_set(ErrorCode::MOTOR_TIMEOUT);
             transition(State::FEED_POST_WAIT);
             break;
 
@@ -428,7 +584,7 @@ void StateMachine::update() {
             }
 
             // Error. Assume motor already moved a bunch and continue.
-            error_limit_switch = true;
+            error_set(ErrorCode::MOTOR_TIMEOUT);
             transition(State::FEED_POST_WAIT);
             break;
 
@@ -443,7 +599,7 @@ void StateMachine::update() {
             }
 
             // Error. Assume motor already moved a bunch and continue.
-            error_limit_switch = true;
+            error_set(ErrorCode::MOTOR_TIMEOUT);
             transition(State::FEED_POST_WAIT);
             break;
 
@@ -461,7 +617,7 @@ void StateMachine::update() {
             break;
 
         case State::FEED_POST_MEASURE_BOWL:
-            if (!loadcell_limp_mode()) {
+            if (loadcell_limp_mode() == ErrorCode::NONE) {
                 if (!handle_loadcell_readout()) {
                     break;
                 }
@@ -476,7 +632,7 @@ void StateMachine::update() {
             break;
 
         case State::FEED_POST_MEASURE_RESERVOIR:
-            if (!loadcell_limp_mode()) {
+            if (loadcell_limp_mode() == ErrorCode::NONE) {
                 if (!handle_loadcell_readout()) {
                     break;
                 }
@@ -489,7 +645,7 @@ void StateMachine::update() {
                     transition(state);
                     break;
                 }
-                error_reservoir_stddev = true;
+                error_set(ErrorCode::RESERVOIR_NOISY);
             }
 
             // Limp mode.
@@ -499,6 +655,11 @@ void StateMachine::update() {
 
     // Update motor state.
     digitalWrite(PIN_MOTOR, motor);
+    if (motor != prev_motor) {
+        telemetry.record(Telemetry::Event::MOTOR, motor, static_cast<int32_t>(millis_since_transition));
+        trace.record(Trace::Event::MOTOR, motor);
+        prev_motor = motor;
+    }
 }
 
 void StateMachine::enter_maintenance() {
@@ -511,12 +672,17 @@ void StateMachine::enter_maintenance() {
     return maintenance_mode == MaintenanceMode::MAINTENANCE;
 }
 
+[[nodiscard]] bool StateMachine::feeding() const {
+    return mqtt_feeding.get();
+}
+
 void StateMachine::tare_reservoir() {
     maintenance_mode = MaintenanceMode::MAINTENANCE;
     transition(State::IDLE_TARE_RESERVOIR_WAIT);
 }
 
 void StateMachine::tare_bowl() {
+    meals.reset_baseline();
     maintenance_mode = MaintenanceMode::MAINTENANCE;
     transition(State::IDLE_TARE_BOWL);
 }
@@ -550,6 +716,14 @@ void StateMachine::set_grams_per_day(int32_t new_grams_per_day) {
     grams_per_day = new_grams_per_day;
 }
 
+[[nodiscard]] int32_t StateMachine::get_forecast_horizon() const {
+    return forecast_horizon_days;
+}
+
+void StateMachine::set_forecast_horizon(int32_t new_days) {
+    forecast_horizon_days = new_days;
+}
+
 /**
  * Returns a string representation of the current high-level state.
  */
@@ -558,41 +732,39 @@ void StateMachine::get_state_report(StateReport &report) const {
     report.detail1[0] = 0;
     report.detail2[0] = 0;
     report.large = false;
+    report.progress = -1;
     int progress = 0;
     switch (state) {
         case State::IDLE:
         case State::IDLE_MEASURE_RESERVOIR:
         case State::IDLE_MEASURE_BOWL:
             if (feed_report.result == FeedResult::SUCCESS && (millis() - feed_report.millis) < 10000) {
-                strcpy(report.header, "Feed result");
-                snprintf(report.detail1, sizeof(report.detail1), "R %+7.1fg %+7.1fg", feed_reservoir_pre, feed_reservoir_post - feed_reservoir_pre);
-                snprintf(report.detail2, sizeof(report.detail2), "B %+7.1fg %+7.1fg", feed_bowl_pre, feed_bowl_post - feed_bowl_pre);
+                strcpy(report.header, text(Text::FEED_RESULT));
+                Formatter(report.detail1).text("R ").decimal(feed_reservoir_pre, 7, true).text("g ").decimal(feed_reservoir_post - feed_reservoir_pre, 7, true).character('g');
+                Formatter(report.detail2).text("B ").decimal(feed_bowl_pre, 7, true).text("g ").decimal(feed_bowl_post - feed_bowl_pre, 7, true).character('g');
                 return;
             }
             switch (need_to_feed()) {
                 case FeedBlockReason::MAINTENANCE:
-                    strcpy(report.header, "Maintenance");
+                    strcpy(report.header, text(Text::MAINTENANCE));
                     goto details_maintenance;
                 case FeedBlockReason::JAMMED:
-                    strcpy(report.detail1, "JAMMED");
+                    strcpy(report.detail1, text(Text::JAMMED));
                     report.large = true;
                     return;
                 case FeedBlockReason::COOLDOWN: {
-                    strcpy(report.header, "Cooldown");
+                    strcpy(report.header, text(Text::COOLDOWN));
                     unsigned long remain = FEED_COOLDOWN_MILLIS - millis_since_feed_attempt;
                     if (remain < FEED_COOLDOWN_MILLIS) {
-                        unsigned long seconds = remain / 1000;
-                        unsigned long minutes = seconds / 60;
-                        seconds -= minutes * 60;
-                        snprintf(report.detail1, sizeof(report.detail1), "%d:%02d", static_cast<int>(minutes), static_cast<int>(seconds));
+                        Formatter(report.detail1).clock(remain / 1000, false);
                     }
                     report.large = true;
                     return;
                 }
                 case FeedBlockReason::DEFICIT: {
-                    strcpy(report.header, "Deficit");
+                    strcpy(report.header, text(Text::DEFICIT));
                     int deficit = deficit_mg - deficit_threshold_mg;
-                    snprintf(report.detail1, sizeof(report.detail1), "%dmg", deficit);
+                    Formatter(report.detail1).integer(deficit).text("mg");
                     report.large = true;
                     return;
                 }
@@ -602,14 +774,14 @@ void StateMachine::get_state_report(StateReport &report) const {
             }
         case State::IDLE_TARE_RESERVOIR_WAIT:
         case State::IDLE_TARE_RESERVOIR:
-            strcpy(report.header, "Tare reservoir");
+            strcpy(report.header, text(Text::TARE_RESERVOIR));
             goto details_maintenance;
         case State::IDLE_TARE_BOWL:
-            strcpy(report.header, "Tare bowl");
+            strcpy(report.header, text(Text::TARE_BOWL));
             goto details_maintenance;
         details_maintenance:
-            snprintf(report.detail1, sizeof(report.detail1), "%+7.1fg +/-%6.1fg", reservoir_mean.get(), reservoir_stddev.get());
-            snprintf(report.detail2, sizeof(report.detail2), "%+7.1fg +/-%6.1fg", bowl_mean.get(), bowl_stddev.get());
+            Formatter(report.detail1).decimal(reservoir_mean.get(), 7, true).text("g +/-").decimal(reservoir_stddev.get(), 6).character('g');
+            Formatter(report.detail2).decimal(bowl_mean.get(), 7, true).text("g +/-").decimal(bowl_stddev.get(), 6).character('g');
             return;
         case State::FEED_PRE_MEASURE_WAIT:
             progress = 0;
@@ -642,31 +814,108 @@ void StateMachine::get_state_report(StateReport &report) const {
             progress = 9;
             goto details_feeding;
         details_feeding:
-            strcpy(report.header, "Feeding");
-            for (int i = 0; i < 10; i++) {
-                report.detail1[i] = i < progress ? '#' : '-';
-            }
-            report.detail1[10] = 0;
+            strcpy(report.header, text(Text::FEEDING));
+            report.progress = static_cast<int16_t>((progress * 1000 + state_progress()) / 10);
+            Formatter(report.detail1).integer(report.progress / 10).character('%');
             report.large = true;
             return;
     }
 }
 
+[[nodiscard]] const Loadcell::Stats &StateMachine::get_loadcell_stats() const {
+    return loadcell.get_stats();
+}
+
 [[nodiscard]] const StateMachine::FeedReport &StateMachine::get_feed_report() const {
     return feed_report;
 }
 
 [[nodiscard]] StateMachine::ErrorReport StateMachine::get_error_report() const {
-    // Errors.
-    if (error_limit_switch) return {"Motor timeout", ErrorSeverity::ERROR};
-    if (const auto mode = loadcell_limp_mode()) return {mode, ErrorSeverity::ERROR};
-    if (error_power_loss) return {"Power loss", ErrorSeverity::ERROR};
-    if (maintenance_mode == MaintenanceMode::JAMMED) return { "Jammed/empty", ErrorSeverity::ERROR };
-
-    // Warnings.
-    if (feed_jammed_retries) return { "Jammed/empty?", ErrorSeverity::WARNING };
-    if (reservoir_mean.get() < 250.0f) return { "Reservoir low", ErrorSeverity::WARNING };
-
-    // Operational.
-    return { nullptr, ErrorSeverity::OKAY };
+    const ErrorCode code = error_highest(error_mask);
+    if (code == ErrorCode::NONE) return { code, ErrorSeverity::OKAY };
+    if (error_bit(code) & ERROR_MASK_WARNING) return { code, ErrorSeverity::WARNING };
+    return { code, ErrorSeverity::ERROR };
+}
+
+[[nodiscard]] uint32_t StateMachine::get_error_sequence() const {
+    return error_sequence;
+}
+
+[[nodiscard]] uint32_t StateMachine::get_error_mask() const {
+    return error_mask;
+}
+
+[[nodiscard]] const History &StateMachine::get_history() const {
+    return history;
+}
+
+[[nodiscard]] const WeightLog &StateMachine::get_weight_log() const {
+    return weight_log;
+}
+
+[[nodiscard]] const FeedTrace &StateMachine::get_feed_trace() const {
+    return feed_trace;
+}
+
+bool StateMachine::get_metric(const size_t index, Metric &metric) const {
+    static constexpr const PublishedFloatSensor StateMachine::*FLOATS[] = {
+        &StateMachine::reservoir_mean,
+        &StateMachine::reservoir_stddev,
+        &StateMachine::bowl_mean,
+        &StateMachine::bowl_stddev,
+        &StateMachine::mqtt_deficit,
+        &StateMachine::mqtt_last_feed,
+        &StateMachine::mqtt_grams_per_day,
+        &StateMachine::mqtt_last_meal,
+        &StateMachine::mqtt_last_meal_rate,
+        &StateMachine::mqtt_last_meal_duration,
+        &StateMachine::mqtt_eaten_today,
+        &StateMachine::mqtt_eaten_yesterday,
+        &StateMachine::mqtt_days_remaining,
+        &StateMachine::mqtt_forecast_horizon,
+    };
+    static constexpr const PublishedBinarySensor StateMachine::*BINARIES[] = {
+        &StateMachine::mqtt_feeding,
+        &StateMachine::mqtt_maintenance,
+        &StateMachine::mqtt_jammed,
+        &StateMachine::mqtt_eating,
+    };
+    static constexpr size_t NUM_FLOATS = sizeof(FLOATS) / sizeof(FLOATS[0]);
+    static constexpr size_t NUM_BINARIES = sizeof(BINARIES) / sizeof(BINARIES[0]);
+    if (index < NUM_FLOATS) {
+        const auto &sensor = this->*FLOATS[index];
+        metric = {sensor.mqtt.uniqueId(), sensor.get()};
+        return true;
+    }
+    if (index < NUM_FLOATS + NUM_BINARIES) {
+        const auto &sensor = this->*BINARIES[index - NUM_FLOATS];
+        metric = {sensor.mqtt.uniqueId(), sensor.get() ? 1.0f : 0.0f};
+        return true;
+    }
+    return false;
+}
+
+void StateMachine::publish_error_set() {
+    char value[256];
+    Formatter f(value);
+    uint32_t mask = error_mask;
+    if (!mask) f.text(text(ErrorCode::NONE));
+    while (mask) {
+        const ErrorCode code = error_highest(mask);
+        mask &= ~error_bit(code);
+        f.text(text(code));
+        if (mask) f.text(", ");
+    }
+    if (mqtt_errors.setValue(value)) diagnostics.mqtt_published();
+}
+
+void StateMachine::publish_feed_trace() {
+    feed_trace_sequence_published = feed_trace.get_sequence();
+    char json[512];
+    feed_trace.summarize(json, sizeof(json));
+    mqtt_feed_trace.setJsonAttributes(json);
+    char value[16];
+    const uint32_t total = feed_trace.get_count() ? feed_trace.get_cycle(0).total_millis() : 0;
+    Formatter(value).decimal(static_cast<float>(total) / 1000.0f);
+    if (mqtt_feed_trace.setValue(value)) diagnostics.mqtt_published();
 }
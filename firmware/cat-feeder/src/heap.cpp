@@ -0,0 +1,91 @@
+#include <new>
+#include <pico/stdlib.h>
+#include "heap.h"
+
+// Constant-initialized, so it works for allocations made by constructors
+// running before it would otherwise be constructed.
+Heap heap;
+
+void Heap::seal() {
+    lock = spin_lock_init(spin_lock_claim_unused(true));
+}
+
+[[nodiscard]] bool Heap::is_sealed() const {
+    return lock != nullptr;
+}
+
+void *Heap::allocate(const size_t size, const void *caller) {
+    if (!lock) return malloc(size ? size : 1);
+
+    if (size <= BLOCK_SIZE) {
+        const uint32_t saved = spin_lock_blocking(lock);
+        if (free_mask) {
+            const unsigned block = __builtin_ctz(free_mask);
+            free_mask &= ~(1u << block);
+            stats.pool_allocations++;
+            if (++stats.pool_in_use > stats.pool_peak) stats.pool_peak = stats.pool_in_use;
+            spin_unlock(lock, saved);
+            return pool[block];
+        }
+        spin_unlock(lock, saved);
+    }
+
+#ifdef HEAP_TRAP
+    panic("Heap allocation of %u bytes after setup from %p", static_cast<unsigned>(size), caller);
+#endif
+    const uint32_t saved = spin_lock_blocking(lock);
+    stats.escapes++;
+    stats.escape_caller = reinterpret_cast<uintptr_t>(caller);
+    stats.escape_size = size;
+    spin_unlock(lock, saved);
+    return malloc(size ? size : 1);
+}
+
+void Heap::release(void *ptr) {
+    const auto *p = static_cast<const uint8_t *>(ptr);
+    if (p < pool[0] || p >= pool[NUM_BLOCKS]) {
+        free(ptr);
+        return;
+    }
+    const auto block = static_cast<unsigned>((p - pool[0]) / BLOCK_SIZE);
+    const uint32_t saved = spin_lock_blocking(lock);
+    free_mask |= 1u << block;
+    stats.pool_in_use--;
+    spin_unlock(lock, saved);
+}
+
+[[nodiscard]] Heap::Stats Heap::get_stats() const {
+    return stats;
+}
+
+void *operator new(const size_t size) {
+    return heap.allocate(size, __builtin_return_address(0));
+}
+
+void *operator new[](const size_t size) {
+    return heap.allocate(size, __builtin_return_address(0));
+}
+
+void *operator new(const size_t size, const std::nothrow_t &) noexcept {
+    return heap.allocate(size, __builtin_return_address(0));
+}
+
+void *operator new[](const size_t size, const std::nothrow_t &) noexcept {
+    return heap.allocate(size, __builtin_return_address(0));
+}
+
+void operator delete(void *ptr) noexcept {
+    heap.release(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    heap.release(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    heap.release(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    heap.release(ptr);
+}
@@ -0,0 +1,193 @@
+#include "history.h"
+#include "format.h"
+
+#include <LittleFS.h>
+#include <algorithm>
+
+void History::close(const size_t tier) {
+    Bucket closed[SERIES];
+    for (size_t s = 0; s < SERIES; s++) {
+        auto &acc = open[s][tier];
+        if (acc.count) {
+            const int32_t half = acc.sum < 0 ? -(acc.count / 2) : acc.count / 2;
+            closed[s] = {acc.min, acc.max, static_cast<int16_t>((acc.sum + half) / acc.count), acc.count};
+        } else {
+            closed[s] = {};
+        }
+        acc = {};
+    }
+    push(tier, closed);
+    if (unsaved[tier] < LENGTH[tier]) unsaved[tier]++;
+    if (tier == TIERS - 1) save_due = true;
+}
+
+void History::push(const size_t tier, const Bucket (&closed)[SERIES]) {
+    for (size_t s = 0; s < SERIES; s++) {
+        buckets[s][OFFSET[tier] + heads[tier]] = closed[s];
+    }
+    heads[tier] = (heads[tier] + 1) % LENGTH[tier];
+    if (counts[tier] < LENGTH[tier]) counts[tier]++;
+}
+
+void History::add(const Series series, const float grams) {
+    const auto index = static_cast<size_t>(series);
+    const int16_t value = static_cast<int16_t>(std::clamp(lroundf(grams * static_cast<float>(UNITS_PER_GRAM[index])), -32768L, 32767L));
+    for (auto &acc : open[index]) {
+        if (!acc.count || value < acc.min) acc.min = value;
+        if (!acc.count || value > acc.max) acc.max = value;
+        acc.sum += value;
+        if (acc.count < UINT16_MAX) acc.count++;
+    }
+}
+
+void History::update(const int32_t delta_millis) {
+    for (size_t tier = 0; tier < TIERS; tier++) {
+        open_millis[tier] += delta_millis;
+        while (open_millis[tier] >= PERIOD_MILLIS[tier]) {
+            open_millis[tier] -= PERIOD_MILLIS[tier];
+            close(tier);
+        }
+    }
+}
+
+[[nodiscard]] float History::to_grams(const Series series, const int16_t value) {
+    return static_cast<float>(value) / static_cast<float>(UNITS_PER_GRAM[static_cast<size_t>(series)]);
+}
+
+[[nodiscard]] size_t History::get_count(const size_t tier) const {
+    return counts[tier];
+}
+
+[[nodiscard]] const History::Bucket &History::get(const Series series, const size_t tier, const size_t age) const {
+    return buckets[static_cast<size_t>(series)][OFFSET[tier] + (heads[tier] + LENGTH[tier] - 1 - age) % LENGTH[tier]];
+}
+
+[[nodiscard]] bool History::is_save_due() const {
+    return save_due;
+}
+
+bool History::save() {
+    save_due = false;
+    size_t entries = 0;
+    for (const uint16_t n : unsaved) entries += n;
+    if (!entries) return true;
+    if (journal_size + sizeof(JournalHeader) + entries * sizeof(JournalEntry) > MAX_JOURNAL_BYTES) {
+        return write_snapshot();
+    }
+    return append_journal();
+}
+
+bool History::append_journal() {
+    File file = LittleFS.open(FILE_NAME_JOURNAL, "a");
+    if (!file) return false;
+    bool ok = true;
+    if (!journal_size) {
+        const JournalHeader header = {JOURNAL_MAGIC, generation};
+        ok = file.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header)) == sizeof(header);
+    }
+
+    // Oldest first per tier; the tiers are independent of each other.
+    for (size_t tier = 0; ok && tier < TIERS; tier++) {
+        for (size_t age = unsaved[tier]; ok && age-- > 0;) {
+            JournalEntry entry = {static_cast<uint8_t>(tier), 0, {}};
+            for (size_t s = 0; s < SERIES; s++) {
+                entry.buckets[s] = get(static_cast<Series>(s), tier, age);
+            }
+            ok = file.write(reinterpret_cast<const uint8_t *>(&entry), sizeof(entry)) == sizeof(entry);
+        }
+    }
+    const size_t size = file.size();
+    file.close();
+    if (!ok) return false;
+    journal_size = size;
+    memset(unsaved, 0, sizeof(unsaved));
+    return true;
+}
+
+bool History::write_snapshot() {
+    File file = LittleFS.open(FILE_NAME_TEMP, "w");
+    if (!file) return false;
+    const FileHeader header = {FILE_MAGIC, sizeof(buckets) + sizeof(heads) + sizeof(counts), generation + 1};
+    bool ok = file.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header)) == sizeof(header);
+    ok = ok && file.write(reinterpret_cast<const uint8_t *>(heads), sizeof(heads)) == sizeof(heads);
+    ok = ok && file.write(reinterpret_cast<const uint8_t *>(counts), sizeof(counts)) == sizeof(counts);
+    ok = ok && file.write(reinterpret_cast<const uint8_t *>(buckets), sizeof(buckets)) == sizeof(buckets);
+    file.close();
+    if (!ok) {
+        LittleFS.remove(FILE_NAME_TEMP);
+        return false;
+    }
+
+    // The rename replaces the old snapshot atomically. From then on the old
+    // journal has a stale generation, so it doesn't matter if the power
+    // fails before it is removed.
+    if (!LittleFS.rename(FILE_NAME_TEMP, FILE_NAME)) return false;
+    generation++;
+    LittleFS.remove(FILE_NAME_JOURNAL);
+    journal_size = 0;
+    memset(unsaved, 0, sizeof(unsaved));
+    return true;
+}
+
+bool History::load() {
+    File file = LittleFS.open(FILE_NAME, "r");
+    bool ok = static_cast<bool>(file);
+    FileHeader header = {};
+    ok = ok && file.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) == sizeof(header);
+    ok = ok && header.magic == FILE_MAGIC && header.size == sizeof(buckets) + sizeof(heads) + sizeof(counts);
+    ok = ok && file.read(reinterpret_cast<uint8_t *>(heads), sizeof(heads)) == sizeof(heads);
+    ok = ok && file.read(reinterpret_cast<uint8_t *>(counts), sizeof(counts)) == sizeof(counts);
+    ok = ok && file.read(reinterpret_cast<uint8_t *>(buckets), sizeof(buckets)) == sizeof(buckets);
+    if (file) file.close();
+    for (size_t tier = 0; ok && tier < TIERS; tier++) {
+        ok = heads[tier] < LENGTH[tier] && counts[tier] <= LENGTH[tier];
+    }
+    if (!ok) {
+        memset(heads, 0, sizeof(heads));
+        memset(counts, 0, sizeof(counts));
+        memset(buckets, 0, sizeof(buckets));
+    }
+    generation = ok ? header.generation : 0;
+    memset(unsaved, 0, sizeof(unsaved));
+    replay_journal();
+    return ok || journal_size;
+}
+
+void History::replay_journal() {
+    journal_size = 0;
+    File file = LittleFS.open(FILE_NAME_JOURNAL, "r");
+    if (!file) return;
+    JournalHeader header = {};
+    if (file.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) != sizeof(header)
+        || header.magic != JOURNAL_MAGIC || header.generation != generation) {
+        // Left over from before the current snapshot.
+        file.close();
+        LittleFS.remove(FILE_NAME_JOURNAL);
+        return;
+    }
+    JournalEntry entry = {};
+    while (file.read(reinterpret_cast<uint8_t *>(&entry), sizeof(entry)) == sizeof(entry) && entry.tier < TIERS) {
+        push(entry.tier, entry.buckets);
+    }
+    journal_size = file.size();
+    file.close();
+}
+
+void History::print(Print &out, const Series series, const size_t tier) const {
+    const uint32_t period_minutes = PERIOD_MILLIS[tier] / 60000;
+    for (size_t age = counts[tier]; age-- > 0;) {
+        const Bucket &bucket = get(series, tier, age);
+        char line[64];
+        Formatter f(line);
+        f.character('-').integer(static_cast<int32_t>((age + 1) * period_minutes)).text("min");
+        if (bucket.count) {
+            f.character(' ').decimal(to_grams(series, bucket.min));
+            f.character(' ').decimal(to_grams(series, bucket.max));
+            f.character(' ').decimal(to_grams(series, bucket.mean));
+            f.character(' ').integer(bucket.count);
+        } else {
+            f.text(" -");
+        }
+        out.println(line);
+    }
+}
@@ -0,0 +1,70 @@
+#include <hardware/structs/xip_ctrl.h>
+#include "hot.h"
+
+HotBench hot_bench;
+
+void HotBench::start() {
+    for (auto &state : ranges) {
+        for (auto &range : state) {
+            range = {UINT32_MAX, 0, 0};
+        }
+    }
+    remaining = ITERATIONS;
+    cold = false;
+    unreported = false;
+
+    // Writing the counters clears them.
+    xip_ctrl_hw->ctr_hit = 0;
+    xip_ctrl_hw->ctr_acc = 0;
+}
+
+void HotBench::mark() {
+    if (!remaining) return;
+    if (!--remaining) {
+        unreported = true;
+        return;
+    }
+    cold = !cold;
+    if (cold) {
+        // Reading back waits for the flush to complete.
+        xip_ctrl_hw->flush = 1;
+        (void)xip_ctrl_hw->flush;
+    }
+}
+
+void HotBench::leave(const Probe probe, const uint32_t start_micros) {
+    if (!remaining) return;
+    const uint32_t elapsed = micros() - start_micros;
+    Range &range = ranges[cold][static_cast<size_t>(probe)];
+    if (elapsed < range.min_micros) range.min_micros = elapsed;
+    if (elapsed > range.max_micros) range.max_micros = elapsed;
+    range.count++;
+}
+
+bool HotBench::report(Print &out) {
+    if (!unreported) return false;
+    unreported = false;
+
+    static constexpr const char *PROBE_NAMES[] = {"fsm.update", "loadcell.update", "loadcell.stats"};
+#ifdef HOT_IN_RAM
+    out.println("Hot paths in RAM:");
+#else
+    out.println("Hot paths in flash:");
+#endif
+    for (size_t probe = 0; probe < static_cast<size_t>(Probe::COUNT); probe++) {
+        for (size_t state = 0; state < 2; state++) {
+            const Range &range = ranges[state][probe];
+            if (!range.count) continue;
+            out.printf("%-16s %s: min %5luus, max %6luus over %lu calls\n", PROBE_NAMES[probe],
+                state ? "cold" : "warm", static_cast<unsigned long>(range.min_micros),
+                static_cast<unsigned long>(range.max_micros), static_cast<unsigned long>(range.count));
+        }
+    }
+    const uint32_t accesses = xip_ctrl_hw->ctr_acc;
+    if (accesses) {
+        const auto hit_per_mille = static_cast<uint32_t>(static_cast<uint64_t>(xip_ctrl_hw->ctr_hit) * 1000 / accesses);
+        out.printf("XIP cache hit rate %lu.%lu%% over %lu accesses\n", static_cast<unsigned long>(hit_per_mille / 10),
+            static_cast<unsigned long>(hit_per_mille % 10), static_cast<unsigned long>(accesses));
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#include <cstring>
+#include "http.h"
+
+HttpExchange::HttpExchange(const char *const path, const char *const content_type, const Body &body, const uint8_t sections) :
+    path(path),
+    content_type(content_type),
+    body(body),
+    sections(sections) {
+}
+
+void HttpExchange::reset() {
+    request_length = 0;
+    terminator_run = 0;
+    memset(request, 0, sizeof(request));
+    found = false;
+    header_done = false;
+    section = 0;
+    item = 0;
+    buffer_length = 0;
+}
+
+bool HttpExchange::receive(const char c) {
+    if (request_length < sizeof(request) - 1) {
+        request[request_length++] = c;
+    }
+    if (c != '\r' && c != '\n') {
+        terminator_run = 0;
+        return false;
+    }
+    if (c != '\n' || ++terminator_run != 2) return false;
+
+    // The path must be followed by the protocol version or end the line.
+    const size_t path_length = strlen(path);
+    found = 4 + path_length < sizeof(request) && !strncmp(request, "GET ", 4) && !strncmp(request + 4, path, path_length) &&
+            (request[4 + path_length] == ' ' || request[4 + path_length] == '\r');
+    if (!found) section = sections;
+    return true;
+}
+
+[[nodiscard]] bool HttpExchange::is_found() const {
+    return found;
+}
+
+void HttpExchange::render_header(Formatter &f) const {
+    if (found) {
+        f.text("HTTP/1.0 200 OK\r\nContent-Type: ").text(content_type).text("\r\nConnection: close\r\n\r\n");
+    } else {
+        f.text("HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\nNot found\n");
+    }
+}
+
+size_t HttpExchange::fill() {
+    if (buffer_length) return buffer_length;
+    if (!header_done) {
+        Formatter f(buffer);
+        render_header(f);
+        buffer_length = f.get_length();
+        header_done = true;
+    }
+    while (section < sections) {
+        char line[256];
+        Formatter f(line);
+        if (!body.render(f, section, item)) {
+            section++;
+            item = 0;
+            continue;
+        }
+        if (buffer_length + f.get_length() > sizeof(buffer)) break;
+        memcpy(buffer + buffer_length, line, f.get_length());
+        buffer_length += f.get_length();
+        item++;
+    }
+    return buffer_length;
+}
+
+[[nodiscard]] const uint8_t *HttpExchange::get_buffer() const {
+    return reinterpret_cast<const uint8_t *>(buffer);
+}
+
+void HttpExchange::consume() {
+    buffer_length = 0;
+}
@@ -0,0 +1,25 @@
+#include "led.h"
+#include "pins.h"
+
+#include <hardware/gpio.h>
+#include <hardware/pwm.h>
+
+bool StatusLed::on_timer(repeating_timer *t) {
+    auto &led = *static_cast<StatusLed *>(t->user_data);
+    const uint16_t brightness = led.sequence.next(led.setting.load(std::memory_order_relaxed));
+    pwm_set_gpio_level(PIN_FP_LED, brightness * brightness);
+    return true;
+}
+
+void StatusLed::begin() {
+    gpio_set_function(PIN_FP_LED, GPIO_FUNC_PWM);
+    const auto slice = pwm_gpio_to_slice_num(PIN_FP_LED);
+    pwm_set_wrap(slice, PWM_WRAP);
+    pwm_set_gpio_level(PIN_FP_LED, 0);
+    pwm_set_enabled(slice, true);
+    add_repeating_timer_ms(-STEP_MILLIS, on_timer, this, &timer);
+}
+
+void StatusLed::set(const Pattern pattern, const uint8_t count) {
+    setting.store(LedSequence::setting(pattern, count), std::memory_order_relaxed);
+}
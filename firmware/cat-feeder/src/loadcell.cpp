@@ -1,94 +1,89 @@
+#include "boot.h"
+#include "format.h"
 #include "loadcell.h"
 #include "pins.h"
+#include "telemetry.h"
 
-void Loadcell::begin() {
+LoadcellBase::LoadcellBase() {
+    for (auto &tare : tares) {
+        tare = std::numeric_limits<int32_t>::min();
+    }
+}
+
+void LoadcellBase::begin() {
     hx711.begin(PIN_LC_DATA, PIN_LC_CLK);
-    hx711.read();
 }
 
-void Loadcell::start(Sensor target_sensor, bool tare) {
-    sensor = target_sensor;
-    if (sensor == Sensor::RESERVOIR) {
-        hx711.set_gain(128);
-    } else {
-        hx711.set_gain(32);
-    }
-    hx711.read();
-    samples_remaining = NUM_SAMPLES;
+void LoadcellBase::begin_measurement(const size_t target_channel, const uint8_t gain, const size_t target_window, const bool tare) {
+    channel = target_channel;
+    hx711.set_gain(gain);
+    discard_next = true;
+    window = target_window;
+    samples_remaining = target_window;
     apply_tare = tare;
 }
 
-void Loadcell::update() {
-    if (!samples_remaining) return;
-    if (!hx711.is_ready()) return;
-    samples_remaining--;
-    samples[samples_remaining] = hx711.read();
-    if (samples_remaining) return;
-
-    // Compute mean in raw measurement format.
-    int64_t accum = NUM_SAMPLES / 2;
-    for (auto sample : samples) {
-        accum += sample;
+bool HOT(LoadcellBase::poll_sample)(int32_t &raw) {
+    if (!samples_remaining) return false;
+    if (!hx711.is_ready()) return false;
+    if (discard_next) {
+        discard_next = false;
+        hx711.read();
+        prev_sample_micros = micros();
+        return false;
     }
-    mean_raw = static_cast<int32_t>(accum / static_cast<int64_t>(NUM_SAMPLES));
+    samples_remaining--;
+    raw = hx711.read();
+    telemetry.record(Telemetry::Event::SAMPLE, static_cast<uint8_t>(channel), raw);
+    trace.record(Trace::Event::SAMPLE, static_cast<uint8_t>(channel), raw);
 
-    // Compute variance in measurement format.
-    accum = NUM_SAMPLES / 2;
-    for (const auto sample : samples) {
-        const int64_t diff = sample - mean_raw;
-        accum += diff * diff;
+    // Keep track of sample timing.
+    const uint32_t now = micros();
+    const uint32_t interval = now - prev_sample_micros;
+    prev_sample_micros = now;
+    stats.samples[channel]++;
+    stats.busy_micros[channel] += interval;
+    if (interval < min_interval_micros) min_interval_micros = interval;
+    if (interval > min_interval_micros + min_interval_micros / 2) {
+        stats.dropped += (interval + min_interval_micros / 2) / min_interval_micros - 1;
     }
-    const auto var = static_cast<float>(accum) / static_cast<float>(NUM_SAMPLES);
+    return true;
+}
 
-    // Figure out tare value and gain for selected sensor.
-    int32_t tare = 0;
-    float gain = 0.0f;
-    switch (sensor) {
-        case Sensor::RESERVOIR:
-            if (apply_tare || tare_reservoir == std::numeric_limits<int32_t>::min()) tare_reservoir = mean_raw;
-            tare = tare_reservoir;
-            gain = GAIN_RESERVOIR;
-            break;
-        case Sensor::BOWL:
-            if (apply_tare || tare_bowl == std::numeric_limits<int32_t>::min()) tare_bowl = mean_raw;
-            tare = tare_bowl;
-            gain = GAIN_BOWL;
-            break;
-    }
+void LoadcellBase::finish_measurement(const int32_t raw_mean, const float variance, const float grams_per_count) {
+    mean_raw = raw_mean;
+    int32_t &tare = tares[channel];
+    if (apply_tare || tare == std::numeric_limits<int32_t>::min()) tare = mean_raw;
 
     // Compute mean and stddev in grams.
-    mean = static_cast<float>(mean_raw - tare) * gain;
-    stddev = sqrt(var) * abs(gain);
-    Serial.printf("Measured sensor %d, raw %d, %.2g +/- %.2g\n", sensor, mean_raw, mean, stddev);
+    mean = static_cast<float>(mean_raw - tare) * grams_per_count;
+    stddev = sqrtf(variance) * fabsf(grams_per_count);
+    char buffer[32];
+    Formatter(buffer).decimal(mean).text(" +/- ").decimal(stddev);
+    boot.mark(Boot::Phase::FIRST_MEASUREMENT);
+    Serial.printf("Measured sensor %d, raw %d, %s\n", static_cast<int>(channel), static_cast<int>(mean_raw), buffer);
 }
 
-[[nodiscard]] bool Loadcell::is_busy() const {
+[[nodiscard]] bool LoadcellBase::is_busy() const {
     return samples_remaining > 0;
 }
 
-[[nodiscard]] float Loadcell::get_mean() const {
-    return mean;
+[[nodiscard]] int16_t LoadcellBase::get_progress() const {
+    return static_cast<int16_t>((window - samples_remaining) * 1000 / window);
 }
 
-[[nodiscard]] float Loadcell::get_stddev() const {
-    return stddev;
+[[nodiscard]] float LoadcellBase::get_mean() const {
+    return mean;
 }
 
-[[nodiscard]] Loadcell::Sensor Loadcell::get_sensor() const {
-    return sensor;
+[[nodiscard]] float LoadcellBase::get_stddev() const {
+    return stddev;
 }
 
-[[nodiscard]] int32_t Loadcell::get_mean_raw() const {
+[[nodiscard]] int32_t LoadcellBase::get_mean_raw() const {
     return mean_raw;
 }
 
-void Loadcell::set_tare_raw(const Sensor sensor, const int32_t raw) {
-    switch (sensor) {
-        case Sensor::RESERVOIR:
-            tare_reservoir = raw;
-            break;
-        case Sensor::BOWL:
-            tare_bowl = raw;
-            break;
-    }
+[[nodiscard]] const LoadcellBase::Stats &LoadcellBase::get_stats() const {
+    return stats;
 }
@@ -1,38 +1,86 @@
 #include <Arduino.h>
 #include <WiFi.h>
+#include <LittleFS.h>
 #include <ArduinoHA.h>
+#include <Adafruit_GC9A01A.h>
+#include <optional>
 
+#include "boot.h"
+#include "console.h"
+#include "discovery.h"
+#include "format.h"
+#include "heap.h"
+#include "hot.h"
 #include "fsm.h"
+#include "metrics.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "query.h"
 #include "ui.h"
+#include "watchdog.h"
 
-WiFiClient client;
+WiFiClient wifi_client;
+DiscoveryClient client(wifi_client);
 HADevice device("catfeeder");
 HAMqtt mqtt(client, device);
 StateMachine fsm;
-UserInterface ui(fsm, mqtt);
 
-HAButton mqtt_feed {"feed"};
+/**
+ * Network and memory state for the display, read from the board.
+ */
+class BoardStatus : public SystemStatus {
+public:
+    int wifi_status() override {
+        return WiFi.status();
+    }
+
+    void local_ip(uint8_t ip[4]) override {
+        const IPAddress address = WiFi.localIP();
+        for (int i = 0; i < 4; i++) ip[i] = address[i];
+    }
+
+    uint32_t free_heap() override {
+        return Diagnostics::heap_free();
+    }
+};
+
+Adafruit_GC9A01A tft(&SPI, PIN_TFT_DC, PIN_TFT_CS, PIN_TFT_RST);
+PanelBlit panel_blit(tft);
+SPIPanelControl panel_control(tft);
+BoardStatus board_status;
+#ifdef DEBUG_UI_RECORD
+RenderRecorder recorder(tft, panel_blit, UserInterface::SPI_FREQUENCY);
+UserInterface ui(fsm, mqtt, recorder, panel_control, board_status);
+#else
+UserInterface ui(fsm, mqtt, tft, panel_blit, panel_control, board_status);
+#endif
+Console console;
+HistoryQuery history_query(mqtt, fsm.get_weight_log());
+MetricsServer metrics(fsm);
+Discovery discovery(mqtt, client);
+
+Paced<HAButton> mqtt_feed {"feed"};
 volatile bool mqtt_feed_flag = false;
 void on_mqtt_feed(HAButton *sender) {
     (void)sender;
     mqtt_feed_flag = true;
 }
 
-HAButton mqtt_reset {"reset"};
+Paced<HAButton> mqtt_reset {"reset"};
 volatile bool mqtt_reset_flag = false;
 void on_mqtt_reset(HAButton *sender) {
     (void)sender;
     mqtt_reset_flag = true;
 }
 
-HAButton mqtt_maintenance {"enter_maintenance"};
+Paced<HAButton> mqtt_maintenance {"enter_maintenance"};
 volatile bool mqtt_maintenance_flag = false;
 void on_mqtt_maintenance(HAButton *sender) {
     (void)sender;
     mqtt_maintenance_flag = true;
 }
 
-HANumber mqtt_grams_per_day {"grams_per_day", HABaseDeviceType::PrecisionP0};
+Paced<HANumber> mqtt_grams_per_day {"grams_per_day", HABaseDeviceType::PrecisionP0};
 volatile bool mqtt_grams_per_day_flag = false;
 volatile int mqtt_grams_per_day_value = 0;
 void on_mqtt_grams_per_day(const HANumeric number, HANumber *sender) {
@@ -41,33 +89,235 @@ void on_mqtt_grams_per_day(const HANumeric number, HANumber *sender) {
     mqtt_grams_per_day_value = number.toInt32();
 }
 
-HANumber mqtt_adjust_deficit_number {"adjust_deficit_amount", HABaseDeviceType::PrecisionP1};
+Paced<HANumber> mqtt_forecast_horizon {"forecast_horizon", HABaseDeviceType::PrecisionP0};
+volatile bool mqtt_forecast_horizon_flag = false;
+volatile int mqtt_forecast_horizon_value = 0;
+void on_mqtt_forecast_horizon(const HANumeric number, HANumber *sender) {
+    (void)sender;
+    mqtt_forecast_horizon_flag = true;
+    mqtt_forecast_horizon_value = number.toInt32();
+}
+
+Paced<HANumber> mqtt_adjust_deficit_number {"adjust_deficit_amount", HABaseDeviceType::PrecisionP1};
 volatile int32_t mqtt_adjust_deficit_amount = 0;
 void on_mqtt_adjust_deficit_number(const HANumeric number, HANumber *sender) {
     (void)sender;
     mqtt_adjust_deficit_amount = static_cast<int32_t>(number.toFloat() * 1000.0f);
 }
 
-HAButton mqtt_adjust_deficit_button {"adjust_deficit_button"};
+Paced<HAButton> mqtt_adjust_deficit_button {"adjust_deficit_button"};
 volatile bool mqtt_adjust_deficit_flag = false;
 void on_mqtt_adjust_deficit_button(HAButton *sender) {
     (void)sender;
     mqtt_adjust_deficit_flag = true;
 }
 
+Paced<HAButton> mqtt_display_benchmark {"display_benchmark"};
+volatile bool mqtt_display_benchmark_flag = false;
+void on_mqtt_display_benchmark(HAButton *sender) {
+    (void)sender;
+    mqtt_display_benchmark_flag = true;
+}
+
+Paced<HASensor> mqtt_display_benchmark_result {"display_benchmark_result", HASensor::JsonAttributesFeature};
+
+Paced<HASensorNumber> mqtt_stack_used_core0 {"stack_used_core0"};
+Paced<HASensorNumber> mqtt_stack_used_core1 {"stack_used_core1"};
+Paced<HASensorNumber> mqtt_heap_free {"heap_free"};
+Paced<HASensorNumber> mqtt_heap_min_free {"heap_min_free"};
+Paced<HASensorNumber> mqtt_heap_largest_free {"heap_largest_free"};
+unsigned long last_memory_publish = 0;
+
+Paced<HASensor> mqtt_last_reset {"last_reset"};
+
+void publish_last_reset() {
+    char description[96];
+    Formatter f(description);
+    watchdog.describe_reset(f);
+    mqtt_last_reset.setValue(description);
+}
+
+Paced<HASensor> mqtt_boot_time {"boot_time", HASensor::JsonAttributesFeature};
+bool boot_time_published = false;
+
+void publish_boot_time() {
+    char json[192];
+    Formatter f(json);
+    boot.summarize(f);
+    mqtt_boot_time.setJsonAttributes(json);
+    char value[12];
+    Formatter(value).natural(boot.get_completion_millis());
+    mqtt_boot_time.setValue(value);
+}
+
+void publish_memory() {
+    mqtt_stack_used_core0.setValue(diagnostics.stack_used(0));
+    mqtt_stack_used_core1.setValue(diagnostics.stack_used(1));
+    mqtt_heap_free.setValue(Diagnostics::heap_free());
+    mqtt_heap_min_free.setValue(diagnostics.get_heap_min_free());
+    mqtt_heap_largest_free.setValue(Diagnostics::heap_largest_free());
+}
+
+void report_display_benchmark(const UserInterface::BenchmarkResult &result) {
+    char json[256];
+    Formatter j(json);
+    j.character('{');
+    for (const auto &setting : result.settings) {
+        const auto khz = static_cast<uint32_t>(setting.frequency / 1000);
+        const auto fill = static_cast<uint32_t>(setting.fill_micros);
+        const auto line = static_cast<uint32_t>(setting.line_micros);
+        char text[64];
+        Formatter(text).text("Display @ ").integer(static_cast<int32_t>(khz), 5).text("kHz: fill ")
+            .integer(static_cast<int32_t>(fill), 6).text("us, line ").integer(static_cast<int32_t>(line), 5).text("us");
+        Serial.println(text);
+        if (j.get_length() > 1) j.character(',');
+        j.character('"').natural(khz).text("\":{\"fill_us\":").natural(fill).text(",\"line_us\":").natural(line).character('}');
+    }
+    j.character('}');
+
+    // Only publish complete JSON; the formatter truncates silently.
+    if (j.get_length() < sizeof(json) - 1) {
+        mqtt_display_benchmark_result.setJsonAttributes(json);
+    }
+    char summary[21];
+    const auto &best = result.settings[UserInterface::BenchmarkResult::NUM_SETTINGS - 1];
+    Formatter(summary).natural(static_cast<uint32_t>(best.fill_micros / 1000)).text("ms @ ")
+        .natural(static_cast<uint32_t>(best.frequency / 1000000)).text("MHz");
+    mqtt_display_benchmark_result.setValue(summary);
+}
+
+void handle_history_command(const char *args) {
+    static constexpr const char *SERIES_NAMES[] = {"reservoir", "bowl", "intake"};
+    for (size_t series = 0; series < History::SERIES; series++) {
+        const size_t length = strlen(SERIES_NAMES[series]);
+        if (strncmp(args, SERIES_NAMES[series], length) || args[length] != ' ') continue;
+        const char tier = args[length + 1];
+        if (tier < '0' || tier >= static_cast<char>('0' + History::TIERS) || args[length + 2]) break;
+        fsm.get_history().print(Serial, static_cast<History::Series>(series), tier - '0');
+        return;
+    }
+    Serial.println("Usage: history <reservoir|bowl|intake> <0|1|2>");
+}
+
+/**
+ * Maximum number of weight log records printed per loop iteration.
+ */
+constexpr size_t LOG_DUMP_BUDGET = 16;
+
+/**
+ * Weight log dump in progress, if any.
+ */
+std::optional<WeightLog::Reader> log_dump;
+
+void handle_log_command() {
+    if (fsm.feeding()) {
+        Serial.println("Feeding, try again later");
+        return;
+    }
+    log_dump.emplace(fsm.get_weight_log());
+}
+
+void poll_log_dump() {
+    static constexpr const char *TYPE_NAMES[] = {"reservoir", "bowl", "feed", "meal"};
+    if (!log_dump) return;
+    for (size_t i = 0; i < LOG_DUMP_BUDGET; i++) {
+        // Don't block on the USB serial buffer; continue next iteration.
+        char line[48];
+        if (Serial.availableForWrite() < static_cast<int>(sizeof(line))) return;
+        WeightLog::Record record = {};
+        if (!log_dump->next(record)) {
+            if (log_dump->is_aborted()) Serial.println("# aborted, the log rotated");
+            Serial.printf("# %lu corrupt blocks, %lu records dropped before clock sync\n",
+                static_cast<unsigned long>(log_dump->get_corrupt()),
+                static_cast<unsigned long>(fsm.get_weight_log().get_dropped()));
+            log_dump.reset();
+            return;
+        }
+        Formatter(line).integer(static_cast<int32_t>(record.time)).character(',')
+            .text(TYPE_NAMES[static_cast<size_t>(record.type)]).character(',')
+            .decimal(static_cast<float>(record.value) / 10.0f);
+        Serial.println(line);
+    }
+}
+
+void handle_heap_command() {
+    const Heap::Stats stats = heap.get_stats();
+    Serial.printf("Pool: %lu allocations, %lu/%u blocks in use, peak %lu\n",
+        static_cast<unsigned long>(stats.pool_allocations), static_cast<unsigned long>(stats.pool_in_use),
+        static_cast<unsigned>(Heap::NUM_BLOCKS), static_cast<unsigned long>(stats.pool_peak));
+    Serial.printf("Escapes: %lu, last %u bytes from 0x%08lx\n", static_cast<unsigned long>(stats.escapes),
+        static_cast<unsigned>(stats.escape_size), static_cast<unsigned long>(stats.escape_caller));
+    Serial.printf("Free heap: %d bytes\n", rp2040.getFreeHeap());
+}
+
+void handle_memory_command() {
+    for (unsigned core = 0; core < 2; core++) {
+        Serial.printf("Stack core %u: %lu of %lu bytes used\n", core,
+            static_cast<unsigned long>(diagnostics.stack_used(core)), static_cast<unsigned long>(Diagnostics::stack_size(core)));
+    }
+    Serial.printf("Heap: %lu bytes free, %lu minimum, %lu unfragmented\n",
+        static_cast<unsigned long>(Diagnostics::heap_free()), static_cast<unsigned long>(diagnostics.get_heap_min_free()),
+        static_cast<unsigned long>(Diagnostics::heap_largest_free()));
+}
+
+void handle_command(const char *command) {
+    if (!strcmp(command, "bench display")) {
+        ui.request_benchmark();
+    } else if (!strcmp(command, "bench hot")) {
+        hot_bench.start();
+    } else if (!strncmp(command, "history ", 8)) {
+        handle_history_command(command + 8);
+    } else if (!strcmp(command, "log")) {
+        handle_log_command();
+    } else if (!strcmp(command, "heap")) {
+        handle_heap_command();
+    } else if (!strcmp(command, "mem")) {
+        handle_memory_command();
+    } else if (!strcmp(command, "trace")) {
+        trace.dump(Serial);
+    } else if (!strcmp(command, "reset cause")) {
+        char description[96];
+        Formatter f(description);
+        watchdog.describe_reset(f);
+        Serial.println(description);
+    } else {
+        Serial.printf("Unknown command: %s\n", command);
+    }
+}
+
 unsigned long last_wifi_reconnect = 0;
 
 void wifi_connect() {
-    WiFi.begin("TPL@PB40", "1Tilia5Nefit!");
+    WiFi.beginNoBlock("TPL@PB40", "1Tilia5Nefit!");
+}
+
+void on_mqtt_connected() {
+    diagnostics.mqtt_connects++;
+    boot.mark(Boot::Phase::MQTT_CONNECTED);
+    history_query.on_connected();
+    discovery.on_connected();
+}
+
+void on_mqtt_message(const char *topic, const uint8_t *payload, const uint16_t length) {
+    if (history_query.on_message(topic, payload, length)) return;
+    discovery.on_message(topic, payload, length);
 }
 
 void setup() {
+    diagnostics.paint_stack();
     Serial.begin();
-    fsm.begin();
-    ui.begin();
 
+    // Start associating first; the rest of setup, the display bringup on
+    // core 1 and the first measurements in the main loop overlap with it.
     WiFi.mode(WIFI_STA);
     wifi_connect();
+    last_wifi_reconnect = millis();
+
+    LittleFS.begin();
+    fsm.begin();
+    NTP.begin("pool.ntp.org", "time.nist.gov");
+    metrics.begin();
+    telemetry.begin();
 
     device.setName("Cat feeder");
     device.enableSharedAvailability();
@@ -94,6 +344,15 @@ void setup() {
     mqtt_grams_per_day.setMax(150);
     mqtt_grams_per_day.setMode(HANumber::ModeBox);
 
+    mqtt_forecast_horizon.setName("Refill warning horizon");
+    mqtt_forecast_horizon.setIcon("mdi:calendar-alert");
+    mqtt_forecast_horizon.setUnitOfMeasurement("d");
+    mqtt_forecast_horizon.setRetain(true);
+    mqtt_forecast_horizon.onCommand(on_mqtt_forecast_horizon);
+    mqtt_forecast_horizon.setMin(0);
+    mqtt_forecast_horizon.setMax(30);
+    mqtt_forecast_horizon.setMode(HANumber::ModeBox);
+
     mqtt_adjust_deficit_number.setName("Adjust deficit by");
     mqtt_adjust_deficit_number.setIcon("mdi:delta");
     mqtt_adjust_deficit_number.setUnitOfMeasurement("g");
@@ -106,13 +365,86 @@ void setup() {
     mqtt_adjust_deficit_button.setIcon("mdi:delta");
     mqtt_adjust_deficit_button.onCommand(on_mqtt_adjust_deficit_button);
 
+    mqtt_display_benchmark.setName("Run display benchmark");
+    mqtt_display_benchmark.setIcon("mdi:speedometer");
+    mqtt_display_benchmark.onCommand(on_mqtt_display_benchmark);
+
+    mqtt_display_benchmark_result.setName("Display benchmark");
+    mqtt_display_benchmark_result.setIcon("mdi:speedometer");
+
+    mqtt_stack_used_core0.setName("Stack used core 0");
+    mqtt_stack_used_core1.setName("Stack used core 1");
+    mqtt_heap_free.setName("Heap free");
+    mqtt_heap_min_free.setName("Heap minimum free");
+    mqtt_heap_largest_free.setName("Heap unfragmented");
+    for (HASensorNumber *sensor : {&mqtt_stack_used_core0, &mqtt_stack_used_core1, &mqtt_heap_free, &mqtt_heap_min_free, &mqtt_heap_largest_free}) {
+        sensor->setIcon("mdi:memory");
+        sensor->setUnitOfMeasurement("B");
+    }
+
+    mqtt_last_reset.setName("Last reset");
+    mqtt_last_reset.setIcon("mdi:restart-alert");
+
+    mqtt_boot_time.setName("Boot time");
+    mqtt_boot_time.setIcon("mdi:timer-play");
+    mqtt_boot_time.setUnitOfMeasurement("ms");
+
+    mqtt.onConnected(on_mqtt_connected);
+    mqtt.onMessage(on_mqtt_message);
     mqtt.begin(IPAddress(192, 168, 1, 7), 1883, "jeroen", "Y0vzmMi90Q5egGzQFbfg");
+
+    // Everything long-lived exists now; allocate from the pool from here on.
+    heap.seal();
+
+    watchdog.begin();
+    char description[96];
+    Formatter f(description);
+    watchdog.describe_reset(f);
+    Serial.printf("Reset cause: %s\n", description);
+    boot.mark(Boot::Phase::SETUP_DONE);
+}
+
+void setup1() {
+    diagnostics.paint_stack();
+    SPI.setTX(PIN_TFT_SDA);
+    SPI.setSCK(PIN_TFT_SCL);
+    tft.begin(UserInterface::SPI_FREQUENCY);
+    ui.begin();
+    watchdog.begin_core();
+}
+
+void loop1() {
+    watchdog.enter(Watchdog::Subsystem::RENDER);
+    ui.render();
 }
 
 void loop() {
+    watchdog.enter(Watchdog::Subsystem::LOOP);
+    diagnostics.loop_mark();
+    diagnostics.memory_poll();
+    watchdog.enter(Watchdog::Subsystem::UI);
     ui.update();
+    hot_bench.mark();
+    watchdog.enter(Watchdog::Subsystem::FSM);
+    const uint32_t fsm_start_micros = hot_bench.enter();
     fsm.update();
+    hot_bench.leave(HotBench::Probe::FSM_UPDATE, fsm_start_micros);
+    watchdog.enter(Watchdog::Subsystem::MQTT);
+    const uint32_t mqtt_start_micros = micros();
+    trace.record(Trace::Event::BEGIN, static_cast<uint8_t>(Trace::Scope::MQTT_LOOP));
     mqtt.loop();
+    trace.record(Trace::Event::END, static_cast<uint8_t>(Trace::Scope::MQTT_LOOP));
+    watchdog.enter(Watchdog::Subsystem::DISCOVERY);
+    discovery.poll(fsm.feeding());
+    const uint32_t mqtt_micros = micros() - mqtt_start_micros;
+    if (mqtt_micros > diagnostics.mqtt_loop_max_micros) diagnostics.mqtt_loop_max_micros = mqtt_micros;
+    watchdog.enter(Watchdog::Subsystem::HISTORY_QUERY);
+    history_query.poll();
+    watchdog.enter(Watchdog::Subsystem::METRICS);
+    metrics.poll();
+    watchdog.enter(Watchdog::Subsystem::TELEMETRY);
+    telemetry.poll();
+    watchdog.enter(Watchdog::Subsystem::LOOP);
 
     if (mqtt_feed_flag) {
         mqtt_feed_flag = false;
@@ -130,17 +462,58 @@ void loop() {
         mqtt_grams_per_day_flag = false;
         fsm.set_grams_per_day(mqtt_grams_per_day_value);
     }
+    if (mqtt_forecast_horizon_flag) {
+        mqtt_forecast_horizon_flag = false;
+        fsm.set_forecast_horizon(mqtt_forecast_horizon_value);
+    }
     if (mqtt_adjust_deficit_flag) {
         mqtt_adjust_deficit_flag = false;
         fsm.adjust_deficit(mqtt_adjust_deficit_amount);
         mqtt_adjust_deficit_number.setState(static_cast<int32_t>(0), true);
     }
 
+    if (mqtt_display_benchmark_flag) {
+        mqtt_display_benchmark_flag = false;
+        ui.request_benchmark();
+    }
+    UserInterface::BenchmarkResult benchmark_result;
+    if (ui.get_benchmark_result(benchmark_result)) {
+        report_display_benchmark(benchmark_result);
+    }
+
+    hot_bench.report(Serial);
+
+    if (millis() - last_memory_publish > 60000) {
+        last_memory_publish = millis();
+        publish_memory();
+    }
+
+    // Report how the previous run ended and how long boot took, once the
+    // discovery configs are out.
+    if (!boot.is_marked(Boot::Phase::DISCOVERY_DONE) && mqtt.isConnected() && !discovery.is_announcing()) {
+        boot.mark(Boot::Phase::DISCOVERY_DONE);
+        publish_last_reset();
+    }
+    if (!boot_time_published && boot.is_complete()) {
+        boot_time_published = true;
+        publish_boot_time();
+    }
+    boot.report(Serial);
+
+    watchdog.enter(Watchdog::Subsystem::CONSOLE);
+    if (const char *command = console.poll()) {
+        handle_command(command);
+    }
+    poll_log_dump();
+
+    watchdog.enter(Watchdog::Subsystem::WIFI);
     if (WiFi.status() != WL_CONNECTED) {
         if ((millis() - last_wifi_reconnect) > 10000) {
-            WiFi.begin("TPL@PB40", "1Tilia5Nefit!");
+            wifi_connect();
             last_wifi_reconnect = millis();
         }
+    } else {
+        boot.mark(Boot::Phase::WIFI_CONNECTED);
     }
 
 }
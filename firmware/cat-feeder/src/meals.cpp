@@ -0,0 +1,90 @@
+#include "meals.h"
+
+[[nodiscard]] float MealDetector::Meal::rate() const {
+    if (!timed || !duration_millis) return 0.0f;
+    return grams * 60000.0f / static_cast<float>(duration_millis);
+}
+
+void MealDetector::record(const uint32_t start, const uint32_t end, const float grams, const bool timed) {
+    if (grams < MIN_MEAL_GRAMS) return;
+    meals[head] = {start, timed ? end - start : 0, grams, timed};
+    head = (head + 1) % MEALS;
+    if (count < MEALS) count++;
+    sequence++;
+    today += grams;
+}
+
+void MealDetector::sample(const float mean, const float stddev, const uint32_t now) {
+    if (stddev > DISTURBED_STDDEV) {
+        if (!eating) {
+            eating = true;
+            eating_millis = now;
+        }
+        return;
+    }
+
+    // Stable reading. A loss since the baseline was eaten, a gain only moves
+    // the baseline. Changes smaller than a meal are treated as noise and
+    // leave the baseline alone, so slow nibbling still adds up to a meal.
+    const bool timed = eating;
+    const uint32_t start = timed ? eating_millis : baseline_millis;
+    eating = false;
+    if (baseline_valid) {
+        const float change = mean - baseline;
+        if (change > -MIN_MEAL_GRAMS && change < MIN_MEAL_GRAMS) return;
+        if (change < 0.0f) record(start, now, -change, timed);
+    }
+    baseline_valid = true;
+    baseline = mean;
+    baseline_millis = now;
+}
+
+void MealDetector::reset_baseline() {
+    baseline_valid = false;
+    eating = false;
+}
+
+void MealDetector::dispensed(const float grams) {
+    baseline += grams;
+}
+
+void MealDetector::update(const int32_t delta_millis) {
+    millis_in_day += delta_millis;
+    while (millis_in_day >= DAY_MILLIS) {
+        millis_in_day -= DAY_MILLIS;
+        yesterday = today;
+        today = 0.0f;
+    }
+}
+
+[[nodiscard]] bool MealDetector::is_eating() const {
+    return eating;
+}
+
+[[nodiscard]] size_t MealDetector::get_count() const {
+    return count;
+}
+
+[[nodiscard]] const MealDetector::Meal &MealDetector::get_meal(const size_t age) const {
+    return meals[(head + MEALS - 1 - age) % MEALS];
+}
+
+[[nodiscard]] const MealDetector::Meal *MealDetector::get_last_timed() const {
+    for (size_t age = 0; age < count; age++) {
+        const Meal &meal = get_meal(age);
+        if (meal.timed) return &meal;
+    }
+    return nullptr;
+}
+
+[[nodiscard]] uint32_t MealDetector::get_sequence() const {
+    return sequence;
+}
+
+[[nodiscard]] float MealDetector::get_today() const {
+    return today;
+}
+
+[[nodiscard]] float MealDetector::get_yesterday() const {
+    return yesterday;
+}
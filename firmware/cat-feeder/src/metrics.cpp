@@ -0,0 +1,176 @@
+#include "metrics.h"
+#include "diagnostics.h"
+#include "heap.h"
+#include "trace.h"
+
+MetricsServer::MetricsServer(const StateMachine &fsm) : fsm(fsm) {
+}
+
+bool MetricsServer::render(Formatter &f, const uint8_t section, const size_t item) const {
+    switch (static_cast<Section>(section)) {
+        case Section::SENSORS: {
+            StateMachine::Metric metric = {};
+            if (!fsm.get_metric(item, metric)) return false;
+            f.text("# TYPE catfeeder_").text(metric.name).text(" gauge\ncatfeeder_").text(metric.name)
+                .character(' ').decimal(metric.value).character('\n');
+            return true;
+        }
+
+        case Section::ERRORS: {
+            const size_t code = item + 1;
+            if (code >= static_cast<size_t>(ErrorCode::COUNT)) return false;
+            if (code == 1) f.text("# TYPE catfeeder_error gauge\n");
+            f.text("catfeeder_error{code=\"").integer(static_cast<int32_t>(code)).text("\",message=\"")
+                .text(text(static_cast<ErrorCode>(code))).text("\"} ")
+                .integer((fsm.get_error_mask() & error_bit(static_cast<ErrorCode>(code))) ? 1 : 0).character('\n');
+            return true;
+        }
+
+        case Section::LOOP_HISTOGRAM: {
+            const Histogram &histogram = diagnostics.loop_histogram;
+            if (item > Histogram::NUM_BUCKETS) return false;
+            uint32_t cumulative = 0;
+            for (size_t i = 0; i < item && i < Histogram::NUM_BUCKETS; i++) {
+                cumulative += histogram.get_count(i);
+            }
+            if (item == Histogram::NUM_BUCKETS) {
+                f.text("catfeeder_loop_duration_microseconds_count ").natural(cumulative).character('\n');
+                return true;
+            }
+            if (!item) f.text("# TYPE catfeeder_loop_duration_microseconds histogram\n");
+            cumulative += histogram.get_count(item);
+            f.text("catfeeder_loop_duration_microseconds_bucket{le=\"");
+            const uint32_t bound = Histogram::get_bound(item);
+            if (bound) {
+                f.natural(bound);
+            } else {
+                f.text("+Inf");
+            }
+            f.text("\"} ").natural(cumulative).character('\n');
+            return true;
+        }
+
+        case Section::COUNTERS: {
+            const auto &stats = fsm.get_loadcell_stats();
+            switch (item) {
+                case 0:
+                    f.text("# TYPE catfeeder_loadcell_samples_total counter\n")
+                        .text("catfeeder_loadcell_samples_total{sensor=\"reservoir\"} ").natural(stats.samples[0])
+                        .text("\ncatfeeder_loadcell_samples_total{sensor=\"bowl\"} ").natural(stats.samples[1]).character('\n');
+                    return true;
+                case 1:
+                    f.text("# TYPE catfeeder_loadcell_busy_microseconds_total counter\n")
+                        .text("catfeeder_loadcell_busy_microseconds_total{sensor=\"reservoir\"} ").natural(stats.busy_micros[0])
+                        .text("\ncatfeeder_loadcell_busy_microseconds_total{sensor=\"bowl\"} ").natural(stats.busy_micros[1]).character('\n');
+                    return true;
+                case 2:
+                    f.text("# TYPE catfeeder_loadcell_dropped_total counter\ncatfeeder_loadcell_dropped_total ")
+                        .natural(stats.dropped).character('\n');
+                    return true;
+                case 3:
+                    f.text("# TYPE catfeeder_mqtt_publishes_total counter\ncatfeeder_mqtt_publishes_total ")
+                        .natural(diagnostics.mqtt_publishes).character('\n');
+                    return true;
+                case 4:
+                    f.text("# TYPE catfeeder_mqtt_connects_total counter\ncatfeeder_mqtt_connects_total ")
+                        .natural(diagnostics.mqtt_connects).character('\n');
+                    return true;
+                case 5:
+                    f.text("# TYPE catfeeder_mqtt_loop_max_microseconds gauge\ncatfeeder_mqtt_loop_max_microseconds ")
+                        .natural(diagnostics.mqtt_loop_max_micros).character('\n');
+                    return true;
+                case 6:
+                    f.text("# TYPE catfeeder_free_heap_bytes gauge\ncatfeeder_free_heap_bytes ")
+                        .natural(Diagnostics::heap_free()).character('\n');
+                    return true;
+                case 7:
+                    f.text("# TYPE catfeeder_heap_min_free_bytes gauge\ncatfeeder_heap_min_free_bytes ")
+                        .natural(diagnostics.get_heap_min_free()).character('\n');
+                    return true;
+                case 8:
+                    f.text("# TYPE catfeeder_stack_used_bytes gauge\ncatfeeder_stack_used_bytes{core=\"0\"} ")
+                        .natural(diagnostics.stack_used(0))
+                        .text("\ncatfeeder_stack_used_bytes{core=\"1\"} ").natural(diagnostics.stack_used(1)).character('\n');
+                    return true;
+                case 9:
+                    f.text("# TYPE catfeeder_heap_pool_allocations_total counter\ncatfeeder_heap_pool_allocations_total ")
+                        .natural(heap.get_stats().pool_allocations).character('\n');
+                    return true;
+                case 10:
+                    f.text("# TYPE catfeeder_heap_pool_peak_blocks gauge\ncatfeeder_heap_pool_peak_blocks ")
+                        .natural(heap.get_stats().pool_peak).character('\n');
+                    return true;
+                case 11:
+                    f.text("# TYPE catfeeder_heap_escapes_total counter\ncatfeeder_heap_escapes_total ")
+                        .natural(heap.get_stats().escapes).character('\n');
+                    return true;
+                case 12:
+                    f.text("# TYPE catfeeder_uptime_seconds counter\ncatfeeder_uptime_seconds ")
+                        .natural(millis() / 1000).character('\n');
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        case Section::COUNT:
+            return false;
+    }
+    return false;
+}
+
+bool MetricsServer::read_request() {
+    while (client.available()) {
+        const int c = client.read();
+        if (c < 0) break;
+        if (exchange.receive(static_cast<char>(c))) return true;
+    }
+    return false;
+}
+
+void MetricsServer::close() {
+    client.stop();
+    phase = Phase::IDLE;
+}
+
+void MetricsServer::begin() {
+    server.begin();
+}
+
+void MetricsServer::poll() {
+    const Trace::Span span(Trace::Scope::METRICS);
+    switch (phase) {
+        case Phase::IDLE:
+            client = server.accept();
+            if (!client) return;
+            phase = Phase::REQUEST;
+            accept_millis = millis();
+            exchange.reset();
+            return;
+
+        case Phase::REQUEST:
+            if (!client.connected() || millis() - accept_millis > TIMEOUT_MILLIS) {
+                close();
+                return;
+            }
+            if (!read_request()) return;
+            phase = Phase::RESPONSE;
+            return;
+
+        case Phase::RESPONSE:
+            if (!client.connected() || millis() - accept_millis > TIMEOUT_MILLIS) {
+                close();
+                return;
+            }
+            const size_t length = exchange.fill();
+            if (!length) {
+                client.flush();
+                close();
+                return;
+            }
+            if (client.availableForWrite() < static_cast<int>(length)) return;
+            client.write(exchange.get_buffer(), length);
+            exchange.consume();
+            return;
+    }
+}
@@ -0,0 +1,142 @@
+#include "query.h"
+#include "format.h"
+#include "trace.h"
+
+HistoryQuery::HistoryQuery(HAMqtt &mqtt, const WeightLog &log) : mqtt(mqtt), log(log) {
+}
+
+void HistoryQuery::on_connected() {
+    mqtt.subscribe(REQUEST_TOPIC);
+}
+
+bool HistoryQuery::on_message(const char *topic, const uint8_t *payload, const uint16_t length) {
+    if (strcmp(topic, REQUEST_TOPIC)) return false;
+
+    // Parse up to four space-separated unsigned fields.
+    uint32_t fields[4] = {0, 0, UINT32_MAX, 0};
+    size_t field = 0;
+    bool digits = false;
+    for (uint16_t i = 0; i < length && field < 4; i++) {
+        const char c = static_cast<char>(payload[i]);
+        if (c >= '0' && c <= '9') {
+            if (!digits) fields[field] = 0;
+            fields[field] = fields[field] * 10 + (c - '0');
+            digits = true;
+        } else if (digits) {
+            field++;
+            digits = false;
+        }
+    }
+
+    // Start the query, aborting any query in progress.
+    id = fields[0];
+    from = fields[1];
+    to = fields[2];
+    resolution = fields[3];
+    reader.emplace(log);
+    memset(accumulators, 0, sizeof(accumulators));
+    exhausted = false;
+    pending_valid = false;
+    records_length = 0;
+    sequence = 0;
+    sent = 0;
+    return true;
+}
+
+bool HistoryQuery::produce(WeightLog::Record &out, size_t &budget) {
+    while (budget) {
+        WeightLog::Record record = {};
+        if (!reader->next(record)) {
+            // Flush the downsampling buckets, unless they are incomplete
+            // because the query was aborted.
+            for (size_t type = 0; !reader->is_aborted() && type < static_cast<size_t>(WeightLog::Type::COUNT); type++) {
+                auto &acc = accumulators[type];
+                if (!acc.count) continue;
+                out = {acc.start, static_cast<WeightLog::Type>(type), acc.sum / acc.count};
+                acc.count = 0;
+                return true;
+            }
+            exhausted = true;
+            return false;
+        }
+        budget--;
+        if (record.time < from || record.time > to) continue;
+        if (!resolution) {
+            out = record;
+            return true;
+        }
+        auto &acc = accumulators[static_cast<size_t>(record.type)];
+        const uint32_t start = record.time - record.time % resolution;
+        if (acc.count && acc.start != start) {
+            out = {acc.start, record.type, acc.sum / acc.count};
+            acc = {start, record.value, 1};
+            return true;
+        }
+        acc.start = start;
+        acc.sum += record.value;
+        acc.count++;
+    }
+    return false;
+}
+
+bool HistoryQuery::append(const WeightLog::Record &record) {
+    char item[40];
+    Formatter f(item);
+    if (records_length) f.character(',');
+    f.character('[').integer(static_cast<int32_t>(record.time)).character(',')
+        .integer(static_cast<int32_t>(record.type)).character(',')
+        .decimal(static_cast<float>(record.value) / 10.0f).character(']');
+    if (records_length + f.get_length() >= sizeof(records)) return false;
+    memcpy(records + records_length, item, f.get_length() + 1);
+    records_length += f.get_length();
+    sent++;
+    return true;
+}
+
+void HistoryQuery::publish(const bool done) {
+    char header[48];
+    Formatter h(header);
+    h.text("{\"id\":").integer(static_cast<int32_t>(id)).text(",\"seq\":").integer(sequence).text(",\"r\":[");
+    char footer[40];
+    Formatter t(footer);
+    t.text("],\"done\":").integer(done);
+    if (done) t.text(",\"n\":").integer(static_cast<int32_t>(sent));
+    if (done && reader->is_aborted()) t.text(",\"aborted\":1");
+    t.character('}');
+    const auto length = static_cast<uint16_t>(h.get_length() + records_length + t.get_length());
+    if (mqtt.beginPublish(RESPONSE_TOPIC, length)) {
+        mqtt.writePayload(header, h.get_length());
+        mqtt.writePayload(records, records_length);
+        mqtt.writePayload(footer, t.get_length());
+        mqtt.endPublish();
+    }
+    records_length = 0;
+    sequence++;
+}
+
+void HistoryQuery::poll() {
+    const Trace::Span span(Trace::Scope::HISTORY_QUERY);
+    if (!reader) return;
+    if (!mqtt.isConnected()) {
+        reader.reset();
+        return;
+    }
+    size_t budget = DECODE_BUDGET;
+    while (true) {
+        if (!pending_valid) {
+            if (!produce(pending, budget)) {
+                if (!exhausted) return;
+                publish(true);
+                reader.reset();
+                return;
+            }
+            pending_valid = true;
+        }
+        if (!append(pending)) {
+            // Chunk is full; send it and continue on the next poll.
+            publish(false);
+            return;
+        }
+        pending_valid = false;
+    }
+}
@@ -0,0 +1,87 @@
+#include "recorder.h"
+
+void RenderRecorder::record(const uint32_t pixels) {
+    stats.calls++;
+    stats.pixels += pixels;
+    stats.spi_bytes += BYTES_PER_CALL + pixels * 2;
+}
+
+RenderRecorder::RenderRecorder(Adafruit_GFX &target, BlitTarget &blit_target, const uint32_t spi_frequency) : Adafruit_GFX(target.width(), target.height()), target(target), blit_target(blit_target), spi_frequency(spi_frequency) {
+}
+
+void RenderRecorder::drawPixel(const int16_t x, const int16_t y, const uint16_t color) {
+    record(1);
+    target.drawPixel(x, y, color);
+}
+
+void RenderRecorder::startWrite() {
+    if (!write_depth++) stats.transactions++;
+    target.startWrite();
+}
+
+void RenderRecorder::writePixel(const int16_t x, const int16_t y, const uint16_t color) {
+    record(1);
+    target.writePixel(x, y, color);
+}
+
+void RenderRecorder::writeFillRect(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const uint16_t color) {
+    record(w * h);
+    target.writeFillRect(x, y, w, h, color);
+}
+
+void RenderRecorder::writeFastVLine(const int16_t x, const int16_t y, const int16_t h, const uint16_t color) {
+    record(h);
+    target.writeFastVLine(x, y, h, color);
+}
+
+void RenderRecorder::writeFastHLine(const int16_t x, const int16_t y, const int16_t w, const uint16_t color) {
+    record(w);
+    target.writeFastHLine(x, y, w, color);
+}
+
+void RenderRecorder::endWrite() {
+    if (write_depth) write_depth--;
+    target.endWrite();
+}
+
+void RenderRecorder::drawFastVLine(const int16_t x, const int16_t y, const int16_t h, const uint16_t color) {
+    if (!write_depth) stats.transactions++;
+    record(h);
+    target.drawFastVLine(x, y, h, color);
+}
+
+void RenderRecorder::drawFastHLine(const int16_t x, const int16_t y, const int16_t w, const uint16_t color) {
+    if (!write_depth) stats.transactions++;
+    record(w);
+    target.drawFastHLine(x, y, w, color);
+}
+
+void RenderRecorder::fillRect(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const uint16_t color) {
+    if (!write_depth) stats.transactions++;
+    record(w * h);
+    target.fillRect(x, y, w, h, color);
+}
+
+void RenderRecorder::fillScreen(const uint16_t color) {
+    if (!write_depth) stats.transactions++;
+    record(width() * height());
+    target.fillScreen(color);
+}
+
+void RenderRecorder::blit(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const uint16_t *pixels) {
+    if (!write_depth) stats.transactions++;
+    record(w * h);
+    blit_target.blit(x, y, w, h, pixels);
+}
+
+[[nodiscard]] const RenderRecorder::Stats &RenderRecorder::get_stats() const {
+    return stats;
+}
+
+[[nodiscard]] uint32_t RenderRecorder::get_spi_micros() const {
+    return static_cast<uint32_t>(static_cast<uint64_t>(stats.spi_bytes) * 8 * 1000000 / spi_frequency);
+}
+
+void RenderRecorder::reset() {
+    stats = {};
+}
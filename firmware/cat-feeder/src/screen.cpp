@@ -0,0 +1,259 @@
+#include "screen.h"
+
+#include <WiFi.h>
+
+#include "format.h"
+
+Screen::Screen(Adafruit_GFX &gfx, BlitTarget &blitter) : gfx(gfx), blitter(blitter) {
+    line_canvas.setTextWrap(false);
+}
+
+void Screen::apply_palette(const PaletteId id) {
+    const Palette &p = palette(id);
+    color_fg = p.fg;
+    color_gr = p.gr;
+    color_bg = p.bg;
+    color_arc = p.arc;
+    color_track = p.track;
+    brightness = p.brightness;
+}
+
+void Screen::render_line(const int16_t row, const char *buffer, const uint8_t scale, const bool grayed) {
+    size_t w = strlen(buffer) * 6u * scale;
+    const int16_t h = 8 * scale;
+    if (w > 240) w = 240;
+    const auto x = static_cast<int16_t>((240 - w) / 2);
+    line_canvas.fillRect(0, row, 240, h, color_bg);
+    if (!w) return;
+    line_canvas.setCursor(x, row);
+    line_canvas.setTextColor(grayed ? color_gr : color_fg, color_bg);
+    line_canvas.setTextSize(scale);
+    line_canvas.print(buffer);
+}
+
+void Screen::clear_lines(const int16_t row, const int16_t rows) {
+    line_canvas.fillRect(0, row, 240, rows, color_bg);
+}
+
+void Screen::push_lines(const int16_t y, const int16_t rows) {
+    blitter.blit(0, y, 240, rows, line_canvas.getBuffer());
+}
+
+void Screen::preprocess(const Snapshot &snapshot) {
+    const auto &error_report = snapshot.error_report;
+    const auto &feed_report = snapshot.feed_report;
+    feed_report_string[0] = 0;
+    switch (feed_report.result) {
+        case FeedResult::NONE:
+            strcpy(feed_report_string, text(Text::FEED_NONE));
+            break;
+        case FeedResult::SUCCESS: {
+            unsigned long ms = millis() - feed_report.millis;
+            Formatter(feed_report_string).clock(ms / 1000).text("   ").decimal(static_cast<float>(feed_report.arg) / 1000.0f, 7).character('g');
+            break;
+        }
+        case FeedResult::SENSOR_RETRY:
+            Formatter(feed_report_string).text(text(Text::FEED_NOISE)).integer(feed_report.arg).character(')');
+            break;
+    }
+
+    // Pick colors and status LED pattern based on severity.
+    led_count = 0;
+    switch (error_report.severity) {
+        case ErrorSeverity::OKAY:
+            if (snapshot.maintenance) {
+                apply_palette(PaletteId::MAINTENANCE);
+                led_pattern = LedPattern::BREATHE;
+            } else {
+                apply_palette(PaletteId::OPERATIONAL);
+                led_pattern = LedPattern::OFF;
+            }
+            break;
+        case ErrorSeverity::WARNING:
+            apply_palette(PaletteId::WARNING);
+            led_pattern = LedPattern::BLINK;
+            break;
+        case ErrorSeverity::ERROR:
+            apply_palette(PaletteId::ERROR);
+            if (!((millis() >> 9) & 1)) brightness = palette(PaletteId::OPERATIONAL).brightness;
+            led_pattern = LedPattern::FLASH;
+            led_count = static_cast<uint8_t>(error_report.code);
+            break;
+    }
+
+    // Pick status message to print.
+    status_grayed = false;
+    if (error_report.code != ErrorCode::NONE) {
+        strcpy(status_string, text(error_report.code));
+    } else {
+        switch (snapshot.wifi_status) {
+            case WL_IDLE_STATUS:
+                strcpy(status_string, text(Text::WIFI_IDLE));
+                break;
+            case WL_NO_SSID_AVAIL:
+                strcpy(status_string, text(Text::WIFI_NO_SSID));
+                break;
+            case WL_SCAN_COMPLETED:
+                strcpy(status_string, text(Text::WIFI_SCAN_COMPLETE));
+                break;
+            case WL_CONNECTED:
+                switch (snapshot.mqtt_state) {
+                case HAMqtt::StateConnecting:
+                    strcpy(status_string, text(Text::MQTT_CONNECTING));
+                    break;
+                case HAMqtt::StateConnectionTimeout:
+                    strcpy(status_string, text(Text::MQTT_CONNECTION_TIMEOUT));
+                    break;
+                case HAMqtt::StateConnectionLost:
+                    strcpy(status_string, text(Text::MQTT_CONNECTION_LOST));
+                    break;
+                case HAMqtt::StateConnectionFailed:
+                    strcpy(status_string, text(Text::MQTT_CONNECTION_FAILED));
+                    break;
+                case HAMqtt::StateDisconnected:
+                    strcpy(status_string, text(Text::MQTT_DISCONNECTED));
+                    break;
+                case HAMqtt::StateConnected:
+                    status_grayed = true;
+                    Formatter(status_string).ip(snapshot.ip);
+                    break;
+                case HAMqtt::StateBadProtocol:
+                    strcpy(status_string, text(Text::MQTT_BAD_PROTOCOL));
+                    break;
+                case HAMqtt::StateBadClientId:
+                    strcpy(status_string, text(Text::MQTT_BAD_CLIENT_ID));
+                    break;
+                case HAMqtt::StateUnavailable:
+                    strcpy(status_string, text(Text::MQTT_UNAVAILABLE));
+                    break;
+                case HAMqtt::StateBadCredentials:
+                    strcpy(status_string, text(Text::MQTT_BAD_CREDENTIALS));
+                    break;
+                case HAMqtt::StateUnauthorized:
+                    strcpy(status_string, text(Text::MQTT_UNAUTHORIZED));
+                    break;
+                }
+                break;
+            case WL_CONNECT_FAILED:
+                strcpy(status_string, text(Text::WIFI_CONNECT_FAILED));
+                break;
+            case WL_CONNECTION_LOST:
+                strcpy(status_string, text(Text::WIFI_CONNECTION_LOST));
+                break;
+            case WL_DISCONNECTED:
+                strcpy(status_string, text(Text::WIFI_DISCONNECTED));
+                break;
+            default:
+                Formatter(status_string).text(text(Text::WIFI_STATUS)).integer(snapshot.wifi_status);
+                break;
+        }
+    }
+}
+
+[[nodiscard]] bool Screen::at_frame_start() const {
+    return update_state == 0;
+}
+
+bool Screen::update(const Snapshot &snapshot) {
+    switch (update_state) {
+        case 0:
+            preprocess(snapshot);
+            break;
+
+        case 1:
+            render_line(0, text(Text::LAST_FEED), 2, true);
+            render_line(16, feed_report_string, 2);
+            push_lines(68, 32);
+            break;
+
+        case 2:
+            clear_lines(0, 8);
+            render_line(8, snapshot.state_report.header, 2, true);
+            push_lines(100, 24);
+            break;
+
+        case 3:
+            if (snapshot.state_report.large) {
+                render_line(0, snapshot.state_report.detail1, 4);
+            } else {
+                render_line(0, snapshot.state_report.detail1, 2);
+                render_line(16, snapshot.state_report.detail2, 2);
+            }
+            push_lines(124, 32);
+            progress_arc.update(gfx, snapshot.state_report.progress, color_arc, color_track);
+            break;
+
+        case 4:
+            clear_lines(0, 8);
+            render_line(8, status_string, 2, status_grayed);
+            push_lines(156, 24);
+            // fallthrough
+
+        default:
+            update_state = 0;
+            return true;
+    }
+    update_state++;
+    return false;
+}
+
+void Screen::update_diagnostics(const DiagnosticsSnapshot &d) {
+    char lines[DIAGNOSTICS_LINES][21];
+    strcpy(lines[0], text(Text::DIAGNOSTICS));
+    Formatter(lines[1]).text(text(Text::DIAGNOSTICS_LOOP)).integer(static_cast<int32_t>(d.loop_p99_micros)).text("us");
+    Formatter(lines[2]).text(text(Text::DIAGNOSTICS_RESERVOIR)).integer(static_cast<int32_t>(d.sample_rate_decihertz[0] / 10)).character('.').integer(static_cast<int32_t>(d.sample_rate_decihertz[0] % 10)).text("Hz");
+    Formatter(lines[3]).text(text(Text::DIAGNOSTICS_BOWL)).integer(static_cast<int32_t>(d.sample_rate_decihertz[1] / 10)).character('.').integer(static_cast<int32_t>(d.sample_rate_decihertz[1] % 10)).text("Hz");
+    Formatter(lines[4]).text(text(Text::DIAGNOSTICS_DROPPED)).integer(static_cast<int32_t>(d.dropped_samples));
+    Formatter(lines[5]).text(text(Text::DIAGNOSTICS_PUBLISHES)).integer(static_cast<int32_t>(d.mqtt_publishes));
+    Formatter(lines[6]).text(text(Text::DIAGNOSTICS_CONNECTS)).integer(static_cast<int32_t>(d.mqtt_connects));
+    Formatter(lines[7]).text(text(Text::DIAGNOSTICS_HEAP)).integer(static_cast<int32_t>(d.free_heap / 1024)).text("kB");
+    Formatter(lines[8]).text(text(Text::DIAGNOSTICS_STACK)).integer(static_cast<int32_t>(d.stack_used[0])).character('/').integer(static_cast<int32_t>(d.stack_used[1]));
+    for (size_t i = 0; i < DIAGNOSTICS_LINES; i++) {
+        if (!strcmp(lines[i], diagnostics_lines[i])) continue;
+        strcpy(diagnostics_lines[i], lines[i]);
+        render_line(0, lines[i], 2, i == 0);
+        push_lines(static_cast<int16_t>(48 + 16 * i), 16);
+    }
+}
+
+
+void Screen::begin() {
+    update_state = 0;
+    gfx.fillRect(0, 60, 240, 120, 0);
+    progress_arc.begin(gfx);
+
+    // Show a status frame right away; the main core may still be setting
+    // up or waiting for its first measurement.
+    apply_palette(PaletteId::OPERATIONAL);
+    clear_lines(0, 8);
+    render_line(8, text(Text::BOOTING), 2, true);
+    push_lines(156, 24);
+}
+
+void Screen::clear(const bool diagnostics) {
+    gfx.fillScreen(0);
+    if (diagnostics) {
+        apply_palette(PaletteId::DIAGNOSTICS);
+        memset(diagnostics_lines, 0, sizeof(diagnostics_lines));
+    } else {
+        progress_arc.invalidate();
+        update_state = 0;
+    }
+}
+
+void Screen::draw_line(const int16_t y, const char *text) {
+    render_line(0, text, 2);
+    push_lines(y, 16);
+}
+
+[[nodiscard]] uint8_t Screen::get_brightness() const {
+    return brightness;
+}
+
+[[nodiscard]] LedPattern Screen::get_led_pattern() const {
+    return led_pattern;
+}
+
+[[nodiscard]] uint8_t Screen::get_led_count() const {
+    return led_count;
+}
@@ -0,0 +1,45 @@
+#include "sequence.h"
+
+[[nodiscard]] uint16_t LedSequence::period(const LedPattern pattern, const uint8_t count) {
+    switch (pattern) {
+        case LedPattern::OFF:
+        case LedPattern::ON:
+            return 1;
+        case LedPattern::BLINK:
+            return 16;
+        case LedPattern::BREATHE:
+            return 40;
+        case LedPattern::FLASH:
+            // 150ms on, 150ms off per flash, then a 700ms pause.
+            return static_cast<uint16_t>(count * 6 + 14);
+    }
+    return 1;
+}
+
+[[nodiscard]] uint8_t LedSequence::level(const LedPattern pattern, const uint8_t count, const uint16_t step) {
+    switch (pattern) {
+        case LedPattern::OFF:
+            return 0;
+        case LedPattern::ON:
+            return 255;
+        case LedPattern::BLINK:
+            return step < 8 ? 255 : 0;
+        case LedPattern::BREATHE:
+            return static_cast<uint8_t>((step < 20 ? step : 39 - step) * 255 / 19);
+        case LedPattern::FLASH:
+            return step < count * 6 && step % 6 < 3 ? 255 : 0;
+    }
+    return 0;
+}
+
+uint8_t LedSequence::next(const uint16_t current) {
+    if (current != playing) {
+        playing = current;
+        step = 0;
+    }
+    const auto pattern = static_cast<LedPattern>(current & 0xFF);
+    const auto count = static_cast<uint8_t>(current >> 8);
+    const uint8_t brightness = level(pattern, count, step);
+    if (++step >= period(pattern, count)) step = 0;
+    return brightness;
+}
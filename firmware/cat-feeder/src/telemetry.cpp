@@ -0,0 +1,44 @@
+#include "hot.h"
+#include "telemetry.h"
+#include "trace.h"
+
+Telemetry telemetry;
+
+void HOT(Telemetry::append)(const Event event, const uint8_t arg, const int32_t value) {
+    buffer.append(event, arg, value, micros());
+}
+
+void Telemetry::begin() {
+    if (ENABLED) udp.begin(PORT);
+}
+
+void Telemetry::poll() {
+    const Trace::Span span(Trace::Scope::TELEMETRY);
+    if (!ENABLED) return;
+
+    // Seal the partially filled buffer at the cadence.
+    if (millis() - send_millis >= CADENCE_MILLIS) {
+        send_millis = millis();
+        buffer.seal();
+    }
+
+    // Send the sealed buffer, if any. lwIP copies the datagram, so the
+    // buffer is free again afterwards whether or not sending worked.
+    const TelemetryBuffer::Datagram datagram = buffer.sealed();
+    if (!datagram.length) return;
+    bool sent = false;
+    if (WiFi.status() == WL_CONNECTED && udp.beginPacket(IPAddress(HOST[0], HOST[1], HOST[2], HOST[3]), PORT)) {
+        udp.write(datagram.data, datagram.length);
+        sent = udp.endPacket();
+    }
+    if (!sent) send_failures++;
+    buffer.release();
+}
+
+[[nodiscard]] uint32_t Telemetry::get_dropped() const {
+    return buffer.get_dropped();
+}
+
+[[nodiscard]] uint32_t Telemetry::get_send_failures() const {
+    return send_failures;
+}
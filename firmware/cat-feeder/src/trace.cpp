@@ -0,0 +1,37 @@
+#include "trace.h"
+
+Trace trace;
+
+void Trace::dump(Print &out) {
+    static constexpr const char *EVENT_NAMES[] = {"begin", "end", "state", "sample", "limit", "motor", "publish"};
+    static constexpr const char *SCOPE_NAMES[] = {
+        "ui.update", "fsm.update", "loadcell.update", "mqtt.loop", "discovery",
+        "history_query", "metrics", "telemetry", "console", "ui.render",
+    };
+    static_assert(sizeof(EVENT_NAMES) / sizeof(EVENT_NAMES[0]) == static_cast<size_t>(Event::COUNT), "event names");
+    static_assert(sizeof(SCOPE_NAMES) / sizeof(SCOPE_NAMES[0]) == static_cast<size_t>(Scope::COUNT), "scope names");
+
+    if (!ENABLED) {
+        out.println("# trace disabled, define TRACE_ENABLE in trace.h");
+        return;
+    }
+    frozen = true;
+    out.println("# trace v1: core,micros,event,arg,value");
+    for (unsigned core = 0; core < 2; core++) {
+        const uint32_t head = heads[core];
+        const uint32_t length = head < RING_SIZE ? head : RING_SIZE;
+        for (uint32_t i = head - length; i != head; i++) {
+            const Record &r = rings[core][i & (RING_SIZE - 1)];
+            const auto event = static_cast<size_t>(r.event);
+            out.printf("%u,%lu,%s,", core, static_cast<unsigned long>(r.micros), EVENT_NAMES[event]);
+            if (r.event == Event::BEGIN || r.event == Event::END) {
+                out.print(SCOPE_NAMES[r.arg]);
+            } else {
+                out.print(r.arg);
+            }
+            out.printf(",%ld\n", static_cast<long>(r.value));
+        }
+    }
+    out.println("# end");
+    frozen = false;
+}
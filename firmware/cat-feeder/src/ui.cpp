@@ -1,182 +1,61 @@
 #include "ui.h"
 
-#include <WiFi.h>
-
-void UserInterface::render_line(const size_t y, const char *buffer, const size_t scale, const bool grayed) {
-    size_t w = strlen(buffer) * 6u * scale;
-    const size_t h = 8u * scale;
-    if (w > 240) w = 240;
-    const size_t x = (240 - w) / 2;
-    const size_t r = 240 - x - w;
-    if (x) tft.fillRect(0, y, x, h, color_bg);
-    if (r) tft.fillRect(x + w, y, r, h, color_bg);
-    if (!w) return;
-    tft.setCursor(x, y);
-    tft.setTextColor(grayed ? color_gr : color_fg, color_bg);
-    tft.setTextSize(scale);
-    tft.setTextWrap(false);
-    tft.print(buffer);
+#include "boot.h"
+#include "trace.h"
+
+void UserInterface::post_snapshot() {
+    Snapshot next = {};
+    next.error_report = fsm.get_error_report();
+    fsm.get_state_report(next.state_report);
+    next.feed_report = fsm.get_feed_report();
+    next.maintenance = fsm.maintenance();
+    next.wifi_status = status.wifi_status();
+    next.mqtt_state = mqtt.getState();
+    status.local_ip(next.ip);
+    next.micros = micros();
+    snapshot_mailbox.post(next);
 }
 
-void UserInterface::display_preprocess() {
-    error_report = fsm.get_error_report();
-    state_report = {};
-    fsm.get_state_report(state_report);
-    feed_report = fsm.get_feed_report();
-    feed_report_string[0] = 0;
-    switch (feed_report.result) {
-        case StateMachine::FeedResult::NONE:
-            strcpy(feed_report_string, "None");
-            break;
-        case StateMachine::FeedResult::SUCCESS: {
-            unsigned long ms = millis() - feed_report.millis;
-            int s = static_cast<int>(ms / 1000);
-            int m = s / 60;
-            s -= m * 60;
-            int h = m / 60;
-            m -= h * 60;
-            snprintf(feed_report_string, sizeof(feed_report_string), "%d:%02d:%02d   %7.1fg", h, m, s, static_cast<float>(feed_report.arg) / 1000.0f);
-            break;
-        }
-        case StateMachine::FeedResult::SENSOR_RETRY:
-            snprintf(feed_report_string, sizeof(feed_report_string), "Noise on sensor (x%d)", feed_report.arg);
-            break;
-    }
-
-    // Pick colors based on severity.
-    switch (error_report.severity) {
-        case StateMachine::ErrorSeverity::OKAY:
-            if (fsm.maintenance()) {
-                color_fg = 0b0000011111111000;
-                color_gr = 0b0000010000001100;
-                color_bg = 0;
-                brightness = 255;
-            } else {
-                color_fg = 0b1100011111100000;
-                color_gr = 0b0110010000000000;
-                color_bg = 0;
-                brightness = 32;
-            }
-            break;
-        case StateMachine::ErrorSeverity::WARNING:
-            color_fg = 0;
-            color_gr = 0b1000001000000000;
-            color_bg = 0b1111110000000000;
-            brightness = 255;
-            break;
-        case StateMachine::ErrorSeverity::ERROR:
-            color_fg = 0;
-            color_gr = 0b1000000000000000;
-            color_bg = 0b1111100000000000;
-            brightness = ((millis() >> 9) & 1) ? 255 : 32;
-            break;
+void UserInterface::post_diagnostics() {
+    DiagnosticsSnapshot next = {};
+    next.loop_p99_micros = diagnostics.loop_histogram.percentile(diagnostics_prev_loop, 990);
+    diagnostics_prev_loop = diagnostics.loop_histogram;
+    const auto &loadcell = fsm.get_loadcell_stats();
+    for (size_t i = 0; i < 2; i++) {
+        const uint32_t samples = loadcell.samples[i] - diagnostics_prev_loadcell.samples[i];
+        const uint32_t busy = loadcell.busy_micros[i] - diagnostics_prev_loadcell.busy_micros[i];
+        next.sample_rate_decihertz[i] = busy ? static_cast<uint32_t>(static_cast<uint64_t>(samples) * 10000000 / busy) : 0;
     }
+    next.dropped_samples = loadcell.dropped;
+    diagnostics_prev_loadcell = loadcell;
+    next.mqtt_publishes = diagnostics.mqtt_publishes;
+    next.mqtt_connects = diagnostics.mqtt_connects;
+    next.free_heap = status.free_heap();
+    next.stack_used[0] = diagnostics.stack_used(0);
+    next.stack_used[1] = diagnostics.stack_used(1);
+    diagnostics_mailbox.post(next);
+}
 
-    // Pick status message to print.
-    status_grayed = false;
-    if (error_report.message) {
-        snprintf(status_string, sizeof(status_string), "%s", error_report.message);
-    } else {
-        switch (WiFi.status()) {
-            case WL_IDLE_STATUS:
-                strcpy(status_string, "WiFi: idle");
-                break;
-            case WL_NO_SSID_AVAIL:
-                strcpy(status_string, "WiFi: no SSID");
-                break;
-            case WL_SCAN_COMPLETED:
-                strcpy(status_string, "WiFi: scan complete");
-                break;
-            case WL_CONNECTED:
-                switch (mqtt.getState()) {
-                case HAMqtt::StateConnecting:
-                    strcpy(status_string, "MQTT: connecting");
-                    break;
-                case HAMqtt::StateConnectionTimeout:
-                    strcpy(status_string, "MQTT: conn. timeout");
-                    break;
-                case HAMqtt::StateConnectionLost:
-                    strcpy(status_string, "MQTT: conn. lost");
-                    break;
-                case HAMqtt::StateConnectionFailed:
-                    strcpy(status_string, "MQTT: connect failed");
-                    break;
-                case HAMqtt::StateDisconnected:
-                    strcpy(status_string, "MQTT: disconnected");
-                    break;
-                case HAMqtt::StateConnected:
-                    status_grayed = true;
-                    snprintf(status_string, sizeof(status_string), "%s", WiFi.localIP().toString().c_str());
-                    break;
-                case HAMqtt::StateBadProtocol:
-                    strcpy(status_string, "MQTT: bad protocol");
-                    break;
-                case HAMqtt::StateBadClientId:
-                    strcpy(status_string, "MQTT: bad client ID");
-                    break;
-                case HAMqtt::StateUnavailable:
-                    strcpy(status_string, "MQTT: unavailable");
-                    break;
-                case HAMqtt::StateBadCredentials:
-                    strcpy(status_string, "MQTT: bad login");
-                    break;
-                case HAMqtt::StateUnauthorized:
-                    strcpy(status_string, "MQTT: unauthorized");
-                    break;
-                }
-                break;
-            case WL_CONNECT_FAILED:
-                strcpy(status_string, "WiFi: connect failed");
-                break;
-            case WL_CONNECTION_LOST:
-                strcpy(status_string, "WiFi: conn. lost");
-                break;
-            case WL_DISCONNECTED:
-                strcpy(status_string, "WiFi: disconnected");
-                break;
-            default:
-                snprintf(status_string, sizeof(status_string), "WiFi: status %d", WiFi.status());
-                break;
-        }
-    }
+void UserInterface::show_diagnostics(const bool show) {
+    diagnostics_shown = show;
+    screen.clear(show);
+    if (show) analogWrite(PIN_TFT_BL, screen.get_brightness());
 }
 
-void UserInterface::display_update() {
-    switch (display_update_state) {
-        case 0:
-            display_preprocess();
-            break;
-
-        case 1:
-            render_line(68, "Last feed", 2, true);
-            render_line(84, feed_report_string, 2);
-            break;
-
-        case 2:
-            tft.fillRect(0, 100, 240, 8, color_bg);
-            render_line(108, state_report.header, 2, true);
-            break;
-
-        case 3:
-            if (state_report.large) {
-                render_line(124, state_report.detail1, 4);
-            } else {
-                render_line(124, state_report.detail1, 2);
-                render_line(140, state_report.detail2, 2);
-            }
-            break;
-
-        case 4:
-            tft.fillRect(0, 156, 240, 8, color_bg);
-            render_line(164, status_string, 2, status_grayed);
-            analogWrite(PIN_TFT_BL, brightness);
-            // fallthrough
-
-        default:
-            display_update_state = 0;
-            return;
-    }
-    display_update_state++;
+void UserInterface::finish_frame() {
+    status_led.set(screen.get_led_pattern(), screen.get_led_count());
+    analogWrite(PIN_TFT_BL, screen.get_brightness());
+    boot.mark(Boot::Phase::FIRST_FRAME);
+#ifdef DEBUG_UI_RECORD
+    const auto &stats = recorder.get_stats();
+    const unsigned long latency = micros() - snapshot.micros;
+    if (latency > max_latency_micros) max_latency_micros = latency;
+    Serial.printf("Frame: %u calls, %u transactions, %u pixels, ~%uus SPI, latency %luus (max %luus)\n",
+        static_cast<unsigned>(stats.calls), static_cast<unsigned>(stats.transactions),
+        static_cast<unsigned>(stats.pixels), static_cast<unsigned>(recorder.get_spi_micros()),
+        latency, max_latency_micros);
+    recorder.reset();
+#endif
 }
 
 UserInterface::Button::Button(const int pin) : pin(pin) {}
@@ -186,6 +65,10 @@ void UserInterface::Button::begin() {
     state = 0;
 }
 
+[[nodiscard]] bool UserInterface::Button::held() const {
+    return state != 0;
+}
+
 bool UserInterface::Button::update() {
     if (digitalRead(pin) == LOW) {
         state = 3;
@@ -196,15 +79,19 @@ bool UserInterface::Button::update() {
     return false;
 }
 
-UserInterface::UserInterface(StateMachine &fsm, HAMqtt &mqtt) : tft(&SPI, PIN_TFT_DC, PIN_TFT_CS, PIN_TFT_RST), fsm(fsm), mqtt(mqtt) {
+#ifdef DEBUG_UI_RECORD
+UserInterface::UserInterface(StateMachine &fsm, HAMqtt &mqtt, RenderRecorder &recorder, PanelControl &panel, SystemStatus &status) :
+    recorder(recorder), gfx(recorder), blitter(recorder), panel(panel), status(status), fsm(fsm), mqtt(mqtt) {
 }
+#else
+UserInterface::UserInterface(StateMachine &fsm, HAMqtt &mqtt, Adafruit_GFX &gfx, BlitTarget &blitter, PanelControl &panel, SystemStatus &status) :
+    gfx(gfx), blitter(blitter), panel(panel), status(status), fsm(fsm), mqtt(mqtt) {
+}
+#endif
 
 void UserInterface::begin() {
-    display_update_state = 0;
-
     // Initialize pins.
-    pinMode(PIN_FP_LED, OUTPUT);
-    digitalWrite(PIN_FP_LED, LOW);
+    status_led.begin();
     pinMode(PIN_TFT_BL, OUTPUT);
     digitalWrite(PIN_TFT_BL, LOW);
 
@@ -217,25 +104,116 @@ void UserInterface::begin() {
     key_mic.begin();
 
     // Initialize display.
-    SPI.setTX(PIN_TFT_SDA);
-    SPI.setSCK(PIN_TFT_SCL);
-    tft.begin();
-    tft.setRotation(3);
-    tft.fillRect(0, 60, 240, 120, 0);
-
+    panel.set_rotation(3);
+    screen.begin();
+    analogWrite(PIN_TFT_BL, screen.get_brightness());
+    boot.mark(Boot::Phase::DISPLAY_READY);
 }
 
 void UserInterface::update() {
+    const Trace::Span span(Trace::Scope::UI_UPDATE);
 
-    // Update the display.
-    display_update();
+    // Send a new snapshot to the rendering core.
+    if (millis() - snapshot_millis >= SNAPSHOT_INTERVAL_MILLIS) {
+        snapshot_millis = millis();
+        post_snapshot();
+    }
 
-    // Update the keys.
-    key_set.update(); // TODO
-    if (key_feed.update()) fsm.feed();
-    if (key_up.update()) fsm.tare_reservoir();
-    if (key_down.update()) fsm.tare_bowl();
-    if (key_lock.update()) fsm.reset();
-    if (key_mic.update()) fsm.enter_maintenance();
+    // Send diagnostics only while they're being shown.
+    const bool shown = diagnostics_shown;
+    if (shown && (!diagnostics_was_shown || millis() - diagnostics_millis >= DIAGNOSTICS_INTERVAL_MILLIS)) {
+        diagnostics_millis = millis();
+        post_diagnostics();
+    }
+    diagnostics_was_shown = shown;
+
+    // Handle key events.
+    ButtonEvent event;
+    while (button_queue.pop(event)) {
+        switch (event) {
+            case ButtonEvent::SET: break; // TODO
+            case ButtonEvent::FEED: fsm.feed(); break;
+            case ButtonEvent::UP: fsm.tare_reservoir(); break;
+            case ButtonEvent::DOWN: fsm.tare_bowl(); break;
+            case ButtonEvent::LOCK: fsm.reset(); break;
+            case ButtonEvent::MIC: fsm.enter_maintenance(); break;
+        }
+    }
+
+}
+
+void UserInterface::run_benchmark() {
+    static const char *const LINE = "Benchmark 0123456789";
+    BenchmarkResult result = {};
+    for (size_t i = 0; i < BenchmarkResult::NUM_SETTINGS; i++) {
+        auto &setting = result.settings[i];
+        setting.frequency = BENCHMARK_FREQUENCIES[i];
+        panel.set_spi_speed(setting.frequency);
+
+        // Full-screen fill.
+        unsigned long start = micros();
+        gfx.fillScreen(i & 1 ? 0xFFFF : 0x0000);
+        setting.fill_micros = micros() - start;
+
+        // Text line at 2x scale, including rendering to the line canvas.
+        start = micros();
+        screen.draw_line(120, LINE);
+        setting.line_micros = micros() - start;
+    }
+    panel.set_spi_speed(SPI_FREQUENCY);
+
+    // Clear the screen and forget what was on it, for whichever page is
+    // showing.
+    show_diagnostics(diagnostics_shown);
+    benchmark_mailbox.post(result);
+}
+
+void UserInterface::render() {
+    const Trace::Span span(Trace::Scope::UI_RENDER);
+
+    // Run the display benchmark if requested.
+    if (benchmark_requested) {
+        benchmark_requested = false;
+        run_benchmark();
+    }
+
+    // Update the display, once the main core has sent us something to show.
+    if (diagnostics_shown) {
+        if (diagnostics_mailbox.fetch(diagnostics_snapshot, diagnostics_sequence)) {
+            screen.update_diagnostics(diagnostics_snapshot);
+        }
+    } else {
+        // Take the latest snapshot at the start of each frame.
+        if (screen.at_frame_start()) snapshot_mailbox.fetch(snapshot, snapshot_sequence);
+        if (snapshot_sequence && screen.update(snapshot)) finish_frame();
+    }
+
+    // Update the keys. Pressing up and down together toggles the
+    // diagnostics page instead of taring.
+    if (key_set.update()) button_queue.push(ButtonEvent::SET);
+    if (key_feed.update()) button_queue.push(ButtonEvent::FEED);
+    bool up = key_up.update();
+    bool down = key_down.update();
+    if (!chord_latched && key_up.held() && key_down.held()) {
+        chord_latched = true;
+        show_diagnostics(!diagnostics_shown);
+    }
+    if (chord_latched) {
+        if (!key_up.held() && !key_down.held()) chord_latched = false;
+        up = false;
+        down = false;
+    }
+    if (up) button_queue.push(ButtonEvent::UP);
+    if (down) button_queue.push(ButtonEvent::DOWN);
+    if (key_lock.update()) button_queue.push(ButtonEvent::LOCK);
+    if (key_mic.update()) button_queue.push(ButtonEvent::MIC);
+
+}
+
+void UserInterface::request_benchmark() {
+    benchmark_requested = true;
+}
 
+bool UserInterface::get_benchmark_result(BenchmarkResult &result) {
+    return benchmark_mailbox.fetch(result, benchmark_sequence);
 }
@@ -0,0 +1,150 @@
+#include <hardware/address_mapped.h>
+#include <hardware/irq.h>
+#include <hardware/timer.h>
+#include <hardware/watchdog.h>
+#include <hardware/structs/sio.h>
+#include "pins.h"
+#include "watchdog.h"
+
+Watchdog watchdog;
+
+/**
+ * Called by the interrupt shim with the stacked registers of the
+ * interrupted code.
+ */
+extern "C" void __not_in_flash_func(watchdog_check)(const uint32_t *frame) {
+    watchdog.check(frame);
+}
+
+/**
+ * Alarm interrupt handler. Passes the exception frame, on the main or
+ * process stack depending on bit 2 of EXC_RETURN, to watchdog_check(),
+ * which returns from the exception.
+ */
+extern "C" __attribute__((naked)) void __not_in_flash_func(watchdog_irq)() {
+    asm volatile(
+        "movs r0, #4\n"
+        "mov r1, lr\n"
+        "tst r0, r1\n"
+        "bne 1f\n"
+        "mrs r0, msp\n"
+        "b 2f\n"
+        "1: mrs r0, psp\n"
+        "2: ldr r1, 3f\n"
+        "bx r1\n"
+        ".align 2\n"
+        "3: .word watchdog_check\n"
+    );
+}
+
+void Watchdog::begin() {
+    const uint32_t header = watchdog_hw->scratch[0];
+    if ((header & 0xFF000000) == MAGIC) {
+        reset_record.cause = ResetRecord::Cause::HANG;
+        reset_record.subsystem = static_cast<Subsystem>((header >> 16) & 0xFF);
+        reset_record.core = (header >> 8) & 0xFF;
+        reset_record.state = header & 0xFF;
+        reset_record.pc = watchdog_hw->scratch[1];
+        reset_record.lr = watchdog_hw->scratch[2];
+        reset_record.overdue_millis = watchdog_hw->scratch[3];
+    } else if (watchdog_enable_caused_reboot()) {
+        reset_record.cause = ResetRecord::Cause::WATCHDOG;
+    } else {
+        reset_record.cause = ResetRecord::Cause::POWER_ON;
+    }
+    for (unsigned i = 0; i < 4; i++) {
+        watchdog_hw->scratch[i] = 0;
+    }
+
+    watchdog_enable(HARDWARE_TIMEOUT_MILLIS, true);
+    enter(Subsystem::LOOP);
+    start_checks();
+}
+
+void Watchdog::begin_core() {
+    enter(Subsystem::RENDER);
+    start_checks();
+}
+
+void Watchdog::start_checks() {
+    const unsigned core = get_core_num();
+    const int alarm = hardware_alarm_claim_unused(true);
+    alarms[core] = alarm;
+
+    // The handler and enable bit are per core, so this must run on the
+    // core being supervised.
+    const unsigned irq = TIMER_IRQ_0 + alarm;
+    irq_set_exclusive_handler(irq, watchdog_irq);
+    irq_set_priority(irq, PICO_HIGHEST_IRQ_PRIORITY);
+    hw_set_bits(&timer_hw->inte, 1u << alarm);
+    irq_set_enabled(irq, true);
+    timer_hw->alarm[alarm] = timer_hw->timerawl + CHECK_MICROS;
+}
+
+void __not_in_flash_func(Watchdog::check)(const uint32_t *frame) {
+    const unsigned core = get_core_num();
+    const int alarm = alarms[core];
+    timer_hw->intr = 1u << alarm;
+    timer_hw->alarm[alarm] = timer_hw->timerawl + CHECK_MICROS;
+    if (tripped) return;
+
+    const uint32_t now = millis();
+    Deadlines::Expiry expiry = {};
+    if (deadlines.expired(core, now, 0, expiry)) {
+        // Stacked registers: r0-r3, r12, lr, pc, xpsr.
+        trip(core, expiry, frame[6], frame[5]);
+    }
+    if (core == 0) {
+        if (feeding && deadlines.running_longer(0, now, FEED_BUDGET_MILLIS)) {
+            sio_hw->gpio_clr = 1u << PIN_MOTOR;
+        }
+        if (deadlines.expired(1, now, CROSS_CORE_GRACE_MILLIS, expiry)) {
+            trip(1, expiry, 0, 0);
+        }
+        watchdog_update();
+    }
+}
+
+void __not_in_flash_func(Watchdog::trip)(const unsigned core, const Deadlines::Expiry &expiry, const uint32_t pc, const uint32_t lr) {
+    tripped = true;
+    sio_hw->gpio_clr = 1u << PIN_MOTOR;
+
+    watchdog_hw->scratch[0] = MAGIC | (static_cast<uint32_t>(expiry.subsystem) << 16) | (core << 8) | state;
+    watchdog_hw->scratch[1] = pc;
+    watchdog_hw->scratch[2] = lr;
+    watchdog_hw->scratch[3] = expiry.overdue_millis;
+    watchdog_reboot(0, 0, 1);
+    while (true) {
+        sio_hw->gpio_clr = 1u << PIN_MOTOR;
+    }
+}
+
+[[nodiscard]] const Watchdog::ResetRecord &Watchdog::get_reset_record() const {
+    return reset_record;
+}
+
+void Watchdog::describe_reset(Formatter &f) const {
+    static constexpr const char *SUBSYSTEM_NAMES[] = {
+        "loop", "ui", "fsm", "mqtt", "discovery", "history_query",
+        "metrics", "telemetry", "console", "wifi", "render",
+    };
+    static_assert(sizeof(SUBSYSTEM_NAMES) / sizeof(SUBSYSTEM_NAMES[0]) == static_cast<size_t>(Subsystem::COUNT), "subsystem names");
+
+    switch (reset_record.cause) {
+        case ResetRecord::Cause::POWER_ON:
+            f.text("power on");
+            break;
+        case ResetRecord::Cause::WATCHDOG:
+            f.text("watchdog timeout");
+            break;
+        case ResetRecord::Cause::HANG: {
+            const auto subsystem = static_cast<size_t>(reset_record.subsystem);
+            f.text("hang in ").text(subsystem < static_cast<size_t>(Subsystem::COUNT) ? SUBSYSTEM_NAMES[subsystem] : "?")
+                .text(" on core ").natural(reset_record.core)
+                .text(", state ").natural(reset_record.state)
+                .text(", ").natural(reset_record.overdue_millis).text("ms over, pc ").hex(reset_record.pc)
+                .text(" lr ").hex(reset_record.lr);
+            break;
+        }
+    }
+}
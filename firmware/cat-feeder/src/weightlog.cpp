@@ -0,0 +1,344 @@
+#include "weightlog.h"
+
+#include <time.h>
+
+namespace {
+
+/**
+ * Maps a signed value to an unsigned one so small magnitudes of either sign
+ * encode to short varints.
+ */
+uint32_t zigzag_encode(const int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+/**
+ * Inverse of zigzag_encode.
+ */
+int32_t zigzag_decode(const uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+/**
+ * Writes an unsigned varint and returns the number of bytes.
+ */
+size_t put_varint(uint8_t *buf, uint64_t value) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        buf[size++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    buf[size++] = static_cast<uint8_t>(value);
+    return size;
+}
+
+void put_u32(uint8_t *buf, const uint32_t value) {
+    buf[0] = value;
+    buf[1] = value >> 8;
+    buf[2] = value >> 16;
+    buf[3] = value >> 24;
+}
+
+uint32_t get_u32(const uint8_t *buf) {
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | (static_cast<uint32_t>(buf[3]) << 24);
+}
+
+} // namespace
+
+[[nodiscard]] uint32_t WeightLog::crc32(uint32_t crc, const uint8_t *data, size_t size) {
+    static constexpr uint32_t TABLE[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    while (size--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ TABLE[crc & 15];
+        crc = (crc >> 4) ^ TABLE[crc & 15];
+    }
+    return ~crc;
+}
+
+size_t WeightLog::encode(uint8_t *buf, const uint32_t time, const Type type, const int32_t value, const bool update) {
+    const auto index = static_cast<size_t>(type);
+    const auto delta = static_cast<int32_t>(time - prev_time);
+    const int32_t delta_of_delta = delta - prev_delta;
+    size_t size = put_varint(buf, (static_cast<uint64_t>(zigzag_encode(delta_of_delta)) << 2) | index);
+    size += put_varint(buf + size, zigzag_encode(value - prev_value[index]));
+    if (update) {
+        prev_time = time;
+        prev_delta = delta;
+        prev_value[index] = value;
+    }
+    return size;
+}
+
+void WeightLog::reset_block(const uint32_t time) {
+    memset(block, 0, sizeof(block));
+    length = 0;
+    count = 0;
+    base_time = time;
+    prev_time = time;
+    prev_delta = 0;
+    memset(prev_value, 0, sizeof(prev_value));
+}
+
+void WeightLog::seal_block() {
+    put_u32(block, base_time);
+    block[4] = length;
+    block[5] = length >> 8;
+    block[6] = count;
+    block[7] = FORMAT;
+    put_u32(block + BLOCK_SIZE - CRC_SIZE, crc32(0, block, BLOCK_SIZE - CRC_SIZE));
+}
+
+void WeightLog::flush_block() {
+    seal_block();
+
+    // Appending a whole block and closing the file commits it atomically in
+    // LittleFS; a power loss before that leaves the tail file in place.
+    File file = LittleFS.open(FILE_NAME, "a");
+    if (file) {
+        file.write(block, BLOCK_SIZE);
+        file_blocks = file.size() / BLOCK_SIZE;
+        file.close();
+    }
+
+    // Drop the tail before rotating, so that whenever the tail is still
+    // there, the block it duplicates is the last one of the current file.
+    LittleFS.remove(FILE_NAME_TAIL);
+    tail_dirty = false;
+    if (file_blocks >= MAX_FILE_BLOCKS) {
+        LittleFS.remove(FILE_NAME_OLD);
+        LittleFS.rename(FILE_NAME, FILE_NAME_OLD);
+        file_blocks = 0;
+        rotations++;
+    }
+    reset_block(0);
+}
+
+bool WeightLog::ends_with(const char *name, const uint8_t *tail) {
+    File file = LittleFS.open(name, "r");
+    if (!file) return false;
+    const size_t size = file.size();
+    if (size < BLOCK_SIZE || !file.seek(size - BLOCK_SIZE)) {
+        file.close();
+        return false;
+    }
+
+    // The flushed block has the same base time and starts with the same
+    // encoded records, possibly followed by more.
+    uint8_t header[HEADER_SIZE];
+    const uint16_t tail_length = tail[4] | (tail[5] << 8);
+    bool match = file.read(header, HEADER_SIZE) == HEADER_SIZE && header[7] == FORMAT
+        && get_u32(header) == get_u32(tail) && header[6] >= tail[6]
+        && (header[4] | (header[5] << 8)) >= tail_length;
+    uint8_t buf[16];
+    for (size_t i = 0; match && i < tail_length; i += sizeof(buf)) {
+        const size_t n = std::min(sizeof(buf), static_cast<size_t>(tail_length - i));
+        match = file.read(buf, n) == n && !memcmp(buf, tail + HEADER_SIZE + i, n);
+    }
+    file.close();
+    return match;
+}
+
+void WeightLog::begin() {
+    File current = LittleFS.open(FILE_NAME, "r");
+    if (current) {
+        file_blocks = current.size() / BLOCK_SIZE;
+        current.close();
+    }
+
+    File tail = LittleFS.open(FILE_NAME_TAIL, "r");
+    if (!tail) return;
+    uint8_t buf[BLOCK_SIZE];
+    const bool ok = tail.read(buf, BLOCK_SIZE) == BLOCK_SIZE && buf[7] == FORMAT
+        && get_u32(buf + BLOCK_SIZE - CRC_SIZE) == crc32(0, buf, BLOCK_SIZE - CRC_SIZE);
+    tail.close();
+    if (!ok) return;
+
+    // If the tail was already appended to the log before a power loss
+    // interrupted the flush, don't restore it a second time. The block is
+    // normally the last one of the current file; check the previous file
+    // too in case the current one was just rotated away.
+    if (ends_with(FILE_NAME, buf) || (!file_blocks && ends_with(FILE_NAME_OLD, buf))) {
+        LittleFS.remove(FILE_NAME_TAIL);
+        return;
+    }
+
+    // Replay the tail records through the encoder to restore its state.
+    memcpy(block, buf, BLOCK_SIZE);
+    base_time = get_u32(block);
+    length = block[4] | (block[5] << 8);
+    count = block[6];
+    Reader reader(*this);
+    reader.source = 2;
+    prev_time = base_time;
+    prev_delta = 0;
+    memset(prev_value, 0, sizeof(prev_value));
+    Record record = {};
+    for (uint8_t i = 0; i < count && reader.next(record); i++) {
+        prev_delta = static_cast<int32_t>(record.time - prev_time);
+        prev_time = record.time;
+        prev_value[static_cast<size_t>(record.type)] = record.value;
+    }
+}
+
+void WeightLog::append(const Type type, const float grams) {
+    append(type, grams, static_cast<uint32_t>(time(nullptr)));
+}
+
+void WeightLog::append(const Type type, const float grams, const uint32_t now) {
+    if (now < MIN_VALID_TIME) {
+        dropped++;
+        return;
+    }
+    const auto value = static_cast<int32_t>(lroundf(grams * 10.0f));
+    if (!count) reset_block(now);
+    uint8_t buf[10];
+    if (length + encode(buf, now, type, value, false) > PAYLOAD_SIZE || count == UINT8_MAX) {
+        flush_block();
+        reset_block(now);
+    }
+    length += encode(block + HEADER_SIZE + length, now, type, value, true);
+    count++;
+    tail_dirty = true;
+}
+
+[[nodiscard]] bool WeightLog::is_save_due() const {
+    return tail_dirty && millis() - tail_millis > TAIL_SAVE_MILLIS;
+}
+
+bool WeightLog::save_tail() {
+    tail_millis = millis();
+    tail_dirty = false;
+    seal_block();
+    File file = LittleFS.open(FILE_NAME_TEMP, "w");
+    if (!file) return false;
+    const bool ok = file.write(block, BLOCK_SIZE) == BLOCK_SIZE;
+    file.close();
+    if (!ok) return false;
+
+    // Replaces the previous tail atomically.
+    return LittleFS.rename(FILE_NAME_TEMP, FILE_NAME_TAIL);
+}
+
+[[nodiscard]] uint32_t WeightLog::get_dropped() const {
+    return dropped;
+}
+
+WeightLog::Reader::Reader(const WeightLog &log)
+    : log(log), block_count(log.count), block_base_time(log.base_time), file_blocks(log.file_blocks), rotations(log.rotations) {
+    memcpy(block, log.block, BLOCK_SIZE);
+}
+
+int WeightLog::Reader::read_byte() {
+    if (source == 2) {
+        if (position >= BLOCK_SIZE) return -1;
+        return block[position++];
+    }
+    return file.read();
+}
+
+bool WeightLog::Reader::read_varint(uint64_t &value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 64; shift += 7) {
+        const int c = read_byte();
+        if (c < 0) return false;
+        value |= static_cast<uint64_t>(c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+bool WeightLog::Reader::start_block() {
+    while (source < 3) {
+        if (source == 2) {
+            // Block in RAM, only once, and only if it holds anything.
+            if (position || !block_count) {
+                source++;
+                continue;
+            }
+            position = HEADER_SIZE;
+            remaining = block_count;
+            prev_time = block_base_time;
+        } else {
+            if (!file) {
+                file = LittleFS.open(source ? FILE_NAME : FILE_NAME_OLD, "r");
+                block_offset = 0;
+                if (!file) {
+                    source++;
+                    continue;
+                }
+            }
+            const bool flushed_later = source == 1 && block_offset >= file_blocks * BLOCK_SIZE;
+            if (flushed_later || block_offset + BLOCK_SIZE > file.size()) {
+                file.close();
+                file = File();
+                source++;
+                continue;
+            }
+
+            // First pass: check the CRC, streaming through a small buffer.
+            file.seek(block_offset);
+            uint8_t buf[16];
+            uint32_t crc = 0;
+            for (size_t i = 0; i < BLOCK_SIZE - CRC_SIZE; i += sizeof(buf)) {
+                const size_t n = std::min(sizeof(buf), BLOCK_SIZE - CRC_SIZE - i);
+                file.read(buf, n);
+                if (i == 0) {
+                    prev_time = get_u32(buf);
+                    remaining = buf[7] == FORMAT ? buf[6] : 0;
+                }
+                crc = crc32(crc, buf, n);
+            }
+            file.read(buf, CRC_SIZE);
+            const uint32_t offset = block_offset;
+            block_offset += BLOCK_SIZE;
+            if (crc != get_u32(buf)) {
+                corrupt++;
+                continue;
+            }
+
+            // Second pass: decode from the start of the payload.
+            file.seek(offset + HEADER_SIZE);
+        }
+        prev_delta = 0;
+        memset(prev_value, 0, sizeof(prev_value));
+        if (remaining) return true;
+    }
+    return false;
+}
+
+bool WeightLog::Reader::next(Record &record) {
+    if (log.rotations != rotations && source < 3) {
+        // The files this reader refers to were renamed or removed.
+        aborted = true;
+        remaining = 0;
+        source = 3;
+        file.close();
+        file = File();
+    }
+    if (!remaining && !start_block()) return false;
+    uint64_t key = 0;
+    uint64_t delta = 0;
+    if (!read_varint(key) || !read_varint(delta)) {
+        remaining = 0;
+        return false;
+    }
+    remaining--;
+    const auto index = static_cast<size_t>(key & 3);
+    prev_delta += zigzag_decode(static_cast<uint32_t>(key >> 2));
+    prev_time += prev_delta;
+    prev_value[index] += zigzag_decode(static_cast<uint32_t>(delta));
+    record = {prev_time, static_cast<Type>(index), prev_value[index]};
+    return true;
+}
+
+[[nodiscard]] uint32_t WeightLog::Reader::get_corrupt() const {
+    return corrupt;
+}
+
+[[nodiscard]] bool WeightLog::Reader::is_aborted() const {
+    return aborted;
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+/**
+ * Host stand-in for the parts of the Adafruit GFX library used by the
+ * modules under test. The primitives follow the library's own
+ * implementations, down to the triangle scan conversion and the classic
+ * font, so images rendered here match the display.
+ */
+
+#include <Arduino.h>
+#include <vector>
+
+#include "glcdfont.h"
+
+class Adafruit_GFX : public Print {
+protected:
+    const int16_t WIDTH;
+    const int16_t HEIGHT;
+    int16_t _width;
+    int16_t _height;
+    uint8_t rotation = 0;
+    int16_t cursor_x = 0;
+    int16_t cursor_y = 0;
+    uint16_t textcolor = 0xFFFF;
+    uint16_t textbgcolor = 0xFFFF;
+    uint8_t textsize_x = 1;
+    uint8_t textsize_y = 1;
+    bool wrap = true;
+
+public:
+    Adafruit_GFX(const int16_t w, const int16_t h) : WIDTH(w), HEIGHT(h), _width(w), _height(h) {
+    }
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    virtual void startWrite() {
+    }
+
+    virtual void writePixel(const int16_t x, const int16_t y, const uint16_t color) {
+        drawPixel(x, y, color);
+    }
+
+    virtual void writeFillRect(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const uint16_t color) {
+        fillRect(x, y, w, h, color);
+    }
+
+    virtual void writeFastVLine(const int16_t x, const int16_t y, const int16_t h, const uint16_t color) {
+        drawFastVLine(x, y, h, color);
+    }
+
+    virtual void writeFastHLine(const int16_t x, const int16_t y, const int16_t w, const uint16_t color) {
+        drawFastHLine(x, y, w, color);
+    }
+
+    virtual void endWrite() {
+    }
+
+    virtual void drawFastVLine(const int16_t x, const int16_t y, const int16_t h, const uint16_t color) {
+        startWrite();
+        for (int16_t i = 0; i < h; i++) writePixel(x, static_cast<int16_t>(y + i), color);
+        endWrite();
+    }
+
+    virtual void drawFastHLine(const int16_t x, const int16_t y, const int16_t w, const uint16_t color) {
+        startWrite();
+        for (int16_t i = 0; i < w; i++) writePixel(static_cast<int16_t>(x + i), y, color);
+        endWrite();
+    }
+
+    virtual void fillRect(const int16_t x, const int16_t y, const int16_t w, const int16_t h, const uint16_t color) {
+        startWrite();
+        for (int16_t i = x; i < x + w; i++) writeFastVLine(i, y, h, color);
+        endWrite();
+    }
+
+    virtual void fillScreen(const uint16_t color) {
+        fillRect(0, 0, _width, _height, color);
+    }
+
+    void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, const uint16_t color) {
+        // Sort coordinates by y order (y2 >= y1 >= y0).
+        if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+        if (y1 > y2) { std::swap(y2, y1); std::swap(x2, x1); }
+        if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+
+        startWrite();
+        if (y0 == y2) {
+            // All on the same line.
+            int16_t a = x0;
+            int16_t b = x0;
+            if (x1 < a) a = x1; else if (x1 > b) b = x1;
+            if (x2 < a) a = x2; else if (x2 > b) b = x2;
+            writeFastHLine(a, y0, static_cast<int16_t>(b - a + 1), color);
+            endWrite();
+            return;
+        }
+
+        const int16_t dx01 = x1 - x0, dy01 = y1 - y0, dx02 = x2 - x0, dy02 = y2 - y0, dx12 = x2 - x1, dy12 = y2 - y1;
+        int32_t sa = 0;
+        int32_t sb = 0;
+
+        // Upper part, including scanline y1 unless the lower part is flat.
+        const int16_t last = y1 == y2 ? y1 : static_cast<int16_t>(y1 - 1);
+        int16_t y = y0;
+        for (; y <= last; y++) {
+            int16_t a = static_cast<int16_t>(x0 + sa / dy01);
+            int16_t b = static_cast<int16_t>(x0 + sb / dy02);
+            sa += dx01;
+            sb += dx02;
+            if (a > b) std::swap(a, b);
+            writeFastHLine(a, y, static_cast<int16_t>(b - a + 1), color);
+        }
+
+        // Lower part.
+        sa = static_cast<int32_t>(dx12) * (y - y1);
+        sb = static_cast<int32_t>(dx02) * (y - y0);
+        for (; y <= y2; y++) {
+            int16_t a = static_cast<int16_t>(x1 + sa / dy12);
+            int16_t b = static_cast<int16_t>(x0 + sb / dy02);
+            sa += dx12;
+            sb += dx02;
+            if (a > b) std::swap(a, b);
+            writeFastHLine(a, y, static_cast<int16_t>(b - a + 1), color);
+        }
+        endWrite();
+    }
+
+    /**
+     * Draws a character of the classic font. Characters outside printable
+     * ASCII draw as blanks.
+     */
+    void drawChar(const int16_t x, const int16_t y, const unsigned char c, const uint16_t color, const uint16_t bg, const uint8_t size_x, const uint8_t size_y) {
+        if (x >= _width || y >= _height || x + 6 * size_x - 1 < 0 || y + 8 * size_y - 1 < 0) return;
+        static constexpr uint8_t BLANK[5] = {};
+        const uint8_t *glyph = c >= GLCDFONT_FIRST && c <= GLCDFONT_LAST ? glcdfont[c - GLCDFONT_FIRST] : BLANK;
+
+        startWrite();
+        for (int16_t i = 0; i < 5; i++) {
+            uint8_t line = glyph[i];
+            for (int16_t j = 0; j < 8; j++, line >>= 1) {
+                if (line & 1) {
+                    if (size_x == 1 && size_y == 1) writePixel(static_cast<int16_t>(x + i), static_cast<int16_t>(y + j), color);
+                    else writeFillRect(static_cast<int16_t>(x + i * size_x), static_cast<int16_t>(y + j * size_y), size_x, size_y, color);
+                } else if (bg != color) {
+                    if (size_x == 1 && size_y == 1) writePixel(static_cast<int16_t>(x + i), static_cast<int16_t>(y + j), bg);
+                    else writeFillRect(static_cast<int16_t>(x + i * size_x), static_cast<int16_t>(y + j * size_y), size_x, size_y, bg);
+                }
+            }
+        }
+
+        // Opaque text also fills the spacing column.
+        if (bg != color) {
+            if (size_x == 1 && size_y == 1) writeFastVLine(static_cast<int16_t>(x + 5), y, 8, bg);
+            else writeFillRect(static_cast<int16_t>(x + 5 * size_x), y, size_x, static_cast<int16_t>(8 * size_y), bg);
+        }
+        endWrite();
+    }
+
+    virtual void setRotation(const uint8_t r) {
+        rotation = r & 3;
+        const bool swap = rotation & 1;
+        _width = swap ? HEIGHT : WIDTH;
+        _height = swap ? WIDTH : HEIGHT;
+    }
+
+    [[nodiscard]] uint8_t getRotation() const {
+        return rotation;
+    }
+
+    void setCursor(const int16_t x, const int16_t y) {
+        cursor_x = x;
+        cursor_y = y;
+    }
+
+    void setTextColor(const uint16_t c) {
+        textcolor = textbgcolor = c;
+    }
+
+    void setTextColor(const uint16_t c, const uint16_t bg) {
+        textcolor = c;
+        textbgcolor = bg;
+    }
+
+    void setTextSize(const uint8_t s) {
+        textsize_x = textsize_y = s > 0 ? s : 1;
+    }
+
+    void setTextWrap(const bool w) {
+        wrap = w;
+    }
+
+    [[nodiscard]] int16_t width() const {
+        return _width;
+    }
+
+    [[nodiscard]] int16_t height() const {
+        return _height;
+    }
+
+    size_t write(const uint8_t c) override {
+        if (c == '\n') {
+            cursor_x = 0;
+            cursor_y = static_cast<int16_t>(cursor_y + textsize_y * 8);
+        } else if (c != '\r') {
+            if (wrap && cursor_x + textsize_x * 6 > _width) {
+                cursor_x = 0;
+                cursor_y = static_cast<int16_t>(cursor_y + textsize_y * 8);
+            }
+            drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize_x, textsize_y);
+            cursor_x = static_cast<int16_t>(cursor_x + textsize_x * 6);
+        }
+        return 1;
+    }
+
+    using Print::write;
+};
+
+/**
+ * In-memory RGB565 image.
+ */
+class GFXcanvas16 : public Adafruit_GFX {
+private:
+    std::vector<uint16_t> buffer;
+
+public:
+    GFXcanvas16(const uint16_t w, const uint16_t h) : Adafruit_GFX(static_cast<int16_t>(w), static_cast<int16_t>(h)), buffer(static_cast<size_t>(w) * h) {
+    }
+
+    void drawPixel(const int16_t x, const int16_t y, const uint16_t color) override {
+        if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+        buffer[static_cast<size_t>(y) * _width + x] = color;
+    }
+
+    [[nodiscard]] uint16_t getPixel(const int16_t x, const int16_t y) const {
+        if (x < 0 || y < 0 || x >= _width || y >= _height) return 0;
+        return buffer[static_cast<size_t>(y) * _width + x];
+    }
+
+    [[nodiscard]] uint16_t *getBuffer() {
+        return buffer.data();
+    }
+};
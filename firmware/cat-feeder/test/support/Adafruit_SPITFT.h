@@ -0,0 +1,82 @@
+#pragma once
+
+/**
+ * Host stand-in for an Adafruit SPI display. The display memory is kept in
+ * a canvas, and writePixels() fills the current address window the way the
+ * controller does.
+ */
+
+#include <Adafruit_GFX.h>
+
+class Adafruit_SPITFT : public Adafruit_GFX {
+private:
+    int16_t window_x = 0;
+    int16_t window_y = 0;
+    int16_t window_w = 0;
+    int16_t window_h = 0;
+    uint32_t window_pos = 0;
+    int write_depth = 0;
+
+public:
+    /**
+     * Display memory.
+     */
+    GFXcanvas16 memory;
+
+    /**
+     * Number of outermost startWrite/endWrite pairs.
+     */
+    uint32_t transactions = 0;
+
+    /**
+     * Number of address windows set.
+     */
+    uint32_t windows = 0;
+
+    /**
+     * Last SPI clock frequency set.
+     */
+    uint32_t spi_speed = 0;
+
+    Adafruit_SPITFT(const uint16_t w, const uint16_t h) : Adafruit_GFX(static_cast<int16_t>(w), static_cast<int16_t>(h)), memory(w, h) {
+    }
+
+    void drawPixel(const int16_t x, const int16_t y, const uint16_t color) override {
+        startWrite();
+        memory.drawPixel(x, y, color);
+        endWrite();
+    }
+
+    void startWrite() override {
+        if (!write_depth++) transactions++;
+    }
+
+    void endWrite() override {
+        if (write_depth) write_depth--;
+    }
+
+    void writePixel(const int16_t x, const int16_t y, const uint16_t color) override {
+        memory.drawPixel(x, y, color);
+    }
+
+    virtual void setAddrWindow(const uint16_t x, const uint16_t y, const uint16_t w, const uint16_t h) {
+        window_x = static_cast<int16_t>(x);
+        window_y = static_cast<int16_t>(y);
+        window_w = static_cast<int16_t>(w);
+        window_h = static_cast<int16_t>(h);
+        window_pos = 0;
+        windows++;
+    }
+
+    void setSPISpeed(const uint32_t frequency) {
+        spi_speed = frequency;
+    }
+
+    void writePixels(uint16_t *colors, const uint32_t len, bool = true, bool = false) {
+        for (uint32_t i = 0; i < len && window_w; i++, window_pos++) {
+            const auto x = static_cast<int16_t>(window_x + window_pos % window_w);
+            const auto y = static_cast<int16_t>(window_y + window_pos / window_w % window_h);
+            memory.drawPixel(x, y, colors[i]);
+        }
+    }
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+/**
+ * Host stand-in for the parts of the Arduino core used by the modules under
+ * test. The clock only moves when a test advances it.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define HIGH 1
+#define LOW 0
+
+#define __not_in_flash_func(name) name
+
+/**
+ * Current time of the host clock in microseconds.
+ */
+inline uint64_t host_micros = 0;
+
+/**
+ * Advances the host clock.
+ */
+inline void host_advance(const uint32_t millis) {
+    host_micros += static_cast<uint64_t>(millis) * 1000;
+}
+
+inline unsigned long millis() {
+    return static_cast<unsigned long>(host_micros / 1000);
+}
+
+inline unsigned long micros() {
+    return static_cast<unsigned long>(host_micros);
+}
+
+inline uint32_t time_us_32() {
+    return static_cast<uint32_t>(host_micros);
+}
+
+inline unsigned get_core_num() {
+    return 0;
+}
+
+/**
+ * Output sink with the printing functions of the Arduino Print class.
+ */
+class Print {
+public:
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        for (size_t i = 0; i < size; i++) write(buffer[i]);
+        return size;
+    }
+
+    size_t print(const char *s) {
+        return write(reinterpret_cast<const uint8_t *>(s), strlen(s));
+    }
+
+    size_t print(const long value) {
+        return printf("%ld", value);
+    }
+
+    size_t println(const char *s = "") {
+        return print(s) + print("\r\n");
+    }
+
+    size_t printf(const char *format, ...) {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        const int length = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return length > 0 ? print(buffer) : 0;
+    }
+};
+
+/**
+ * Print that collects its output in a string.
+ */
+class StringPrint : public Print {
+public:
+    std::string output;
+
+    size_t write(const uint8_t c) override {
+        output += static_cast<char>(c);
+        return 1;
+    }
+
+    using Print::write;
+};
+
+/**
+ * IPv4 address.
+ */
+class IPAddress {
+public:
+    IPAddress() = default;
+
+    IPAddress(const uint8_t a, const uint8_t b, const uint8_t c, const uint8_t d) : octets{a, b, c, d} {
+    }
+
+    uint8_t operator[](const int i) const {
+        return octets[i];
+    }
+
+private:
+    uint8_t octets[4] = {};
+};
+
+/**
+ * Print with input, as in the Arduino core.
+ */
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+/**
+ * Network connection interface of the Arduino core.
+ */
+class Client : public Stream {
+public:
+    virtual int connect(IPAddress ip, uint16_t port) = 0;
+    virtual int connect(const char *host, uint16_t port) = 0;
+    size_t write(uint8_t b) override = 0;
+    size_t write(const uint8_t *buf, size_t size) override = 0;
+    int available() override = 0;
+    int read() override = 0;
+    virtual int read(uint8_t *buf, size_t size) = 0;
+    int peek() override = 0;
+    virtual void flush() = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+    virtual operator bool() = 0;
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+/**
+ * Host stand-in for the MQTT client of the home-assistant-integration
+ * library, acting as a broker that records everything published, and for
+ * its device types, reduced to a button whose discovery config is a plain
+ * string.
+ */
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "Arduino.h"
+
+class HABaseDeviceType;
+
+class HAMqtt {
+public:
+    /**
+     * Connection states, with the library's values.
+     */
+    enum ConnectionState {
+        StateConnecting = -5,
+        StateConnectionTimeout = -4,
+        StateConnectionLost = -3,
+        StateConnectionFailed = -2,
+        StateDisconnected = -1,
+        StateConnected = 0,
+        StateBadProtocol = 1,
+        StateBadClientId = 2,
+        StateUnavailable = 3,
+        StateBadCredentials = 4,
+        StateUnauthorized = 5,
+    };
+
+    /**
+     * A published message.
+     */
+    struct Message {
+        std::string topic;
+        std::string payload;
+    };
+
+    /**
+     * Whether the client is connected.
+     */
+    bool connected = true;
+
+    /**
+     * Subscribed topics.
+     */
+    std::vector<std::string> subscriptions;
+
+    /**
+     * Completed publishes, oldest first.
+     */
+    std::vector<Message> messages;
+
+    /**
+     * Number of publishes whose payload length didn't match the announced
+     * one.
+     */
+    size_t length_mismatches = 0;
+
+    HAMqtt() {
+        current = this;
+    }
+
+    /**
+     * Also writes every publish through the given client, as the library
+     * does.
+     */
+    explicit HAMqtt(Client &client) : client(&client) {
+        current = this;
+    }
+
+    static HAMqtt *instance() {
+        return current;
+    }
+
+    /**
+     * Connects and lets every device type announce itself, as the library
+     * does on (re)connect.
+     */
+    void connect();
+
+    bool isConnected() const {
+        return connected;
+    }
+
+    ConnectionState getState() const {
+        return connected ? StateConnected : StateDisconnected;
+    }
+
+    bool subscribe(const char *topic) {
+        subscriptions.emplace_back(topic);
+        return true;
+    }
+
+    bool beginPublish(const char *topic, const uint16_t length, const bool retained = false) {
+        (void)retained;
+        if (!connected) return false;
+        pending = {topic, {}};
+        announced = length;
+        if (client) client->write(reinterpret_cast<const uint8_t *>(topic), strlen(topic));
+        return true;
+    }
+
+    void writePayload(const char *data, const uint16_t length) {
+        pending.payload.append(data, length);
+        if (client) client->write(reinterpret_cast<const uint8_t *>(data), length);
+    }
+
+    void writePayload(const uint8_t *data, const uint16_t length) {
+        writePayload(reinterpret_cast<const char *>(data), length);
+    }
+
+    bool endPublish() {
+        if (pending.payload.size() != announced) length_mismatches++;
+        messages.push_back(pending);
+        return true;
+    }
+
+private:
+    Message pending;
+    size_t announced = 0;
+    Client *client = nullptr;
+    static inline HAMqtt *current = nullptr;
+};
+
+/**
+ * Serialized discovery config.
+ */
+class HASerializer {
+public:
+    explicit HASerializer(std::string config) : config(std::move(config)) {
+    }
+
+    uint16_t calculateSize() const {
+        return static_cast<uint16_t>(config.size());
+    }
+
+    /**
+     * Writes the config to the MQTT client, whether or not a publish is in
+     * progress.
+     */
+    bool flush() const {
+        HAMqtt::instance()->writePayload(config.data(), calculateSize());
+        return true;
+    }
+
+private:
+    std::string config;
+};
+
+class HABaseDeviceType {
+public:
+    enum NumberPrecision {
+        PrecisionP0,
+        PrecisionP1,
+        PrecisionP2,
+        PrecisionP3,
+    };
+
+    HABaseDeviceType(const char *component, const char *unique_id) : component(component), unique_id(unique_id) {
+        all().push_back(this);
+    }
+
+    virtual ~HABaseDeviceType() {
+        destroySerializer();
+        auto &types = all();
+        types.erase(std::remove(types.begin(), types.end(), this), types.end());
+    }
+
+    const char *uniqueId() const {
+        return unique_id;
+    }
+
+    /**
+     * Changes the name, and with it the discovery config.
+     */
+    void setName(const char *name) {
+        this->name = name;
+    }
+
+    /**
+     * Every constructed device type, as registered with the library.
+     */
+    static std::vector<HABaseDeviceType *> &all() {
+        static std::vector<HABaseDeviceType *> types;
+        return types;
+    }
+
+protected:
+    HASerializer *_serializer = nullptr;
+
+    virtual void buildSerializer() {
+        if (_serializer) return;
+        _serializer = new HASerializer(std::string("{\"name\":\"") + name + "\",\"uniq_id\":\"" + unique_id + "\",\"cmp\":\"" + component + "\"}");
+    }
+
+    void destroySerializer() {
+        delete _serializer;
+        _serializer = nullptr;
+    }
+
+    virtual void onMqttConnected() = 0;
+
+    /**
+     * Topic with the given suffix under this entity.
+     */
+    std::string topic(const char *suffix) const {
+        return std::string("homeassistant/") + component + "/feeder/" + unique_id + "/" + suffix;
+    }
+
+    void publishConfig() {
+        buildSerializer();
+        if (_serializer == nullptr) return;
+        HAMqtt &mqtt = *HAMqtt::instance();
+        mqtt.beginPublish(topic("config").c_str(), _serializer->calculateSize(), true);
+        _serializer->flush();
+        mqtt.endPublish();
+        destroySerializer();
+    }
+
+    void publishAvailability() {
+        HAMqtt &mqtt = *HAMqtt::instance();
+        mqtt.beginPublish(topic("avty_t").c_str(), 6, true);
+        mqtt.writePayload("online", 6);
+        mqtt.endPublish();
+    }
+
+    friend class HAMqtt;
+
+private:
+    const char *component;
+    const char *unique_id;
+    std::string name;
+};
+
+class HAButton : public HABaseDeviceType {
+public:
+    explicit HAButton(const char *unique_id) : HABaseDeviceType("button", unique_id) {
+    }
+
+protected:
+    void onMqttConnected() override {
+        publishConfig();
+        publishAvailability();
+        HAMqtt::instance()->subscribe(topic("cmd_t").c_str());
+    }
+};
+
+inline void HAMqtt::connect() {
+    connected = true;
+    for (HABaseDeviceType *type : HABaseDeviceType::all()) type->onMqttConnected();
+}
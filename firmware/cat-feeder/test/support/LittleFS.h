@@ -0,0 +1,221 @@
+#pragma once
+
+/**
+ * In-memory stand-in for the LittleFS API used by the modules under test,
+ * with the same commit semantics: data written to a file becomes visible
+ * and durable when the file is closed, and remove and rename are atomic.
+ *
+ * A power loss can be injected with cut_power_after(n): the first n
+ * commits (closes of written files, removes and renames) still happen, and
+ * everything after that is silently lost until restore_power(), which
+ * stands for the next boot.
+ */
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+
+class HostFS;
+
+class File {
+private:
+    friend class HostFS;
+
+    /**
+     * State shared between copies of the same open file.
+     */
+    struct Handle {
+        HostFS *fs;
+        std::string path;
+        std::vector<uint8_t> data;
+        size_t position;
+        bool writable;
+        bool dirty;
+        bool open;
+    };
+
+    std::shared_ptr<Handle> handle;
+
+public:
+    File() = default;
+
+    explicit operator bool() const {
+        return handle && handle->open;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size);
+
+    size_t write(const uint8_t c) {
+        return write(&c, 1);
+    }
+
+    int read() {
+        if (!*this || handle->position >= handle->data.size()) return -1;
+        return handle->data[handle->position++];
+    }
+
+    size_t read(uint8_t *buffer, const size_t size) {
+        if (!*this) return 0;
+        const size_t n = std::min(size, handle->data.size() - std::min(handle->position, handle->data.size()));
+        memcpy(buffer, handle->data.data() + handle->position, n);
+        handle->position += n;
+        return n;
+    }
+
+    bool seek(const uint32_t position) {
+        if (!*this || position > handle->data.size()) return false;
+        handle->position = position;
+        return true;
+    }
+
+    [[nodiscard]] size_t position() const {
+        return *this ? handle->position : 0;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return *this ? handle->data.size() : 0;
+    }
+
+    void close();
+};
+
+class HostFS {
+private:
+    friend class File;
+
+    /**
+     * Committed file contents by path.
+     */
+    std::map<std::string, std::vector<uint8_t>> files;
+
+    /**
+     * Number of commits left before power is lost, negative for unlimited.
+     */
+    int commits_left = -1;
+
+public:
+    /**
+     * Number of bytes written to files so far.
+     */
+    size_t bytes_written = 0;
+
+private:
+
+    /**
+     * Returns whether the next commit happens, using up one if limited.
+     */
+    bool commit() {
+        if (commits_left < 0) return true;
+        if (!commits_left) return false;
+        commits_left--;
+        return true;
+    }
+
+public:
+    bool begin() {
+        return true;
+    }
+
+    File open(const char *path, const char *mode) {
+        const auto it = files.find(path);
+        const bool append = mode[0] == 'a';
+        const bool write = mode[0] == 'w';
+        if (!write && !append && it == files.end()) return File();
+        File file;
+        file.handle = std::make_shared<File::Handle>();
+        *file.handle = {this, path, {}, 0, write || append, write, true};
+        if (!write && it != files.end()) file.handle->data = it->second;
+        if (append) file.handle->position = file.handle->data.size();
+        return file;
+    }
+
+    bool exists(const char *path) const {
+        return files.count(path);
+    }
+
+    bool remove(const char *path) {
+        if (!files.count(path) || !commit()) return false;
+        files.erase(path);
+        return true;
+    }
+
+    bool rename(const char *from, const char *to) {
+        const auto it = files.find(from);
+        if (it == files.end() || !commit()) return false;
+        files[to] = std::move(it->second);
+        files.erase(from);
+        return true;
+    }
+
+    /**
+     * Removes all files and restores power.
+     */
+    void format() {
+        files.clear();
+        commits_left = -1;
+        bytes_written = 0;
+    }
+
+    /**
+     * Loses power after the given number of further commits.
+     */
+    void cut_power_after(const int commits) {
+        commits_left = commits;
+    }
+
+    /**
+     * Restores power; returns whether it had been lost.
+     */
+    bool restore_power() {
+        const bool lost = commits_left == 0;
+        commits_left = -1;
+        return lost;
+    }
+
+    /**
+     * Returns the committed size of a file, 0 if it doesn't exist.
+     */
+    size_t size(const char *path) const {
+        const auto it = files.find(path);
+        return it == files.end() ? 0 : it->second.size();
+    }
+
+    /**
+     * Replaces the committed contents of a file.
+     */
+    void store(const char *path, const std::vector<uint8_t> &data) {
+        files[path] = data;
+    }
+
+    /**
+     * Returns the committed contents of a file, empty if it doesn't exist.
+     */
+    std::vector<uint8_t> contents(const char *path) const {
+        const auto it = files.find(path);
+        return it == files.end() ? std::vector<uint8_t>() : it->second;
+    }
+};
+
+inline size_t File::write(const uint8_t *buffer, const size_t size) {
+    if (!*this || !handle->writable) return 0;
+    auto &data = handle->data;
+    if (handle->position + size > data.size()) data.resize(handle->position + size);
+    memcpy(data.data() + handle->position, buffer, size);
+    handle->position += size;
+    handle->dirty = true;
+    handle->fs->bytes_written += size;
+    return size;
+}
+
+inline void File::close() {
+    if (!*this) return;
+    if (handle->dirty && handle->fs->commit()) {
+        handle->fs->files[handle->path] = handle->data;
+    }
+    handle->open = false;
+    handle = nullptr;
+}
+
+inline HostFS LittleFS;
@@ -0,0 +1,16 @@
+#pragma once
+
+/**
+ * Host stand-in for the WiFi status codes of the Arduino-Pico core.
+ */
+
+enum wl_status_t {
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+};
@@ -0,0 +1,87 @@
+#include <unity.h>
+#include "deadlines.h"
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_unarmed_slot_never_expires() {
+    Deadlines deadlines;
+    Deadlines::Expiry expiry = {};
+    TEST_ASSERT_FALSE(deadlines.expired(0, 100000, 0, expiry));
+    TEST_ASSERT_FALSE(deadlines.running_longer(0, 100000, 0));
+}
+
+void test_expires_after_budget() {
+    Deadlines deadlines;
+    Deadlines::Expiry expiry = {};
+    deadlines.enter(0, 3, 1000, 500);
+    TEST_ASSERT_FALSE(deadlines.expired(0, 1500, 0, expiry));
+    TEST_ASSERT_TRUE(deadlines.expired(0, 1501, 0, expiry));
+    TEST_ASSERT_EQUAL_UINT8(3, expiry.subsystem);
+    TEST_ASSERT_EQUAL_UINT32(1, expiry.overdue_millis);
+}
+
+void test_grace() {
+    Deadlines deadlines;
+    Deadlines::Expiry expiry = {};
+    deadlines.enter(1, 10, 1000, 500);
+    TEST_ASSERT_FALSE(deadlines.expired(1, 2500, 1000, expiry));
+    TEST_ASSERT_TRUE(deadlines.expired(1, 2501, 1000, expiry));
+    TEST_ASSERT_EQUAL_UINT32(1001, expiry.overdue_millis);
+}
+
+void test_enter_moves_on() {
+    Deadlines deadlines;
+    Deadlines::Expiry expiry = {};
+    deadlines.enter(0, 1, 0, 100);
+    deadlines.enter(0, 2, 90, 100);
+    TEST_ASSERT_FALSE(deadlines.expired(0, 150, 0, expiry));
+    TEST_ASSERT_TRUE(deadlines.expired(0, 191, 0, expiry));
+    TEST_ASSERT_EQUAL_UINT8(2, expiry.subsystem);
+}
+
+void test_slots_are_independent() {
+    Deadlines deadlines;
+    Deadlines::Expiry expiry = {};
+    deadlines.enter(0, 1, 0, 100);
+    deadlines.enter(1, 2, 0, 1000);
+    TEST_ASSERT_TRUE(deadlines.expired(0, 200, 0, expiry));
+    TEST_ASSERT_FALSE(deadlines.expired(1, 200, 0, expiry));
+}
+
+void test_millis_wrap() {
+    Deadlines deadlines;
+    Deadlines::Expiry expiry = {};
+    const uint32_t now = 0xFFFFFF00;
+    deadlines.enter(0, 4, now, 0x200);
+    TEST_ASSERT_FALSE(deadlines.expired(0, now + 0x100, 0, expiry));
+    TEST_ASSERT_FALSE(deadlines.expired(0, now + 0x200, 0, expiry));
+    TEST_ASSERT_TRUE(deadlines.expired(0, now + 0x201, 0, expiry));
+    TEST_ASSERT_EQUAL_UINT32(1, expiry.overdue_millis);
+    TEST_ASSERT_FALSE(deadlines.running_longer(0, now + 0x100, 0x100));
+    TEST_ASSERT_TRUE(deadlines.running_longer(0, now + 0x101, 0x100));
+}
+
+void test_running_longer_ignores_budget() {
+    Deadlines deadlines;
+    deadlines.enter(0, 3, 5000, 20000);
+    TEST_ASSERT_FALSE(deadlines.running_longer(0, 6000, 1000));
+    TEST_ASSERT_TRUE(deadlines.running_longer(0, 6001, 1000));
+    deadlines.enter(0, 0, 6001, 1000);
+    TEST_ASSERT_FALSE(deadlines.running_longer(0, 6500, 1000));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_unarmed_slot_never_expires);
+    RUN_TEST(test_expires_after_budget);
+    RUN_TEST(test_grace);
+    RUN_TEST(test_enter_moves_on);
+    RUN_TEST(test_slots_are_independent);
+    RUN_TEST(test_millis_wrap);
+    RUN_TEST(test_running_longer_ignores_budget);
+    return UNITY_END();
+}
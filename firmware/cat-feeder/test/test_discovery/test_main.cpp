@@ -0,0 +1,258 @@
+#include <unity.h>
+#include <vector>
+#include "discovery.h"
+
+/**
+ * Time a blocking socket write takes per byte, draining at 1 Mbit/s.
+ */
+static constexpr uint32_t MICROS_PER_BYTE = 8;
+
+/**
+ * Socket to the broker. Records the bytes written and advances the host
+ * clock as a blocking write would.
+ */
+class FakeSocket : public Client {
+public:
+    size_t bytes = 0;
+
+    int connect(IPAddress, uint16_t) override {
+        return 1;
+    }
+
+    int connect(const char *, uint16_t) override {
+        return 1;
+    }
+
+    size_t write(const uint8_t b) override {
+        return write(&b, 1);
+    }
+
+    size_t write(const uint8_t *, const size_t size) override {
+        bytes += size;
+        host_micros += size * MICROS_PER_BYTE;
+        return size;
+    }
+
+    int available() override {
+        return 0;
+    }
+
+    int read() override {
+        return -1;
+    }
+
+    int read(uint8_t *, size_t) override {
+        return -1;
+    }
+
+    int peek() override {
+        return -1;
+    }
+
+    void flush() override {
+    }
+
+    void stop() override {
+    }
+
+    uint8_t connected() override {
+        return 1;
+    }
+
+    operator bool() override {
+        return true;
+    }
+};
+
+static FakeSocket socket;
+static DiscoveryClient client(socket);
+static HAMqtt mqtt(client);
+static Discovery discovery(mqtt, client);
+
+static Paced<HAButton> entities[] = {
+    Paced<HAButton>("feed"),
+    Paced<HAButton>("reset"),
+    Paced<HAButton>("enter_maintenance"),
+    Paced<HAButton>("adjust_deficit_button"),
+    Paced<HAButton>("display_benchmark"),
+};
+
+static constexpr size_t NUM_ENTITIES = sizeof(entities) / sizeof(entities[0]);
+
+/**
+ * What one poll() sent.
+ */
+struct Poll {
+    size_t bytes;
+    uint32_t micros;
+    size_t configs;
+    size_t messages;
+};
+
+/**
+ * Returns the number of config publishes among messages [from, end).
+ */
+static size_t count_configs(const size_t from) {
+    size_t configs = 0;
+    for (size_t i = from; i < mqtt.messages.size(); i++) {
+        const std::string &topic = mqtt.messages[i].topic;
+        if (topic.size() > 7 && !topic.compare(topic.size() - 7, 7, "/config")) configs++;
+    }
+    return configs;
+}
+
+/**
+ * Polls once and records what went out.
+ */
+static Poll poll(const bool busy = false) {
+    const size_t bytes = socket.bytes;
+    const size_t messages = mqtt.messages.size();
+    const uint64_t start = host_micros;
+    discovery.poll(busy);
+    return {socket.bytes - bytes, static_cast<uint32_t>(host_micros - start), count_configs(messages), mqtt.messages.size() - messages};
+}
+
+/**
+ * Connects and polls until the round of announcements is over.
+ */
+static std::vector<Poll> connect_and_run() {
+    const size_t bytes = socket.bytes;
+    mqtt.connect();
+    discovery.on_connected();
+    TEST_ASSERT_EQUAL_size_t(bytes, socket.bytes);
+
+    std::vector<Poll> polls;
+    while (discovery.is_announcing()) {
+        polls.push_back(poll());
+        TEST_ASSERT_LESS_THAN(100, polls.size());
+    }
+    return polls;
+}
+
+/**
+ * Returns the number of configs sent in a round.
+ */
+static size_t total_configs(const std::vector<Poll> &polls) {
+    size_t configs = 0;
+    for (const Poll &p : polls) configs += p.configs;
+    return configs;
+}
+
+void setUp() {
+    for (auto &entity : entities) entity.setName("Cat feeder");
+    mqtt.messages.clear();
+    mqtt.connected = true;
+    // Forget what the broker retained; this leaves a round pending, which
+    // the next connect restarts.
+    discovery.resend();
+}
+
+void tearDown() {
+}
+
+void test_one_entity_per_poll() {
+    const std::vector<Poll> polls = connect_and_run();
+
+    // One announcement per call, then one call to finish the round.
+    TEST_ASSERT_EQUAL_size_t(NUM_ENTITIES + 1, polls.size());
+    size_t max_bytes = 0;
+    uint32_t max_micros = 0;
+    size_t total_bytes = 0;
+    for (size_t i = 0; i < NUM_ENTITIES; i++) {
+        TEST_ASSERT_EQUAL_size_t(1, polls[i].configs);
+        TEST_ASSERT_EQUAL_size_t(2, polls[i].messages);
+        max_bytes = std::max(max_bytes, polls[i].bytes);
+        max_micros = std::max(max_micros, polls[i].micros);
+        total_bytes += polls[i].bytes;
+    }
+    TEST_ASSERT_EQUAL_size_t(0, polls.back().bytes);
+    TEST_ASSERT_EQUAL_UINT32(max_micros, discovery.get_max_announce_micros());
+
+    char message[160];
+    snprintf(message, sizeof(message), "%u entities: max %u bytes and %u us per poll, %u bytes and %u us as one burst",
+             static_cast<unsigned>(NUM_ENTITIES), static_cast<unsigned>(max_bytes), static_cast<unsigned>(max_micros),
+             static_cast<unsigned>(total_bytes), static_cast<unsigned>(total_bytes * MICROS_PER_BYTE));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(total_bytes / 2, max_bytes);
+}
+
+void test_nothing_sent_while_busy() {
+    mqtt.connect();
+    discovery.on_connected();
+    for (int i = 0; i < 10; i++) {
+        const Poll p = poll(true);
+        TEST_ASSERT_EQUAL_size_t(0, p.bytes);
+        TEST_ASSERT_EQUAL_size_t(0, p.messages);
+    }
+    TEST_ASSERT_TRUE(discovery.is_announcing());
+
+    // Announcing resumes once the feed is over.
+    TEST_ASSERT_EQUAL_size_t(1, poll().configs);
+    TEST_ASSERT_EQUAL_size_t(0, poll(true).bytes);
+}
+
+void test_nothing_sent_while_disconnected() {
+    mqtt.connect();
+    discovery.on_connected();
+    TEST_ASSERT_EQUAL_size_t(1, poll().configs);
+    mqtt.connected = false;
+    TEST_ASSERT_EQUAL_size_t(0, poll().bytes);
+
+    // The round was cut short, so nothing counts as retained and every
+    // config goes out again.
+    TEST_ASSERT_EQUAL_size_t(NUM_ENTITIES, total_configs(connect_and_run()));
+}
+
+void test_unchanged_configs_skipped() {
+    TEST_ASSERT_EQUAL_size_t(NUM_ENTITIES, total_configs(connect_and_run()));
+    const uint32_t skipped = discovery.get_skipped();
+    const std::vector<Poll> polls = connect_and_run();
+
+    // Availability still goes out, one entity per call.
+    TEST_ASSERT_EQUAL_size_t(NUM_ENTITIES + 1, polls.size());
+    TEST_ASSERT_EQUAL_size_t(0, total_configs(polls));
+    for (size_t i = 0; i < NUM_ENTITIES; i++) TEST_ASSERT_EQUAL_size_t(1, polls[i].messages);
+    TEST_ASSERT_EQUAL_UINT32(skipped + NUM_ENTITIES, discovery.get_skipped());
+}
+
+void test_changed_config_resent() {
+    connect_and_run();
+    entities[2].setName("Maintenance");
+    const size_t first = mqtt.messages.size();
+    TEST_ASSERT_EQUAL_size_t(1, total_configs(connect_and_run()));
+    bool found = false;
+    for (size_t i = first; i < mqtt.messages.size(); i++) {
+        if (mqtt.messages[i].topic == "homeassistant/button/feeder/enter_maintenance/config") {
+            TEST_ASSERT_NOT_EQUAL(std::string::npos, mqtt.messages[i].payload.find("Maintenance"));
+            found = true;
+        }
+    }
+    TEST_ASSERT_TRUE(found);
+
+    // The new config is retained from now on.
+    TEST_ASSERT_EQUAL_size_t(0, total_configs(connect_and_run()));
+}
+
+void test_home_assistant_online_resends() {
+    connect_and_run();
+    static const uint8_t ONLINE[] = {'o', 'n', 'l', 'i', 'n', 'e'};
+    TEST_ASSERT_TRUE(discovery.on_message(Discovery::STATUS_TOPIC, ONLINE, sizeof(ONLINE)));
+    size_t configs = 0;
+    while (discovery.is_announcing()) {
+        const Poll p = poll();
+        TEST_ASSERT_LESS_OR_EQUAL(1, p.configs);
+        configs += p.configs;
+    }
+    TEST_ASSERT_EQUAL_size_t(NUM_ENTITIES, configs);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_one_entity_per_poll);
+    RUN_TEST(test_nothing_sent_while_busy);
+    RUN_TEST(test_nothing_sent_while_disconnected);
+    RUN_TEST(test_unchanged_configs_skipped);
+    RUN_TEST(test_changed_config_resent);
+    RUN_TEST(test_home_assistant_online_resends);
+    return UNITY_END();
+}
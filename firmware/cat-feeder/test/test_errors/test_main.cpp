@@ -0,0 +1,77 @@
+#include <unity.h>
+#include "text.h"
+
+static constexpr size_t CODES = static_cast<size_t>(ErrorCode::COUNT);
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_empty_mask_is_none() {
+    TEST_ASSERT_EQUAL(static_cast<int>(ErrorCode::NONE), static_cast<int>(error_highest(0)));
+}
+
+void test_single_bits() {
+    uint32_t all = 0;
+    for (size_t i = 1; i < CODES; i++) {
+        const auto code = static_cast<ErrorCode>(i);
+        TEST_ASSERT_EQUAL(i, static_cast<int>(error_highest(error_bit(code))));
+        TEST_ASSERT_EQUAL_UINT32(0, all & error_bit(code));
+        all |= error_bit(code);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, all & error_bit(ErrorCode::NONE));
+}
+
+void test_every_pair_reports_higher_priority() {
+    for (size_t a = 1; a < CODES; a++) {
+        for (size_t b = a; b < CODES; b++) {
+            const uint32_t mask = error_bit(static_cast<ErrorCode>(a)) | error_bit(static_cast<ErrorCode>(b));
+            TEST_ASSERT_EQUAL(a, static_cast<int>(error_highest(mask)));
+        }
+    }
+}
+
+void test_all_subsets_report_lowest_index() {
+    for (uint32_t subset = 1; subset < (1u << (CODES - 1)); subset++) {
+        uint32_t mask = 0;
+        size_t lowest = CODES;
+        for (size_t i = 1; i < CODES; i++) {
+            if (!(subset & (1u << (i - 1)))) continue;
+            mask |= error_bit(static_cast<ErrorCode>(i));
+            if (i < lowest) lowest = i;
+        }
+        TEST_ASSERT_EQUAL(lowest, static_cast<int>(error_highest(mask)));
+    }
+}
+
+void test_draining_mask_visits_in_priority_order() {
+    uint32_t mask = error_bit(ErrorCode::REFILL_SOON) | error_bit(ErrorCode::MOTOR_TIMEOUT)
+        | error_bit(ErrorCode::POWER_LOSS) | error_bit(ErrorCode::JAMMED_MAYBE);
+    static const ErrorCode EXPECTED[] = {
+        ErrorCode::MOTOR_TIMEOUT, ErrorCode::POWER_LOSS, ErrorCode::JAMMED_MAYBE, ErrorCode::REFILL_SOON,
+    };
+    for (const ErrorCode expected : EXPECTED) {
+        const ErrorCode code = error_highest(mask);
+        TEST_ASSERT_EQUAL(static_cast<int>(expected), static_cast<int>(code));
+        mask &= ~error_bit(code);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, mask);
+}
+
+void test_priority_is_constant_expression() {
+    static_assert(error_highest(error_bit(ErrorCode::SENSOR_TIMEOUT) | error_bit(ErrorCode::REFILL_SOON)) == ErrorCode::SENSOR_TIMEOUT);
+    TEST_ASSERT_EQUAL_STRING("Motor timeout", text(error_highest(~0u >> 1)));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_mask_is_none);
+    RUN_TEST(test_single_bits);
+    RUN_TEST(test_every_pair_reports_higher_priority);
+    RUN_TEST(test_all_subsets_report_lowest_index);
+    RUN_TEST(test_draining_mask_visits_in_priority_order);
+    RUN_TEST(test_priority_is_constant_expression);
+    return UNITY_END();
+}
@@ -0,0 +1,137 @@
+#include <unity.h>
+#include <random>
+#include <vector>
+#include "forecast.h"
+
+static constexpr int32_t DAY_MILLIS = 86400000;
+
+/**
+ * Records a day's worth of feeds and closes the day.
+ */
+static void feed_day(Forecaster &forecaster, const float grams) {
+    forecaster.add(grams / 2.0f);
+    forecaster.update(DAY_MILLIS / 2);
+    forecaster.add(grams / 2.0f);
+    forecaster.update(DAY_MILLIS / 2);
+}
+
+/**
+ * Straightforward double-precision version of the forecast over the given
+ * daily totals, rounded to decigrams like the forecaster stores them.
+ */
+static double reference_days(const std::vector<float> &days, const double reservoir, const double fallback) {
+    const size_t first = days.size() > Forecaster::DAYS ? days.size() - Forecaster::DAYS : 0;
+    std::vector<double> y;
+    for (size_t i = first; i < days.size(); i++) {
+        y.push_back(std::lround(days[i] / 2.0f * 10.0f) * 2 / 10.0);
+    }
+    double rate = fallback;
+    double slope = 0.0;
+    if (y.size() >= Forecaster::MIN_DAYS) {
+        const double n = static_cast<double>(y.size());
+        double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+        for (size_t i = 0; i < y.size(); i++) {
+            sx += i;
+            sy += y[i];
+            sxx += static_cast<double>(i) * i;
+            sxy += i * y[i];
+        }
+        slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+        rate = (sy - slope * sx) / n + slope * n;
+    }
+    if (std::fabs(slope) < 0.01) return rate <= 0.0 ? Forecaster::MAX_DAYS : std::fmin(reservoir / rate, Forecaster::MAX_DAYS);
+    const double b = rate - slope / 2.0;
+    const double discriminant = b * b + 2.0 * slope * reservoir;
+    if (discriminant < 0.0) return Forecaster::MAX_DAYS;
+    const double days_left = (-b + std::sqrt(discriminant)) / slope;
+    return days_left < 0.0 ? Forecaster::MAX_DAYS : std::fmin(days_left, Forecaster::MAX_DAYS);
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_empty_reservoir() {
+    Forecaster forecaster;
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, forecaster.days_remaining(0.0f, 60.0f));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, forecaster.days_remaining(-5.0f, 60.0f));
+}
+
+void test_fallback_until_min_days() {
+    Forecaster forecaster;
+    for (size_t day = 0; day < Forecaster::MIN_DAYS - 1; day++) {
+        feed_day(forecaster, 90.0f);
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, 10.0f, forecaster.days_remaining(600.0f, 60.0f));
+    }
+    feed_day(forecaster, 90.0f);
+    TEST_ASSERT_EQUAL(Forecaster::MIN_DAYS, forecaster.get_count());
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 600.0f / 90.0f, forecaster.days_remaining(600.0f, 60.0f));
+}
+
+void test_steady_consumption() {
+    Forecaster forecaster;
+    for (int day = 0; day < 30; day++) feed_day(forecaster, 50.0f);
+    TEST_ASSERT_EQUAL(Forecaster::DAYS, forecaster.get_count());
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 20.0f, forecaster.days_remaining(1000.0f, 60.0f));
+}
+
+void test_trends() {
+    Forecaster rising;
+    Forecaster falling;
+    for (int day = 0; day < 10; day++) {
+        feed_day(rising, 40.0f + 2.0f * day);
+        feed_day(falling, 90.0f - 10.0f * day);
+    }
+    TEST_ASSERT_LESS_THAN(1000.0f / 58.0f, rising.days_remaining(1000.0f, 60.0f));
+    TEST_ASSERT_EQUAL_FLOAT(Forecaster::MAX_DAYS, falling.days_remaining(1000.0f, 60.0f));
+}
+
+void test_running_sums_match_reference() {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> grams(20.0f, 120.0f);
+    Forecaster forecaster;
+    std::vector<float> days;
+    for (int day = 0; day < 100; day++) {
+        days.push_back(grams(rng));
+        feed_day(forecaster, days.back());
+        const double expected = reference_days(days, 1500.0, 60.0);
+        const float actual = forecaster.days_remaining(1500.0f, 60.0f);
+        TEST_ASSERT_FLOAT_WITHIN(std::fmax(0.01, expected * 1e-3), expected, actual);
+    }
+}
+
+void test_cache_follows_inputs() {
+    Forecaster forecaster;
+    for (int day = 0; day < 5; day++) feed_day(forecaster, 60.0f);
+    const float before = forecaster.days_remaining(600.0f, 60.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-2f, 10.0f, before);
+
+    // Feeds within the day don't change the fit until the day closes.
+    forecaster.add(120.0f);
+    TEST_ASSERT_EQUAL_FLOAT(before, forecaster.days_remaining(600.0f, 60.0f));
+    forecaster.update(DAY_MILLIS);
+    TEST_ASSERT_LESS_THAN(before, forecaster.days_remaining(600.0f, 60.0f));
+
+    // A new reservoir readout is picked up immediately.
+    TEST_ASSERT_LESS_THAN(forecaster.days_remaining(600.0f, 60.0f), forecaster.days_remaining(300.0f, 60.0f));
+}
+
+void test_cache_follows_fallback() {
+    Forecaster forecaster;
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 10.0f, forecaster.days_remaining(600.0f, 60.0f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 20.0f, forecaster.days_remaining(600.0f, 30.0f));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_reservoir);
+    RUN_TEST(test_fallback_until_min_days);
+    RUN_TEST(test_steady_consumption);
+    RUN_TEST(test_trends);
+    RUN_TEST(test_running_sums_match_reference);
+    RUN_TEST(test_cache_follows_inputs);
+    RUN_TEST(test_cache_follows_fallback);
+    return UNITY_END();
+}
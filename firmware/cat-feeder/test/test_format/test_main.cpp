@@ -0,0 +1,124 @@
+#include <unity.h>
+#include <random>
+#include "format.h"
+
+/**
+ * Checks that a formatter call produces exactly what snprintf does for the
+ * format it replaces.
+ */
+#define EXPECT_SAME(call, ...) do { \
+        char expected[64]; \
+        char actual[64]; \
+        snprintf(expected, sizeof(expected), __VA_ARGS__); \
+        Formatter f(actual); \
+        f.call; \
+        TEST_ASSERT_EQUAL_STRING(expected, actual); \
+        TEST_ASSERT_EQUAL_size_t(strlen(expected), f.get_length()); \
+    } while (0)
+
+static const int32_t INTEGERS[] = {
+    0, 1, -1, 9, -9, 10, -10, 99, 100, 12345, -12345, 99999, 100000,
+    INT32_MAX, INT32_MIN, INT32_MIN + 1,
+};
+
+static const float DECIMALS[] = {
+    0.0f, -0.0f, 0.04f, -0.04f, 0.05f, -0.05f, 0.15f, 0.25f, 0.35f, 0.45f,
+    1.25f, 2.5f, -2.5f, 9.95f, 99.95f, 123.456f, -123.456f, 1234.5f, 3276.7f,
+    100000.0f, 1e9f,
+};
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_text_and_character() {
+    EXPECT_SAME(text("hello").character(' ').text("world"), "%s%c%s", "hello", ' ', "world");
+    EXPECT_SAME(text(""), "%s", "");
+}
+
+void test_integer() {
+    for (const int32_t v : INTEGERS) {
+        EXPECT_SAME(integer(v), "%ld", static_cast<long>(v));
+        EXPECT_SAME(integer(v, 0, true), "%+ld", static_cast<long>(v));
+        EXPECT_SAME(integer(v, 5), "%5ld", static_cast<long>(v));
+        EXPECT_SAME(integer(v, 7, true), "%+7ld", static_cast<long>(v));
+        EXPECT_SAME(integer(v, 2, false, true), "%02ld", static_cast<long>(v));
+        EXPECT_SAME(integer(v, 6, true, true), "%+06ld", static_cast<long>(v));
+    }
+}
+
+void test_natural_and_hex() {
+    static const uint32_t VALUES[] = {0, 1, 10, 4294967295u, 0x80000000u, 0xDEADBEEFu};
+    for (const uint32_t v : VALUES) {
+        EXPECT_SAME(natural(v), "%lu", static_cast<unsigned long>(v));
+        EXPECT_SAME(hex(v), "0x%08lx", static_cast<unsigned long>(v));
+    }
+}
+
+void test_decimal() {
+    for (const float v : DECIMALS) {
+        EXPECT_SAME(decimal(v), "%.1f", static_cast<double>(v));
+        EXPECT_SAME(decimal(v, 6), "%6.1f", static_cast<double>(v));
+        EXPECT_SAME(decimal(v, 7, true), "%+7.1f", static_cast<double>(v));
+    }
+}
+
+void test_decimal_random() {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> grams(-5000.0f, 5000.0f);
+    for (int i = 0; i < 100000; i++) {
+        const float v = grams(rng);
+        EXPECT_SAME(decimal(v, 0, true), "%+.1f", static_cast<double>(v));
+    }
+}
+
+void test_decimal_exact_halves() {
+    // Values exactly halfway between two outputs round to even.
+    for (int tenths = -2000; tenths <= 2000; tenths++) {
+        const float v = static_cast<float>(tenths) / 10.0f + 0.05f;
+        EXPECT_SAME(decimal(v), "%.1f", static_cast<double>(v));
+        const float h = static_cast<float>(tenths) / 4.0f;
+        EXPECT_SAME(decimal(h), "%.1f", static_cast<double>(h));
+    }
+}
+
+void test_clock() {
+    static const unsigned long SECONDS[] = {0, 1, 59, 60, 61, 3599, 3600, 3661, 86399, 360000};
+    for (const unsigned long s : SECONDS) {
+        EXPECT_SAME(clock(s), "%lu:%02lu:%02lu", s / 3600, s / 60 % 60, s % 60);
+        EXPECT_SAME(clock(s, false), "%lu:%02lu", s / 60, s % 60);
+    }
+}
+
+void test_ip() {
+    static const uint8_t ADDRESS[4] = {192, 168, 0, 255};
+    EXPECT_SAME(ip(ADDRESS), "%u.%u.%u.%u", 192u, 168u, 0u, 255u);
+}
+
+void test_truncation() {
+    for (size_t size = 1; size <= 12; size++) {
+        char expected[16];
+        char actual[16];
+        snprintf(expected, size, "%s%+.1f", "weight", -12.25);
+        Formatter f(actual, size);
+        f.text("weight").decimal(-12.25f, 0, true);
+        TEST_ASSERT_EQUAL_STRING(expected, actual);
+        TEST_ASSERT_EQUAL_size_t(strlen(expected), f.get_length());
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_text_and_character);
+    RUN_TEST(test_integer);
+    RUN_TEST(test_natural_and_hex);
+    RUN_TEST(test_decimal);
+    RUN_TEST(test_decimal_random);
+    RUN_TEST(test_decimal_exact_halves);
+    RUN_TEST(test_clock);
+    RUN_TEST(test_ip);
+    RUN_TEST(test_truncation);
+    return UNITY_END();
+}
@@ -0,0 +1,237 @@
+#include <unity.h>
+#include <LittleFS.h>
+#include <memory>
+#include <random>
+#include "history.h"
+
+using Series = History::Series;
+
+static_assert(sizeof(History::Bucket) * History::SERIES * History::BUCKETS <= History::BUDGET_BYTES, "history exceeds its RAM budget");
+
+static constexpr uint32_t HOUR_MILLIS = 3600000;
+
+/**
+ * Advances the history clock in one-second steps.
+ */
+static void run(History &history, const uint32_t millis) {
+    for (uint32_t t = 0; t < millis; t += 1000) {
+        history.update(1000);
+    }
+}
+
+void setUp() {
+    LittleFS.format();
+}
+
+void tearDown() {
+}
+
+void test_bucket_statistics() {
+    auto history = std::make_unique<History>();
+    history->add(Series::BOWL, 10.0f);
+    history->add(Series::BOWL, 12.5f);
+    history->add(Series::BOWL, 11.0f);
+    history->add(Series::BOWL, 11.04f);
+    history->update(60000);
+    TEST_ASSERT_EQUAL(1, history->get_count(0));
+    const auto &bucket = history->get(Series::BOWL, 0, 0);
+    TEST_ASSERT_EQUAL_INT16(100, bucket.min);
+    TEST_ASSERT_EQUAL_INT16(125, bucket.max);
+    TEST_ASSERT_EQUAL_INT16(111, bucket.mean);
+    TEST_ASSERT_EQUAL_UINT16(4, bucket.count);
+
+    // Series without samples get empty buckets.
+    TEST_ASSERT_EQUAL_UINT16(0, history->get(Series::INTAKE, 0, 0).count);
+}
+
+void test_mean_rounds_half_away_from_zero() {
+    auto history = std::make_unique<History>();
+    history->add(Series::BOWL, -0.1f);
+    history->add(Series::BOWL, -0.2f);
+    history->add(Series::INTAKE, 0.1f);
+    history->add(Series::INTAKE, 0.2f);
+    history->update(60000);
+    TEST_ASSERT_EQUAL_INT16(-2, history->get(Series::BOWL, 0, 0).mean);
+    TEST_ASSERT_EQUAL_INT16(2, history->get(Series::INTAKE, 0, 0).mean);
+}
+
+void test_full_reservoir_in_range() {
+    auto history = std::make_unique<History>();
+    history->add(Series::RESERVOIR, 4321.4f);
+    history->add(Series::RESERVOIR, 5000.0f);
+    history->update(60000);
+    const auto &bucket = history->get(Series::RESERVOIR, 0, 0);
+    TEST_ASSERT_EQUAL_FLOAT(4321.0f, History::to_grams(Series::RESERVOIR, bucket.min));
+    TEST_ASSERT_EQUAL_FLOAT(5000.0f, History::to_grams(Series::RESERVOIR, bucket.max));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, 4660.7f, History::to_grams(Series::RESERVOIR, bucket.mean));
+}
+
+void test_tiers_roll_up_the_same_samples() {
+    auto history = std::make_unique<History>();
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> grams(0.0f, 300.0f);
+    int16_t min = INT16_MAX;
+    int16_t max = INT16_MIN;
+    int64_t sum = 0;
+    uint32_t count = 0;
+    for (uint32_t second = 0; second < 3600; second++) {
+        if (second % 10 == 0) {
+            const float g = grams(rng);
+            history->add(Series::BOWL, g);
+            const auto v = static_cast<int16_t>(lroundf(g * 10.0f));
+            min = std::min(min, v);
+            max = std::max(max, v);
+            sum += v;
+            count++;
+        }
+        history->update(1000);
+    }
+    TEST_ASSERT_EQUAL(60, history->get_count(0));
+    TEST_ASSERT_EQUAL(4, history->get_count(1));
+    TEST_ASSERT_EQUAL(1, history->get_count(2));
+    const auto &hour = history->get(Series::BOWL, 2, 0);
+    TEST_ASSERT_EQUAL_INT16(min, hour.min);
+    TEST_ASSERT_EQUAL_INT16(max, hour.max);
+    TEST_ASSERT_EQUAL_INT16(static_cast<int16_t>((sum + count / 2) / count), hour.mean);
+    TEST_ASSERT_EQUAL_UINT16(count, hour.count);
+
+    // The quarter hours add up to the hour.
+    uint32_t quarter_count = 0;
+    for (size_t age = 0; age < 4; age++) {
+        quarter_count += history->get(Series::BOWL, 1, age).count;
+    }
+    TEST_ASSERT_EQUAL_UINT32(count, quarter_count);
+}
+
+void test_ring_keeps_newest() {
+    auto history = std::make_unique<History>();
+    for (size_t minute = 0; minute < History::LENGTH[0] + 30; minute++) {
+        history->add(Series::INTAKE, static_cast<float>(minute));
+        history->update(60000);
+    }
+    TEST_ASSERT_EQUAL(History::LENGTH[0], history->get_count(0));
+    TEST_ASSERT_EQUAL_INT16((History::LENGTH[0] + 29) * 10, history->get(Series::INTAKE, 0, 0).mean);
+    TEST_ASSERT_EQUAL_INT16(30 * 10, history->get(Series::INTAKE, 0, History::LENGTH[0] - 1).mean);
+}
+
+void test_save_load_round_trip() {
+    auto history = std::make_unique<History>();
+    for (uint32_t hour = 0; hour < 30; hour++) {
+        for (uint32_t minute = 0; minute < 60; minute++) {
+            history->add(Series::RESERVOIR, 3000.0f - static_cast<float>(hour * 60 + minute));
+            history->add(Series::BOWL, static_cast<float>(minute));
+            history->update(60000);
+        }
+        TEST_ASSERT_TRUE(history->is_save_due());
+        TEST_ASSERT_TRUE(history->save());
+        TEST_ASSERT_FALSE(history->is_save_due());
+    }
+
+    auto restored = std::make_unique<History>();
+    TEST_ASSERT_TRUE(restored->load());
+    for (size_t tier = 0; tier < History::TIERS; tier++) {
+        TEST_ASSERT_EQUAL(history->get_count(tier), restored->get_count(tier));
+        for (size_t s = 0; s < History::SERIES; s++) {
+            for (size_t age = 0; age < history->get_count(tier); age++) {
+                const auto &a = history->get(static_cast<Series>(s), tier, age);
+                const auto &b = restored->get(static_cast<Series>(s), tier, age);
+                TEST_ASSERT_EQUAL_MEMORY(&a, &b, sizeof(a));
+            }
+        }
+    }
+}
+
+void test_save_writes_only_new_buckets() {
+    auto history = std::make_unique<History>();
+    size_t largest = 0;
+    size_t total = 0;
+    const size_t snapshot = sizeof(History::Bucket) * History::SERIES * History::BUCKETS;
+    for (uint32_t hour = 0; hour < 48; hour++) {
+        run(*history, HOUR_MILLIS);
+        const size_t before = LittleFS.bytes_written;
+        TEST_ASSERT_TRUE(history->save());
+        const size_t written = LittleFS.bytes_written - before;
+        largest = std::max(largest, written);
+        total += written;
+    }
+
+    // Most saves append about 1.7kB; every few hours one writes a new
+    // snapshot.
+    TEST_ASSERT_LESS_THAN(snapshot + 100, largest);
+    TEST_ASSERT_LESS_THAN(48 * snapshot / 4, total);
+}
+
+void test_power_loss_while_folding_journal() {
+    for (int commits = 0; commits <= 4; commits++) {
+        LittleFS.format();
+        auto history = std::make_unique<History>();
+        uint32_t hours = 0;
+
+        // Fill the journal up to the point where the next save folds it
+        // into a snapshot; an hour adds 65 entries.
+        const size_t hour_bytes = 65 * (2 + 3 * sizeof(History::Bucket));
+        while (LittleFS.contents("/history.log").size() + hour_bytes + 8 <= 16 * 1024) {
+            for (uint32_t minute = 0; minute < 60; minute++) {
+                history->add(Series::INTAKE, static_cast<float>(hours % 100));
+                history->update(60000);
+            }
+            hours++;
+            TEST_ASSERT_TRUE(history->save());
+        }
+
+        // Now lose power part way through the next save.
+        for (uint32_t minute = 0; minute < 60; minute++) {
+            history->add(Series::INTAKE, 42.0f);
+            history->update(60000);
+        }
+        hours++;
+        LittleFS.cut_power_after(commits);
+        history->save();
+        if (!LittleFS.restore_power()) {
+            TEST_ASSERT_FALSE(LittleFS.exists("/history.log"));
+        }
+
+        // Whatever made it to flash must be consistent: no bucket twice,
+        // and either all or none of the last hour.
+        auto restored = std::make_unique<History>();
+        TEST_ASSERT_TRUE(restored->load());
+        const size_t count = restored->get_count(2);
+        TEST_ASSERT_TRUE(count == hours || count == hours - 1);
+        for (size_t age = 0; age < count; age++) {
+            const auto &a = history->get(Series::INTAKE, 2, age + hours - count);
+            const auto &b = restored->get(Series::INTAKE, 2, age);
+            TEST_ASSERT_EQUAL_MEMORY(&a, &b, sizeof(a));
+        }
+
+        // And saving continues from there.
+        restored->update(HOUR_MILLIS);
+        TEST_ASSERT_TRUE(restored->save());
+        auto again = std::make_unique<History>();
+        TEST_ASSERT_TRUE(again->load());
+        TEST_ASSERT_EQUAL(count + 1, again->get_count(2));
+    }
+}
+
+void test_print() {
+    auto history = std::make_unique<History>();
+    history->add(Series::RESERVOIR, 4000.0f);
+    history->update(60000);
+    history->update(60000);
+    StringPrint out;
+    history->print(out, Series::RESERVOIR, 0);
+    TEST_ASSERT_EQUAL_STRING("-2min 4000.0 4000.0 4000.0 1\r\n-1min -\r\n", out.output.c_str());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_statistics);
+    RUN_TEST(test_mean_rounds_half_away_from_zero);
+    RUN_TEST(test_full_reservoir_in_range);
+    RUN_TEST(test_tiers_roll_up_the_same_samples);
+    RUN_TEST(test_ring_keeps_newest);
+    RUN_TEST(test_save_load_round_trip);
+    RUN_TEST(test_save_writes_only_new_buckets);
+    RUN_TEST(test_power_loss_while_folding_journal);
+    RUN_TEST(test_print);
+    return UNITY_END();
+}
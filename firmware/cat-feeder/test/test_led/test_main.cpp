@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <initializer_list>
+#include <unity.h>
+#include "sequence.h"
+
+/**
+ * Number of steps to play, well past the 16-bit wrap of a free-running
+ * step counter (about 55 minutes at 50ms per step).
+ */
+static constexpr uint32_t LONG_RUN = 200000;
+
+/**
+ * Plays a setting from the start and checks every step against the
+ * expected brightness for its phase within the period.
+ */
+template <class Expected>
+static void check_run(const LedPattern pattern, const uint8_t count, const uint32_t period, Expected expected) {
+    LedSequence sequence;
+    const uint16_t setting = LedSequence::setting(pattern, count);
+    TEST_ASSERT_EQUAL_UINT16(period, LedSequence::period(pattern, count));
+    for (uint32_t i = 0; i < LONG_RUN; i++) {
+        const uint8_t level = sequence.next(setting);
+        if (level != expected(i % period)) {
+            char message[64];
+            snprintf(message, sizeof(message), "step %u: got %u", static_cast<unsigned>(i), static_cast<unsigned>(level));
+            TEST_FAIL_MESSAGE(message);
+        }
+    }
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_off_and_on() {
+    check_run(LedPattern::OFF, 0, 1, [](uint32_t) { return 0; });
+    check_run(LedPattern::ON, 0, 1, [](uint32_t) { return 255; });
+}
+
+void test_blink() {
+    check_run(LedPattern::BLINK, 0, 16, [](const uint32_t phase) { return phase < 8 ? 255 : 0; });
+}
+
+void test_breathe() {
+    static constexpr uint8_t RAMP[20] = {0, 13, 26, 40, 53, 67, 80, 93, 107, 120, 134, 147, 161, 174, 187, 201, 214, 228, 241, 255};
+    check_run(LedPattern::BREATHE, 0, 40, [](const uint32_t phase) { return phase < 20 ? RAMP[phase] : RAMP[39 - phase]; });
+}
+
+void test_flash_counts() {
+    for (const uint8_t count : {1, 2, 5, 11}) {
+        check_run(LedPattern::FLASH, count, count * 6u + 14, [count](const uint32_t phase) {
+            return phase < count * 6u && phase % 6 < 3 ? 255 : 0;
+        });
+    }
+}
+
+void test_flash_three_sequence() {
+    // Three 150ms flashes, then a 700ms pause, then again.
+    static constexpr uint8_t ON = 255;
+    static constexpr uint8_t EXPECTED[] = {
+        ON, ON, ON, 0, 0, 0, ON, ON, ON, 0, 0, 0, ON, ON, ON, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        ON, ON, ON, 0,
+    };
+    LedSequence sequence;
+    const uint16_t setting = LedSequence::setting(LedPattern::FLASH, 3);
+    for (const uint8_t expected : EXPECTED) {
+        TEST_ASSERT_EQUAL_UINT8(expected, sequence.next(setting));
+    }
+}
+
+void test_restart_on_change() {
+    LedSequence sequence;
+    const uint16_t blink = LedSequence::setting(LedPattern::BLINK, 0);
+    for (int i = 0; i < 10; i++) sequence.next(blink);
+    TEST_ASSERT_EQUAL_UINT8(0, sequence.next(blink));
+
+    // A different flash count is a different setting, and starts with a
+    // flash.
+    sequence.next(LedSequence::setting(LedPattern::FLASH, 2));
+    for (int i = 0; i < 3; i++) sequence.next(LedSequence::setting(LedPattern::FLASH, 2));
+    TEST_ASSERT_EQUAL_UINT8(255, sequence.next(LedSequence::setting(LedPattern::FLASH, 4)));
+
+    // Back to blinking starts from the on half again.
+    TEST_ASSERT_EQUAL_UINT8(255, sequence.next(blink));
+    for (int i = 0; i < 7; i++) TEST_ASSERT_EQUAL_UINT8(255, sequence.next(blink));
+    TEST_ASSERT_EQUAL_UINT8(0, sequence.next(blink));
+}
+
+void test_same_setting_continues() {
+    LedSequence sequence;
+    const uint16_t breathe = LedSequence::setting(LedPattern::BREATHE, 0);
+    for (int i = 0; i < 19; i++) sequence.next(breathe);
+    TEST_ASSERT_EQUAL_UINT8(255, sequence.next(breathe));
+    TEST_ASSERT_EQUAL_UINT8(255, sequence.next(breathe));
+    TEST_ASSERT_EQUAL_UINT8(241, sequence.next(breathe));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_off_and_on);
+    RUN_TEST(test_blink);
+    RUN_TEST(test_breathe);
+    RUN_TEST(test_flash_counts);
+    RUN_TEST(test_flash_three_sequence);
+    RUN_TEST(test_restart_on_change);
+    RUN_TEST(test_same_setting_continues);
+    return UNITY_END();
+}
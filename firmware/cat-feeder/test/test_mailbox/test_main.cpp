@@ -0,0 +1,205 @@
+#include <unity.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "mailbox.h"
+
+/**
+ * Value whose fields must always be seen together.
+ */
+struct Snapshot {
+    uint32_t value;
+    uint32_t inverse;
+    uint32_t padding[14];
+};
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_mailbox_empty() {
+    Mailbox<Snapshot> mailbox;
+    Snapshot out = {};
+    uint32_t seen = 0;
+    TEST_ASSERT_FALSE(mailbox.fetch(out, seen));
+}
+
+void test_mailbox_latest_value_once() {
+    Mailbox<Snapshot> mailbox;
+    Snapshot out = {};
+    uint32_t seen = 0;
+    mailbox.post({1, ~1u, {}});
+    mailbox.post({2, ~2u, {}});
+    TEST_ASSERT_TRUE(mailbox.fetch(out, seen));
+    TEST_ASSERT_EQUAL_UINT32(2, out.value);
+    TEST_ASSERT_FALSE(mailbox.fetch(out, seen));
+    mailbox.post({3, ~3u, {}});
+    TEST_ASSERT_TRUE(mailbox.fetch(out, seen));
+    TEST_ASSERT_EQUAL_UINT32(3, out.value);
+}
+
+void test_mailbox_concurrent_never_torn() {
+    static Mailbox<Snapshot> mailbox;
+    constexpr uint32_t POSTS = 200000;
+    std::thread producer([] {
+        for (uint32_t i = 1; i <= POSTS; i++) {
+            Snapshot s = {i, ~i, {}};
+            for (auto &p : s.padding) p = i;
+            mailbox.post(s);
+        }
+    });
+    Snapshot out = {};
+    uint32_t seen = 0;
+    uint32_t last = 0;
+    bool ok = true;
+    while (last < POSTS) {
+        if (!mailbox.fetch(out, seen)) continue;
+        ok = ok && out.inverse == ~out.value && out.value > last;
+        for (const auto p : out.padding) ok = ok && p == out.value;
+        last = out.value;
+    }
+    producer.join();
+    TEST_ASSERT_TRUE(ok);
+}
+
+/**
+ * Snapshot stamped with the time it was posted.
+ */
+struct Stamped {
+    uint64_t posted_nanos;
+    uint32_t value;
+    uint32_t padding[13];
+};
+
+/**
+ * Returns a monotonic time in nanoseconds.
+ */
+static uint64_t now_nanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Waits for the given time without yielding, like a render loop does.
+ */
+static void spin_until(const uint64_t nanos) {
+    while (now_nanos() < nanos) {
+    }
+}
+
+void test_mailbox_latency_state_to_frame() {
+    // The main core posts a state change every 200us; the rendering core
+    // takes 500us per frame, so it always shows the latest state and skips
+    // the ones in between.
+    static Mailbox<Stamped> mailbox;
+    constexpr uint32_t POSTS = 2000;
+    constexpr uint64_t POST_INTERVAL_NANOS = 200000;
+    constexpr uint64_t FRAME_NANOS = 500000;
+    std::thread producer([] {
+        uint64_t next = now_nanos();
+        for (uint32_t i = 1; i <= POSTS; i++) {
+            spin_until(next);
+            next += POST_INTERVAL_NANOS;
+            Stamped s = {};
+            s.posted_nanos = now_nanos();
+            s.value = i;
+            mailbox.post(s);
+        }
+    });
+
+    std::vector<uint64_t> fetch_latencies;
+    std::vector<uint64_t> frame_latencies;
+    Stamped out = {};
+    uint32_t seen = 0;
+    uint32_t last = 0;
+    bool ordered = true;
+    while (last < POSTS) {
+        if (!mailbox.fetch(out, seen)) continue;
+        const uint64_t fetched = now_nanos();
+        spin_until(fetched + FRAME_NANOS);
+        fetch_latencies.push_back(fetched - out.posted_nanos);
+        frame_latencies.push_back(now_nanos() - out.posted_nanos);
+        ordered = ordered && out.value > last;
+        last = out.value;
+    }
+    producer.join();
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_LESS_THAN(POSTS, frame_latencies.size());
+
+    std::sort(fetch_latencies.begin(), fetch_latencies.end());
+    std::sort(frame_latencies.begin(), frame_latencies.end());
+    const auto p50 = [](const std::vector<uint64_t> &v) { return v[v.size() / 2] / 1000; };
+    const auto max = [](const std::vector<uint64_t> &v) { return v.back() / 1000; };
+    char message[160];
+    snprintf(message, sizeof(message), "%zu frames for %u posts; post to fetch p50 %lluus max %lluus, post to frame p50 %lluus max %lluus",
+        frame_latencies.size(), static_cast<unsigned>(POSTS),
+        static_cast<unsigned long long>(p50(fetch_latencies)), static_cast<unsigned long long>(max(fetch_latencies)),
+        static_cast<unsigned long long>(p50(frame_latencies)), static_cast<unsigned long long>(max(frame_latencies)));
+    TEST_MESSAGE(message);
+
+    // A state is picked up by the next frame at the latest, so the typical
+    // post-to-frame latency is about two frames; the bound leaves room for
+    // a busy host scheduling both threads on one CPU.
+    TEST_ASSERT_LESS_THAN(10 * FRAME_NANOS / 1000, p50(frame_latencies));
+}
+
+void test_queue_fifo_and_full() {
+    Queue<uint32_t, 4> queue;
+    uint32_t item = 0;
+    TEST_ASSERT_FALSE(queue.pop(item));
+    for (uint32_t i = 0; i < 4; i++) TEST_ASSERT_TRUE(queue.push(i));
+    TEST_ASSERT_FALSE(queue.push(4));
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(queue.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(i, item);
+    }
+    TEST_ASSERT_FALSE(queue.pop(item));
+}
+
+void test_queue_wraps() {
+    Queue<uint32_t, 4> queue;
+    uint32_t item = 0;
+    for (uint32_t i = 0; i < 1000; i++) {
+        TEST_ASSERT_TRUE(queue.push(i));
+        TEST_ASSERT_TRUE(queue.push(i + 1));
+        TEST_ASSERT_TRUE(queue.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(i, item);
+        TEST_ASSERT_TRUE(queue.pop(item));
+        TEST_ASSERT_EQUAL_UINT32(i + 1, item);
+    }
+}
+
+void test_queue_concurrent_in_order() {
+    static Queue<uint32_t, 16> queue;
+    constexpr uint32_t ITEMS = 200000;
+    std::thread producer([] {
+        for (uint32_t i = 0; i < ITEMS;) {
+            if (queue.push(i)) i++;
+        }
+    });
+    uint32_t expected = 0;
+    bool ok = true;
+    while (expected < ITEMS) {
+        uint32_t item = 0;
+        if (!queue.pop(item)) continue;
+        ok = ok && item == expected;
+        expected++;
+    }
+    producer.join();
+    TEST_ASSERT_TRUE(ok);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_mailbox_empty);
+    RUN_TEST(test_mailbox_latest_value_once);
+    RUN_TEST(test_mailbox_concurrent_never_torn);
+    RUN_TEST(test_mailbox_latency_state_to_frame);
+    RUN_TEST(test_queue_fifo_and_full);
+    RUN_TEST(test_queue_wraps);
+    RUN_TEST(test_queue_concurrent_in_order);
+    return UNITY_END();
+}
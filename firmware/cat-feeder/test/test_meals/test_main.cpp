@@ -0,0 +1,145 @@
+#include <unity.h>
+#include "meals.h"
+
+/**
+ * A bowl readout as the state machine delivers it.
+ */
+struct Readout {
+    uint32_t seconds;
+    float mean;
+    float stddev;
+};
+
+/**
+ * Feeds a sequence of readouts to the detector.
+ */
+template <size_t N>
+static void replay(MealDetector &detector, const Readout (&readouts)[N]) {
+    for (const auto &r : readouts) {
+        detector.sample(r.mean, r.stddev, r.seconds * 1000);
+    }
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_bracketed_meal_is_timed() {
+    // Stable readouts every five minutes; the cat shows up at 600s and the
+    // bowl is then read every 30s until it is stable again.
+    static const Readout READOUTS[] = {
+        {0, 40.0f, 0.2f},
+        {300, 40.1f, 0.3f},
+        {600, 38.0f, 9.0f},
+        {630, 35.0f, 12.0f},
+        {660, 31.0f, 7.5f},
+        {690, 28.0f, 5.0f},
+        {720, 27.9f, 0.4f},
+        {1020, 27.8f, 0.2f},
+    };
+    MealDetector detector;
+    replay(detector, READOUTS);
+    TEST_ASSERT_EQUAL(1, detector.get_count());
+    TEST_ASSERT_EQUAL_UINT32(1, detector.get_sequence());
+    const auto &meal = detector.get_meal(0);
+    TEST_ASSERT_TRUE(meal.timed);
+    TEST_ASSERT_EQUAL_UINT32(600000, meal.start_millis);
+    TEST_ASSERT_EQUAL_UINT32(120000, meal.duration_millis);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 12.1f, meal.grams);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 6.05f, meal.rate());
+    TEST_ASSERT_EQUAL_PTR(&meal, detector.get_last_timed());
+    TEST_ASSERT_FALSE(detector.is_eating());
+}
+
+void test_meal_between_readouts_is_not_timed() {
+    static const Readout READOUTS[] = {
+        {0, 40.0f, 0.2f},
+        {300, 30.0f, 0.3f},
+    };
+    MealDetector detector;
+    replay(detector, READOUTS);
+    TEST_ASSERT_EQUAL(1, detector.get_count());
+    const auto &meal = detector.get_meal(0);
+    TEST_ASSERT_FALSE(meal.timed);
+    TEST_ASSERT_EQUAL_UINT32(0, meal.start_millis);
+    TEST_ASSERT_EQUAL_UINT32(0, meal.duration_millis);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 10.0f, meal.grams);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, meal.rate());
+    TEST_ASSERT_NULL(detector.get_last_timed());
+}
+
+void test_last_timed_skips_untimed_meals() {
+    static const Readout READOUTS[] = {
+        {0, 50.0f, 0.2f},
+        {300, 45.0f, 6.0f},
+        {330, 40.0f, 0.2f},
+        {630, 30.0f, 0.2f},
+    };
+    MealDetector detector;
+    replay(detector, READOUTS);
+    TEST_ASSERT_EQUAL(2, detector.get_count());
+    TEST_ASSERT_FALSE(detector.get_meal(0).timed);
+    TEST_ASSERT_EQUAL_PTR(&detector.get_meal(1), detector.get_last_timed());
+    TEST_ASSERT_EQUAL_UINT32(30000, detector.get_last_timed()->duration_millis);
+}
+
+void test_feed_and_noise_are_not_meals() {
+    MealDetector detector;
+    detector.sample(20.0f, 0.2f, 0);
+    detector.dispensed(9.0f);
+    detector.sample(29.1f, 0.2f, 60000);
+    detector.sample(28.0f, 0.3f, 360000);
+    detector.sample(29.0f, 0.3f, 660000);
+    TEST_ASSERT_EQUAL(0, detector.get_count());
+
+    // Slow nibbling below the threshold per readout still adds up.
+    detector.sample(27.5f, 0.3f, 960000);
+    detector.sample(26.5f, 0.3f, 1260000);
+    TEST_ASSERT_EQUAL(1, detector.get_count());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 2.5f, detector.get_meal(0).grams);
+}
+
+void test_refill_only_moves_baseline() {
+    MealDetector detector;
+    detector.sample(10.0f, 0.2f, 0);
+    detector.sample(60.0f, 0.2f, 300000);
+    detector.sample(55.0f, 0.2f, 600000);
+    TEST_ASSERT_EQUAL(1, detector.get_count());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 5.0f, detector.get_meal(0).grams);
+}
+
+void test_daily_totals() {
+    MealDetector detector;
+    detector.sample(40.0f, 0.2f, 0);
+    detector.sample(30.0f, 0.2f, 300000);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 10.0f, detector.get_today());
+    detector.update(86400000);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.0f, detector.get_today());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, 10.0f, detector.get_yesterday());
+}
+
+void test_ring_keeps_newest() {
+    MealDetector detector;
+    float mean = 1000.0f;
+    detector.sample(mean, 0.2f, 0);
+    for (uint32_t i = 1; i <= MealDetector::MEALS + 4; i++) {
+        mean -= 3.0f;
+        detector.sample(mean, 0.2f, i * 300000);
+    }
+    TEST_ASSERT_EQUAL(MealDetector::MEALS, detector.get_count());
+    TEST_ASSERT_EQUAL_UINT32((MealDetector::MEALS + 3) * 300000, detector.get_meal(0).start_millis);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bracketed_meal_is_timed);
+    RUN_TEST(test_meal_between_readouts_is_not_timed);
+    RUN_TEST(test_last_timed_skips_untimed_meals);
+    RUN_TEST(test_feed_and_noise_are_not_meals);
+    RUN_TEST(test_refill_only_moves_baseline);
+    RUN_TEST(test_daily_totals);
+    RUN_TEST(test_ring_keeps_newest);
+    return UNITY_END();
+}
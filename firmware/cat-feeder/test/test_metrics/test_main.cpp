@@ -0,0 +1,214 @@
+#include <unity.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "http.h"
+
+/**
+ * Body with a given number of items per section, each a line of the given
+ * length naming its section and item.
+ */
+class FakeBody : public HttpExchange::Body {
+public:
+    std::vector<size_t> items;
+    size_t line_length = 40;
+    mutable size_t calls = 0;
+
+    bool render(Formatter &f, const uint8_t section, const size_t item) const override {
+        calls++;
+        if (item >= items.at(section)) return false;
+        f.character(static_cast<char>('a' + section)).natural(static_cast<uint32_t>(item));
+        while (f.get_length() < line_length - 1) f.character('.');
+        f.character('\n');
+        return true;
+    }
+
+    /**
+     * Returns the body the exchange should send.
+     */
+    [[nodiscard]] std::string expected() const {
+        std::string body;
+        for (size_t section = 0; section < items.size(); section++) {
+            for (size_t item = 0; item < items[section]; item++) {
+                char line[256];
+                Formatter f(line);
+                render(f, static_cast<uint8_t>(section), item);
+                body.append(line, f.get_length());
+            }
+        }
+        return body;
+    }
+};
+
+static const char *const OK_HEADER = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n\r\n";
+static const char *const NOT_FOUND = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\nNot found\n";
+
+/**
+ * Feeds a request, returning the number of bytes taken up to and including
+ * the one that completed the headers, or 0 if they never completed.
+ */
+static size_t feed(HttpExchange &exchange, const char *request) {
+    for (size_t i = 0; request[i]; i++) {
+        if (exchange.receive(request[i])) return i + 1;
+    }
+    return 0;
+}
+
+/**
+ * Drains the response, recording the size of every chunk.
+ */
+static std::string drain(HttpExchange &exchange, std::vector<size_t> &chunks) {
+    std::string response;
+    chunks.clear();
+    while (const size_t length = exchange.fill()) {
+        TEST_ASSERT_LESS_OR_EQUAL(HttpExchange::BUFFER_SIZE, length);
+        // Filling again before sending must not add anything.
+        TEST_ASSERT_EQUAL_size_t(length, exchange.fill());
+        response.append(reinterpret_cast<const char *>(exchange.get_buffer()), length);
+        chunks.push_back(length);
+        exchange.consume();
+        TEST_ASSERT_LESS_THAN(1000, chunks.size());
+    }
+    return response;
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_metrics_path_is_served() {
+    FakeBody body;
+    body.items = {2, 0, 3};
+    HttpExchange exchange("/metrics", "text/plain; version=0.0.4", body, 3);
+    exchange.reset();
+    static const char REQUEST[] = "GET /metrics HTTP/1.1\r\nHost: feeder\r\nAccept: */*\r\n\r\n";
+    TEST_ASSERT_EQUAL_size_t(strlen(REQUEST), feed(exchange, REQUEST));
+    TEST_ASSERT_TRUE(exchange.is_found());
+
+    std::vector<size_t> chunks;
+    TEST_ASSERT_EQUAL_STRING((OK_HEADER + body.expected()).c_str(), drain(exchange, chunks).c_str());
+}
+
+void test_other_requests_get_404() {
+    static const char *const REQUESTS[] = {
+        "GET / HTTP/1.0\r\n\r\n",
+        "GET /metricsx HTTP/1.0\r\n\r\n",
+        "GET /metrics/ HTTP/1.0\r\n\r\n",
+        "POST /metrics HTTP/1.0\r\n\r\n",
+        "get /metrics HTTP/1.0\r\n\r\n",
+        "\r\n\r\n",
+    };
+    for (const char *request : REQUESTS) {
+        FakeBody body;
+        body.items = {5};
+        HttpExchange exchange("/metrics", "text/plain", body, 1);
+        exchange.reset();
+        TEST_ASSERT_EQUAL_size_t(strlen(request), feed(exchange, request));
+        TEST_ASSERT_FALSE(exchange.is_found());
+        std::vector<size_t> chunks;
+        TEST_ASSERT_EQUAL_STRING(NOT_FOUND, drain(exchange, chunks).c_str());
+        TEST_ASSERT_EQUAL_size_t(0, body.calls);
+    }
+}
+
+void test_request_terminator() {
+    FakeBody body;
+    body.items = {};
+    HttpExchange exchange("/metrics", "text/plain", body, 0);
+
+    // Headers end at an empty line, with or without carriage returns.
+    exchange.reset();
+    TEST_ASSERT_EQUAL_size_t(0, feed(exchange, "GET /metrics HTTP/1.0\r\nHost: x\r\n"));
+    TEST_ASSERT_EQUAL_size_t(2, feed(exchange, "\r\nGET"));
+    TEST_ASSERT_TRUE(exchange.is_found());
+
+    exchange.reset();
+    TEST_ASSERT_EQUAL_size_t(strlen("GET /metrics HTTP/1.0\nA: b\n\n"), feed(exchange, "GET /metrics HTTP/1.0\nA: b\n\nrest"));
+    TEST_ASSERT_TRUE(exchange.is_found());
+
+    // A request line without a version.
+    exchange.reset();
+    TEST_ASSERT_NOT_EQUAL(0, feed(exchange, "GET /metrics\r\n\r\n"));
+    TEST_ASSERT_TRUE(exchange.is_found());
+
+    // A single line break is not the end, nor is a lone carriage return
+    // pair.
+    exchange.reset();
+    TEST_ASSERT_EQUAL_size_t(0, feed(exchange, "GET /metrics HTTP/1.0\r\n\r\r"));
+    TEST_ASSERT_EQUAL_size_t(1, feed(exchange, "\n"));
+
+    // Long header lines are skipped over once the request line is known.
+    exchange.reset();
+    std::string request = "GET /metrics HTTP/1.0\r\nUser-Agent: ";
+    request.append(1000, 'x');
+    request += "\r\n\r\n";
+    TEST_ASSERT_EQUAL_size_t(request.size(), feed(exchange, request.c_str()));
+    TEST_ASSERT_TRUE(exchange.is_found());
+}
+
+void test_chunks_hold_whole_items() {
+    // Line lengths that do and don't divide the buffer, including one that
+    // fills it exactly.
+    for (const size_t line_length : {40, 64, 100, 128, 255}) {
+        FakeBody body;
+        body.items = {7, 1, 0, 20};
+        body.line_length = line_length;
+        HttpExchange exchange("/metrics", "text/plain; version=0.0.4", body, 4);
+        exchange.reset();
+        feed(exchange, "GET /metrics HTTP/1.0\r\n\r\n");
+
+        std::vector<size_t> chunks;
+        const std::string response = drain(exchange, chunks);
+        TEST_ASSERT_EQUAL_STRING((OK_HEADER + body.expected()).c_str(), response.c_str());
+
+        // Every chunk after the header ends on a line boundary and takes as
+        // many lines as fit.
+        size_t offset = 0;
+        for (size_t i = 0; i < chunks.size(); i++) {
+            offset += chunks[i];
+            TEST_ASSERT_EQUAL('\n', response[offset - 1]);
+            if (i + 1 < chunks.size()) {
+                TEST_ASSERT_GREATER_THAN(HttpExchange::BUFFER_SIZE, chunks[i] + line_length);
+            }
+        }
+        TEST_ASSERT_EQUAL_size_t(response.size(), offset);
+    }
+}
+
+void test_response_ends_when_done() {
+    FakeBody body;
+    body.items = {3, 3};
+    HttpExchange exchange("/metrics", "text/plain", body, 2);
+    exchange.reset();
+    feed(exchange, "GET /metrics HTTP/1.0\r\n\r\n");
+    std::vector<size_t> chunks;
+    drain(exchange, chunks);
+    TEST_ASSERT_EQUAL_size_t(1, chunks.size());
+
+    // Nothing more is generated, however often it is asked.
+    const size_t calls = body.calls;
+    for (int i = 0; i < 3; i++) TEST_ASSERT_EQUAL_size_t(0, exchange.fill());
+    TEST_ASSERT_EQUAL_size_t(calls, body.calls);
+
+    // The next connection starts over.
+    exchange.reset();
+    feed(exchange, "GET /nothing HTTP/1.0\r\n\r\n");
+    TEST_ASSERT_EQUAL_STRING(NOT_FOUND, drain(exchange, chunks).c_str());
+    exchange.reset();
+    feed(exchange, "GET /metrics HTTP/1.0\r\n\r\n");
+    TEST_ASSERT_EQUAL_size_t(1, chunks.size());
+    std::string response = drain(exchange, chunks);
+    TEST_ASSERT_EQUAL_size_t(strlen("HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n") + 6 * 40, response.size());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_metrics_path_is_served);
+    RUN_TEST(test_other_requests_get_404);
+    RUN_TEST(test_request_terminator);
+    RUN_TEST(test_chunks_hold_whole_items);
+    RUN_TEST(test_response_ends_when_done);
+    return UNITY_END();
+}
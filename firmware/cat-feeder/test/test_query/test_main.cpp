@@ -0,0 +1,238 @@
+#include <unity.h>
+#include <LittleFS.h>
+#include <memory>
+#include <vector>
+#include "query.h"
+
+using Type = WeightLog::Type;
+
+/**
+ * Time of the first record, on an hour boundary.
+ */
+static constexpr uint32_t START = 1700002800;
+static_assert(START % 3600 == 0, "start must be on an hour");
+
+/**
+ * A record as parsed back from a response.
+ */
+struct Row {
+    uint32_t time;
+    int type;
+    float grams;
+};
+
+/**
+ * A parsed response chunk.
+ */
+struct Chunk {
+    uint32_t id;
+    int seq;
+    std::vector<Row> rows;
+    bool done;
+    int n;
+    bool aborted;
+};
+
+static Chunk parse(const std::string &json) {
+    Chunk chunk = {};
+    TEST_ASSERT_EQUAL(2, sscanf(json.c_str(), "{\"id\":%u,\"seq\":%d", &chunk.id, &chunk.seq));
+    const char *p = strstr(json.c_str(), "\"r\":[") + 5;
+    while (*p == '[' || *p == ',') {
+        if (*p == ',') p++;
+        Row row = {};
+        int used = 0;
+        TEST_ASSERT_EQUAL(3, sscanf(p, "[%u,%d,%f]%n", &row.time, &row.type, &row.grams, &used));
+        chunk.rows.push_back(row);
+        p += used;
+    }
+    int done = 0;
+    TEST_ASSERT_EQUAL(1, sscanf(p, "],\"done\":%d", &done));
+    chunk.done = done;
+    const char *n = strstr(p, "\"n\":");
+    chunk.n = n ? atoi(n + 4) : -1;
+    chunk.aborted = strstr(p, "\"aborted\":1");
+    return chunk;
+}
+
+/**
+ * Test fixture: a log, a broker and the query on top.
+ */
+struct Fixture {
+    HAMqtt mqtt;
+    std::unique_ptr<WeightLog> log = std::make_unique<WeightLog>();
+    HistoryQuery query{mqtt, *log};
+    size_t consumed = 0;
+
+    void request(const char *text) {
+        TEST_ASSERT_TRUE(query.on_message(HistoryQuery::REQUEST_TOPIC, reinterpret_cast<const uint8_t *>(text), strlen(text)));
+    }
+
+    /**
+     * Polls until the response is complete, calling between() after every
+     * poll, and returns the chunks.
+     */
+    template <class F>
+    std::vector<Chunk> collect(F between) {
+        std::vector<Chunk> chunks;
+        for (int polls = 0; polls < 100000; polls++) {
+            query.poll();
+            between();
+            for (; consumed < mqtt.messages.size(); consumed++) {
+                const auto &message = mqtt.messages[consumed];
+                TEST_ASSERT_EQUAL_STRING(HistoryQuery::RESPONSE_TOPIC, message.topic.c_str());
+                TEST_ASSERT_LESS_OR_EQUAL(HistoryQuery::CHUNK_SIZE + 96, message.payload.size());
+                chunks.push_back(parse(message.payload));
+                if (chunks.back().done) return chunks;
+            }
+        }
+        TEST_FAIL_MESSAGE("query did not complete");
+        return chunks;
+    }
+
+    std::vector<Chunk> collect() {
+        return collect([] {});
+    }
+};
+
+static std::vector<Row> rows_of(const std::vector<Chunk> &chunks) {
+    std::vector<Row> rows;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        TEST_ASSERT_EQUAL(static_cast<int>(i), chunks[i].seq);
+        rows.insert(rows.end(), chunks[i].rows.begin(), chunks[i].rows.end());
+    }
+    return rows;
+}
+
+/**
+ * Grams of the i-th generated reservoir record.
+ */
+static float reservoir_grams(const uint32_t i) {
+    return 3000.0f - static_cast<float>(i % 500) * 0.7f;
+}
+
+void setUp() {
+    LittleFS.format();
+}
+
+void tearDown() {
+}
+
+void test_subscribes_on_connect() {
+    Fixture f;
+    f.query.on_connected();
+    TEST_ASSERT_EQUAL(1, f.mqtt.subscriptions.size());
+    TEST_ASSERT_EQUAL_STRING(HistoryQuery::REQUEST_TOPIC, f.mqtt.subscriptions[0].c_str());
+    const char other[] = "x";
+    TEST_ASSERT_FALSE(f.query.on_message("cat-feeder/other", reinterpret_cast<const uint8_t *>(other), 1));
+}
+
+void test_raw_records_in_chunks() {
+    Fixture f;
+    for (uint32_t i = 0; i < 2000; i++) {
+        f.log->append(Type::RESERVOIR, reservoir_grams(i), START + i * 300);
+    }
+    f.request("7 0 4294967295 0");
+    const auto chunks = f.collect();
+    TEST_ASSERT_GREATER_THAN(1, chunks.size());
+    TEST_ASSERT_EQUAL_UINT32(7, chunks[0].id);
+    TEST_ASSERT_EQUAL(2000, chunks.back().n);
+    TEST_ASSERT_FALSE(chunks.back().aborted);
+    TEST_ASSERT_EQUAL(0, f.mqtt.length_mismatches);
+    const auto rows = rows_of(chunks);
+    TEST_ASSERT_EQUAL(2000, rows.size());
+    for (uint32_t i = 0; i < rows.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(START + i * 300, rows[i].time);
+        TEST_ASSERT_EQUAL(0, rows[i].type);
+        TEST_ASSERT_FLOAT_WITHIN(0.051f, reservoir_grams(i), rows[i].grams);
+    }
+}
+
+void test_range_and_resolution() {
+    Fixture f;
+    for (uint32_t i = 0; i < 240; i++) {
+        f.log->append(Type::BOWL, static_cast<float>(i % 60), START + i * 60);
+    }
+    char request[64];
+    snprintf(request, sizeof(request), "1 %u %u 3600", START + 3600, START + 3 * 3600 - 1);
+    f.request(request);
+    const auto rows = rows_of(f.collect());
+    TEST_ASSERT_EQUAL(2, rows.size());
+    TEST_ASSERT_EQUAL_UINT32(START + 3600, rows[0].time);
+    TEST_ASSERT_EQUAL_UINT32(START + 7200, rows[1].time);
+    TEST_ASSERT_FLOAT_WITHIN(0.051f, 29.5f, rows[0].grams);
+    TEST_ASSERT_FLOAT_WITHIN(0.051f, 29.5f, rows[1].grams);
+}
+
+void test_appends_and_flushes_during_query() {
+    Fixture f;
+    for (uint32_t i = 0; i < 3000; i++) {
+        f.log->append(Type::RESERVOIR, reservoir_grams(i), START + i * 300);
+    }
+    f.request("2 0 4294967295 0");
+
+    // Keep appending between polls, enough to flush several blocks; the
+    // response covers exactly the log as it was at the request.
+    uint32_t i = 3000;
+    const auto chunks = f.collect([&] {
+        for (int k = 0; k < 40; k++, i++) {
+            f.log->append(Type::RESERVOIR, reservoir_grams(i), START + i * 300);
+        }
+    });
+    TEST_ASSERT_GREATER_THAN(3300, i);
+    TEST_ASSERT_FALSE(chunks.back().aborted);
+    const auto rows = rows_of(chunks);
+    TEST_ASSERT_EQUAL(3000, rows.size());
+    for (uint32_t r = 0; r < rows.size(); r++) {
+        TEST_ASSERT_EQUAL_UINT32(START + r * 300, rows[r].time);
+        TEST_ASSERT_FLOAT_WITHIN(0.051f, reservoir_grams(r), rows[r].grams);
+    }
+}
+
+void test_rotation_aborts_query() {
+    Fixture f;
+    uint32_t i = 0;
+
+    // Fill the current file up to just before it rotates.
+    while (LittleFS.contents("/wlog.bin").size() < (WeightLog::MAX_FILE_BLOCKS - 1) * WeightLog::BLOCK_SIZE) {
+        f.log->append(Type::RESERVOIR, reservoir_grams(i), START + i * 300);
+        i++;
+    }
+    f.request("3 0 4294967295 0");
+    const auto chunks = f.collect([&] {
+        for (int k = 0; k < 200; k++, i++) {
+            f.log->append(Type::RESERVOIR, reservoir_grams(i), START + i * 300);
+        }
+    });
+    TEST_ASSERT_TRUE(chunks.back().aborted);
+    const auto rows = rows_of(chunks);
+    TEST_ASSERT_EQUAL(chunks.back().n, static_cast<int>(rows.size()));
+    for (uint32_t r = 0; r < rows.size(); r++) {
+        TEST_ASSERT_EQUAL_UINT32(START + r * 300, rows[r].time);
+    }
+}
+
+void test_disconnect_drops_query() {
+    Fixture f;
+    for (uint32_t i = 0; i < 2000; i++) {
+        f.log->append(Type::RESERVOIR, reservoir_grams(i), START + i * 300);
+    }
+    f.request("4 0 4294967295 0");
+    f.query.poll();
+    const size_t published = f.mqtt.messages.size();
+    f.mqtt.connected = false;
+    f.query.poll();
+    f.mqtt.connected = true;
+    for (int k = 0; k < 100; k++) f.query.poll();
+    TEST_ASSERT_EQUAL(published, f.mqtt.messages.size());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_subscribes_on_connect);
+    RUN_TEST(test_raw_records_in_chunks);
+    RUN_TEST(test_range_and_resolution);
+    RUN_TEST(test_appends_and_flushes_during_query);
+    RUN_TEST(test_rotation_aborts_query);
+    RUN_TEST(test_disconnect_drops_query);
+    return UNITY_END();
+}
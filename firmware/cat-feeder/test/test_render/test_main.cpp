@@ -0,0 +1,259 @@
+#include <unity.h>
+#include <memory>
+#include "arc.h"
+#include "blit.h"
+#include "recorder.h"
+#include "theme.h"
+
+/**
+ * Display size.
+ */
+static constexpr int16_t SIZE = 240;
+
+/**
+ * Returns the FNV-1a hash of an image.
+ */
+static uint32_t image_hash(GFXcanvas16 &canvas) {
+    const uint16_t *pixels = canvas.getBuffer();
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < static_cast<size_t>(canvas.width()) * canvas.height(); i++) {
+        h = (h ^ (pixels[i] & 0xFF)) * 16777619u;
+        h = (h ^ (pixels[i] >> 8)) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Returns the number of pixels of the given color.
+ */
+static size_t count_color(GFXcanvas16 &canvas, const uint16_t color) {
+    const uint16_t *pixels = canvas.getBuffer();
+    return static_cast<size_t>(std::count(pixels, pixels + static_cast<size_t>(canvas.width()) * canvas.height(), color));
+}
+
+/**
+ * Returns whether two images are equal.
+ */
+static bool same_image(GFXcanvas16 &a, GFXcanvas16 &b) {
+    return !memcmp(a.getBuffer(), b.getBuffer(), static_cast<size_t>(a.width()) * a.height() * sizeof(uint16_t));
+}
+
+/**
+ * A line canvas with a different color in every pixel.
+ */
+static std::unique_ptr<GFXcanvas16> pattern(const int16_t w, const int16_t h) {
+    auto canvas = std::make_unique<GFXcanvas16>(w, h);
+    for (int16_t y = 0; y < h; y++) {
+        for (int16_t x = 0; x < w; x++) canvas->drawPixel(x, y, static_cast<uint16_t>(y * w + x + 1));
+    }
+    return canvas;
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_canvas_blit_places_and_clips() {
+    GFXcanvas16 screen(8, 6);
+    CanvasBlit blit(screen);
+    const auto block = pattern(3, 2);
+    blit.blit(2, 1, 3, 2, block->getBuffer());
+    TEST_ASSERT_EQUAL_UINT16(0, screen.getPixel(1, 1));
+    TEST_ASSERT_EQUAL_UINT16(1, screen.getPixel(2, 1));
+    TEST_ASSERT_EQUAL_UINT16(3, screen.getPixel(4, 1));
+    TEST_ASSERT_EQUAL_UINT16(4, screen.getPixel(2, 2));
+    TEST_ASSERT_EQUAL_UINT16(6, screen.getPixel(4, 2));
+    TEST_ASSERT_EQUAL_UINT16(0, screen.getPixel(5, 2));
+    TEST_ASSERT_EQUAL_size_t(6, 48 - count_color(screen, 0));
+
+    // Partly off the top left and bottom right corners.
+    blit.blit(-1, -1, 3, 2, block->getBuffer());
+    TEST_ASSERT_EQUAL_UINT16(5, screen.getPixel(0, 0));
+    TEST_ASSERT_EQUAL_UINT16(6, screen.getPixel(1, 0));
+    blit.blit(7, 5, 3, 2, block->getBuffer());
+    TEST_ASSERT_EQUAL_UINT16(1, screen.getPixel(7, 5));
+}
+
+void test_panel_blit_matches_canvas() {
+    const auto lines = pattern(SIZE, 32);
+    auto panel = std::make_unique<Adafruit_SPITFT>(SIZE, SIZE);
+    PanelBlit panel_blit(*panel);
+    auto screen = std::make_unique<GFXcanvas16>(SIZE, SIZE);
+    CanvasBlit canvas_blit(*screen);
+
+    panel_blit.blit(0, 68, SIZE, 32, lines->getBuffer());
+    canvas_blit.blit(0, 68, SIZE, 32, lines->getBuffer());
+    TEST_ASSERT_EQUAL_UINT32(1, panel->transactions);
+    TEST_ASSERT_EQUAL_UINT32(1, panel->windows);
+    TEST_ASSERT_TRUE(same_image(panel->memory, *screen));
+}
+
+void test_recorder_counts_and_forwards_blits() {
+    const auto lines = pattern(SIZE, 24);
+    auto screen = std::make_unique<GFXcanvas16>(SIZE, SIZE);
+    CanvasBlit canvas_blit(*screen);
+    RenderRecorder recorder(*screen, canvas_blit, 40000000);
+    recorder.blit(0, 156, SIZE, 24, lines->getBuffer());
+
+    const auto &stats = recorder.get_stats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.calls);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.transactions);
+    TEST_ASSERT_EQUAL_UINT32(SIZE * 24, stats.pixels);
+    TEST_ASSERT_EQUAL_UINT32(11 + SIZE * 24 * 2, stats.spi_bytes);
+    TEST_ASSERT_EQUAL_UINT16(1, screen->getPixel(0, 156));
+    TEST_ASSERT_EQUAL_UINT16(SIZE * 24, screen->getPixel(SIZE - 1, 179));
+}
+
+void test_palettes_show_the_arc() {
+    for (const Palette &p : PALETTES) {
+        TEST_ASSERT_NOT_EQUAL(0, p.arc);
+        TEST_ASSERT_NOT_EQUAL(0, p.track);
+        TEST_ASSERT_NOT_EQUAL(p.arc, p.track);
+    }
+}
+
+void test_arc_begin_clears_its_area() {
+    auto screen = std::make_unique<GFXcanvas16>(SIZE, SIZE);
+    screen->fillScreen(0xFFFF);
+    ProgressArc arc;
+    arc.begin(*screen);
+    TEST_ASSERT_EQUAL_UINT16(0, screen->getPixel(120, 4));
+    TEST_ASSERT_EQUAL_UINT16(0, screen->getPixel(20, 61));
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, screen->getPixel(120, 62));
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, screen->getPixel(120, 3));
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, screen->getPixel(3, 30));
+}
+
+/**
+ * Golden images of the arc on an otherwise black screen: hash and number of
+ * fill and track pixels. Regenerate only for intended geometry changes.
+ */
+void test_arc_golden_images() {
+    static constexpr struct {
+        int16_t progress;
+        uint32_t hash;
+        size_t fill;
+        size_t track;
+    } GOLDEN[] = {
+        {0, 0xc8da6539, 0, 3081},
+        {1, 0xc8da6539, 0, 3081},
+        {500, 0xb6937299, 1518, 1563},
+        {999, 0xa2f164d0, 3029, 52},
+        {1000, 0x48dc0578, 3081, 0},
+    };
+    const Palette &p = palette(PaletteId::OPERATIONAL);
+    for (const auto &golden : GOLDEN) {
+        auto screen = std::make_unique<GFXcanvas16>(SIZE, SIZE);
+        ProgressArc arc;
+        arc.begin(*screen);
+        arc.update(*screen, golden.progress, p.arc, p.track);
+        TEST_ASSERT_EQUAL_HEX32(golden.hash, image_hash(*screen));
+        TEST_ASSERT_EQUAL_size_t(golden.fill, count_color(*screen, p.arc));
+        TEST_ASSERT_EQUAL_size_t(golden.track, count_color(*screen, p.track));
+    }
+}
+
+void test_arc_incremental_matches_full_redraw() {
+    const Palette &p = palette(PaletteId::MAINTENANCE);
+    auto incremental = std::make_unique<GFXcanvas16>(SIZE, SIZE);
+    ProgressArc arc;
+    arc.begin(*incremental);
+    size_t previous_fill = 0;
+    for (int16_t progress = 0; progress <= 1000; progress += 37) {
+        arc.update(*incremental, progress, p.arc, p.track);
+        auto full = std::make_unique<GFXcanvas16>(SIZE, SIZE);
+        ProgressArc fresh;
+        fresh.begin(*full);
+        fresh.update(*full, progress, p.arc, p.track);
+        TEST_ASSERT_TRUE(same_image(*incremental, *full));
+        const size_t fill = count_color(*incremental, p.arc);
+        TEST_ASSERT_GREATER_OR_EQUAL(previous_fill, fill);
+        previous_fill = fill;
+    }
+}
+
+/**
+ * Pushes the arc from empty to full one progress unit at a time through the
+ * recorder and reports pixels written per step, against a full redraw.
+ */
+void test_arc_pixels_per_progress_step() {
+    const Palette &p = palette(PaletteId::OPERATIONAL);
+    auto screen = std::make_unique<GFXcanvas16>(SIZE, SIZE);
+    CanvasBlit canvas_blit(*screen);
+    RenderRecorder recorder(*screen, canvas_blit);
+
+    ProgressArc full;
+    full.begin(recorder);
+    recorder.reset();
+    full.update(recorder, 1000, p.arc, p.track);
+    const uint32_t full_redraw = recorder.get_stats().pixels;
+
+    ProgressArc arc;
+    arc.begin(recorder);
+    arc.update(recorder, 0, p.arc, p.track);
+    uint32_t total = 0;
+    uint32_t worst = 0;
+    uint32_t changed = 0;
+    for (int16_t progress = 1; progress <= 1000; progress++) {
+        recorder.reset();
+        arc.update(recorder, progress, p.arc, p.track);
+        const uint32_t pixels = recorder.get_stats().pixels;
+        total += pixels;
+        worst = std::max(worst, pixels);
+        if (pixels) changed++;
+    }
+
+    char message[128];
+    snprintf(message, sizeof(message), "full redraw %u px, per step max %u px, mean %.2f px, %u of 1000 steps drew",
+             static_cast<unsigned>(full_redraw), static_cast<unsigned>(worst), total / 1000.0, static_cast<unsigned>(changed));
+    TEST_MESSAGE(message);
+
+    // Each step covers at most one of the 55 segments, and the sweep as a
+    // whole costs about one full redraw rather than one per step.
+    TEST_ASSERT_EQUAL_UINT32(55, changed);
+    TEST_ASSERT_LESS_OR_EQUAL(2 * full_redraw / 55, worst);
+    TEST_ASSERT_LESS_OR_EQUAL(full_redraw / 20, worst);
+    TEST_ASSERT_LESS_OR_EQUAL(full_redraw, total);
+}
+
+void test_arc_hide_leaves_no_ghost() {
+    const Palette &p = palette(PaletteId::WARNING);
+    auto screen = std::make_unique<GFXcanvas16>(SIZE, SIZE);
+    ProgressArc arc;
+    arc.begin(*screen);
+    arc.update(*screen, 600, p.arc, p.track);
+    TEST_ASSERT_GREATER_THAN(0, count_color(*screen, p.arc));
+    TEST_ASSERT_GREATER_THAN(0, count_color(*screen, p.track));
+    arc.update(*screen, -1, p.arc, p.track);
+    TEST_ASSERT_EQUAL_size_t(static_cast<size_t>(SIZE) * SIZE, count_color(*screen, 0));
+}
+
+void test_arc_color_change_redraws() {
+    const Palette &before = palette(PaletteId::OPERATIONAL);
+    const Palette &after = palette(PaletteId::ERROR);
+    auto screen = std::make_unique<GFXcanvas16>(SIZE, SIZE);
+    ProgressArc arc;
+    arc.begin(*screen);
+    arc.update(*screen, 400, before.arc, before.track);
+    arc.update(*screen, 400, after.arc, after.track);
+    TEST_ASSERT_EQUAL_size_t(0, count_color(*screen, before.arc));
+    TEST_ASSERT_EQUAL_size_t(0, count_color(*screen, before.track));
+    TEST_ASSERT_GREATER_THAN(0, count_color(*screen, after.arc));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_canvas_blit_places_and_clips);
+    RUN_TEST(test_panel_blit_matches_canvas);
+    RUN_TEST(test_recorder_counts_and_forwards_blits);
+    RUN_TEST(test_palettes_show_the_arc);
+    RUN_TEST(test_arc_begin_clears_its_area);
+    RUN_TEST(test_arc_golden_images);
+    RUN_TEST(test_arc_incremental_matches_full_redraw);
+    RUN_TEST(test_arc_pixels_per_progress_step);
+    RUN_TEST(test_arc_hide_leaves_no_ghost);
+    RUN_TEST(test_arc_color_change_redraws);
+    return UNITY_END();
+}
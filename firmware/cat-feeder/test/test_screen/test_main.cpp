@@ -0,0 +1,219 @@
+#include <unity.h>
+#include <WiFi.h>
+#include <cstdio>
+#include <memory>
+#include "blit.h"
+#include "recorder.h"
+#include "screen.h"
+
+/**
+ * Display size.
+ */
+static constexpr int16_t SIZE = 240;
+
+/**
+ * Screen drawing into an in-memory panel through a render recorder, wired
+ * like the device with DEBUG_UI_RECORD defined.
+ */
+struct Display {
+    GFXcanvas16 panel{SIZE, SIZE};
+    CanvasBlit panel_blit{panel};
+    RenderRecorder recorder{panel, panel_blit, 40000000};
+    Screen screen{recorder, recorder};
+};
+
+/**
+ * Returns the FNV-1a hash of an image.
+ */
+static uint32_t image_hash(GFXcanvas16 &canvas) {
+    const uint16_t *pixels = canvas.getBuffer();
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < static_cast<size_t>(canvas.width()) * canvas.height(); i++) {
+        h = (h ^ (pixels[i] & 0xFF)) * 16777619u;
+        h = (h ^ (pixels[i] >> 8)) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Returns whether two images are equal.
+ */
+static bool same_image(GFXcanvas16 &a, GFXcanvas16 &b) {
+    return !memcmp(a.getBuffer(), b.getBuffer(), static_cast<size_t>(a.width()) * a.height() * sizeof(uint16_t));
+}
+
+/**
+ * Returns a snapshot of an idle, connected feeder showing the given state.
+ */
+static Screen::Snapshot snapshot(const Text header, const char *detail1, const char *detail2, const bool large, const int16_t progress = -1) {
+    Screen::Snapshot s = {};
+    if (header != Text::COUNT) strcpy(s.state_report.header, text(header));
+    strcpy(s.state_report.detail1, detail1);
+    strcpy(s.state_report.detail2, detail2);
+    s.state_report.large = large;
+    s.state_report.progress = progress;
+    s.feed_report = {FeedResult::SUCCESS, 24500, millis() - 754000};
+    s.error_report = {ErrorCode::NONE, ErrorSeverity::OKAY};
+    s.wifi_status = WL_CONNECTED;
+    s.mqtt_state = HAMqtt::StateConnected;
+    const uint8_t ip[4] = {192, 168, 1, 42};
+    memcpy(s.ip, ip, sizeof(ip));
+    return s;
+}
+
+/**
+ * Renders one complete frame.
+ */
+static void render_frame(Screen &screen, const Screen::Snapshot &s) {
+    while (!screen.update(s)) {
+    }
+}
+
+/**
+ * Reports the recorder statistics of a frame.
+ */
+static void report(const char *name, const Display &display, const uint32_t hash) {
+    const auto &stats = display.recorder.get_stats();
+    char message[160];
+    snprintf(message, sizeof(message), "%s: 0x%08lx, %lu calls, %lu transactions, %lu pixels, ~%luus SPI", name,
+        static_cast<unsigned long>(hash), static_cast<unsigned long>(stats.calls), static_cast<unsigned long>(stats.transactions),
+        static_cast<unsigned long>(stats.pixels), static_cast<unsigned long>(display.recorder.get_spi_micros()));
+    TEST_MESSAGE(message);
+}
+
+void setUp() {
+    // Fixed clock, so the feed report age and the error blink phase are
+    // the same on every run.
+    host_micros = 3600000000ull;
+}
+
+void tearDown() {
+}
+
+/**
+ * Golden first frames after boot, one for each kind of state report and a
+ * few status lines, with the recorder statistics of each frame. Regenerate
+ * only for intended changes to the layout, the palettes or the texts.
+ */
+void test_golden_frames() {
+    struct Golden {
+        const char *name;
+        Screen::Snapshot snapshot;
+        uint32_t hash;
+    };
+    Golden goldens[] = {
+        {"feeding 0%", snapshot(Text::FEEDING, "0%", "", true, 0), 0x58bc28e9},
+        {"feeding 45%", snapshot(Text::FEEDING, "45%", "", true, 450), 0x37c88951},
+        {"feeding 100%", snapshot(Text::FEEDING, "100%", "", true, 1000), 0x6aa93448},
+        {"feed result", snapshot(Text::FEED_RESULT, "R  812.4g  -24.6g", "B    0.3g  +24.5g", false), 0xc0136d05},
+        {"maintenance", snapshot(Text::MAINTENANCE, "  812.4g +/-  0.3g", "    0.3g +/-  0.1g", false), 0x21878555},
+        {"jammed", snapshot(Text::COUNT, text(Text::JAMMED), "", true), 0x7daa2135},
+        {"cooldown", snapshot(Text::COOLDOWN, "12:34", "", true), 0x42c130f5},
+        {"deficit", snapshot(Text::DEFICIT, "1500mg", "", true), 0x121a70b5},
+        {"tare reservoir", snapshot(Text::TARE_RESERVOIR, "    0.1g +/-  0.2g", "    0.3g +/-  0.1g", false), 0x3431dd45},
+        {"tare bowl", snapshot(Text::TARE_BOWL, "  812.4g +/-  0.3g", "    0.0g +/-  0.1g", false), 0x627c0bf5},
+        {"wifi lost", snapshot(Text::FEEDING, "0%", "", true, 0), 0x44fc4299},
+        {"mqtt connecting", snapshot(Text::FEEDING, "0%", "", true, 0), 0xcde8a399},
+        {"warning", snapshot(Text::FEEDING, "0%", "", true, 0), 0xf52aa48f},
+        {"error", snapshot(Text::COUNT, text(Text::JAMMED), "", true), 0xf776d0c5},
+    };
+    goldens[3].snapshot.feed_report.millis = millis() - 5000;
+    goldens[4].snapshot.maintenance = true;
+    goldens[8].snapshot.maintenance = true;
+    goldens[9].snapshot.maintenance = true;
+    goldens[10].snapshot.wifi_status = WL_CONNECTION_LOST;
+    goldens[11].snapshot.mqtt_state = HAMqtt::StateConnecting;
+    goldens[12].snapshot.error_report = {ErrorCode::REFILL_SOON, ErrorSeverity::WARNING};
+    goldens[13].snapshot.error_report = {ErrorCode::JAMMED, ErrorSeverity::ERROR};
+
+    for (const auto &golden : goldens) {
+        auto display = std::make_unique<Display>();
+        display->screen.begin();
+        display->recorder.reset();
+        render_frame(display->screen, golden.snapshot);
+        const uint32_t hash = image_hash(display->panel);
+        report(golden.name, *display, hash);
+        TEST_ASSERT_EQUAL_HEX32_MESSAGE(golden.hash, hash, golden.name);
+    }
+}
+
+void test_frame_sequence_matches_fresh_render() {
+    const Screen::Snapshot sequence[] = {
+        snapshot(Text::FEEDING, "0%", "", true, 0),
+        snapshot(Text::FEEDING, "45%", "", true, 450),
+        snapshot(Text::FEED_RESULT, "R  812.4g  -24.6g", "B    0.3g  +24.5g", false),
+        snapshot(Text::COUNT, text(Text::JAMMED), "", true),
+        snapshot(Text::FEEDING, "100%", "", true, 1000),
+    };
+    auto incremental = std::make_unique<Display>();
+    incremental->screen.begin();
+    for (const auto &s : sequence) {
+        render_frame(incremental->screen, s);
+        auto fresh = std::make_unique<Display>();
+        fresh->screen.begin();
+        render_frame(fresh->screen, s);
+        TEST_ASSERT_TRUE(same_image(incremental->panel, fresh->panel));
+    }
+}
+
+void test_clear_goes_through_recorder() {
+    auto display = std::make_unique<Display>();
+    display->screen.begin();
+    render_frame(display->screen, snapshot(Text::FEEDING, "45%", "", true, 450));
+    display->recorder.reset();
+    display->screen.clear(false);
+    const auto &stats = display->recorder.get_stats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.calls);
+    TEST_ASSERT_EQUAL_UINT32(static_cast<uint32_t>(SIZE) * SIZE, stats.pixels);
+    auto blank = std::make_unique<GFXcanvas16>(SIZE, SIZE);
+    TEST_ASSERT_TRUE(same_image(*blank, display->panel));
+
+    // The next frame redraws everything, arc included.
+    render_frame(display->screen, snapshot(Text::FEEDING, "45%", "", true, 450));
+    auto fresh = std::make_unique<Display>();
+    fresh->screen.begin();
+    render_frame(fresh->screen, snapshot(Text::FEEDING, "45%", "", true, 450));
+    TEST_ASSERT_TRUE(same_image(fresh->panel, display->panel));
+}
+
+void test_diagnostics_redraws_changed_lines() {
+    Screen::DiagnosticsSnapshot d = {};
+    d.loop_p99_micros = 412;
+    d.sample_rate_decihertz[0] = 800;
+    d.sample_rate_decihertz[1] = 799;
+    d.mqtt_publishes = 1234;
+    d.mqtt_connects = 1;
+    d.free_heap = 180 * 1024;
+    d.stack_used[0] = 1960;
+    d.stack_used[1] = 1288;
+
+    auto display = std::make_unique<Display>();
+    display->screen.begin();
+    display->screen.clear(true);
+    display->recorder.reset();
+    display->screen.update_diagnostics(d);
+    const uint32_t hash = image_hash(display->panel);
+    report("diagnostics", *display, hash);
+    TEST_ASSERT_EQUAL_HEX32(0xa92972bd, hash);
+    TEST_ASSERT_EQUAL_UINT32(9u * SIZE * 16, display->recorder.get_stats().pixels);
+
+    // Unchanged lines aren't pushed again.
+    display->recorder.reset();
+    display->screen.update_diagnostics(d);
+    TEST_ASSERT_EQUAL_UINT32(0, display->recorder.get_stats().pixels);
+
+    d.mqtt_publishes++;
+    display->recorder.reset();
+    display->screen.update_diagnostics(d);
+    TEST_ASSERT_EQUAL_UINT32(1, display->recorder.get_stats().calls);
+    TEST_ASSERT_EQUAL_UINT32(static_cast<uint32_t>(SIZE) * 16, display->recorder.get_stats().pixels);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_golden_frames);
+    RUN_TEST(test_frame_sequence_matches_fresh_render);
+    RUN_TEST(test_clear_goes_through_recorder);
+    RUN_TEST(test_diagnostics_redraws_changed_lines);
+    return UNITY_END();
+}
@@ -0,0 +1,170 @@
+#include <unity.h>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include "statistics.h"
+
+/**
+ * HX711 samples are signed 24-bit values.
+ */
+static constexpr int32_t SAMPLE_MAX = (1 << 23) - 1;
+static constexpr int32_t SAMPLE_MIN = -(1 << 23);
+
+/**
+ * The generic statistics the loadcell driver used before MeanVariance,
+ * dividing by a runtime window size.
+ */
+static void generic(const int32_t *samples, const size_t count, int32_t &mean, float &variance) {
+    int64_t accum = static_cast<int64_t>(count / 2);
+    for (size_t i = 0; i < count; i++) {
+        accum += samples[i];
+    }
+    mean = static_cast<int32_t>(accum / static_cast<int64_t>(count));
+
+    accum = static_cast<int64_t>(count / 2);
+    for (size_t i = 0; i < count; i++) {
+        const int64_t diff = samples[i] - mean;
+        accum += diff * diff;
+    }
+    variance = static_cast<float>(accum) / static_cast<float>(count);
+}
+
+/**
+ * Checks MeanVariance against a double-precision reference and the generic
+ * code on random windows around the given level.
+ */
+template<uint8_t WINDOW_LOG2>
+static void check_random(std::mt19937 &rng, const int32_t level, const int32_t spread) {
+    constexpr size_t WINDOW = size_t(1) << WINDOW_LOG2;
+    std::uniform_int_distribution<int32_t> noise(-spread, spread);
+    int32_t samples[WINDOW];
+    for (int round = 0; round < 2000; round++) {
+        double sum = 0.0;
+        for (auto &sample : samples) {
+            sample = std::min(SAMPLE_MAX, std::max(SAMPLE_MIN, level + noise(rng)));
+            sum += sample;
+        }
+        int32_t mean = 0;
+        float variance = 0.0f;
+        MeanVariance::compute<WINDOW_LOG2>(samples, mean, variance);
+
+        // The mean rounds halves up.
+        const double exact_mean = sum / static_cast<double>(WINDOW);
+        TEST_ASSERT_EQUAL_INT32(static_cast<int32_t>(std::floor(exact_mean + 0.5)), mean);
+
+        double squares = 0.0;
+        for (const auto sample : samples) {
+            squares += (sample - exact_mean) * (sample - exact_mean);
+        }
+        const double exact_variance = squares / static_cast<double>(WINDOW);
+        // Centering on the rounded mean adds at most 0.25.
+        TEST_ASSERT_FLOAT_WITHIN(static_cast<float>(exact_variance * 1e-6 + 0.25), static_cast<float>(exact_variance), variance);
+
+        int32_t generic_mean = 0;
+        float generic_variance = 0.0f;
+        generic(samples, WINDOW, generic_mean, generic_variance);
+        if (sum >= 0.0) {
+            TEST_ASSERT_EQUAL_INT32(generic_mean, mean);
+        } else {
+            // The generic code truncated negative means toward zero.
+            TEST_ASSERT_INT32_WITHIN(1, generic_mean, mean);
+        }
+        if (generic_mean == mean) {
+            // The generic code rounded the sum of squares, adding up to 0.5.
+            TEST_ASSERT_FLOAT_WITHIN(static_cast<float>(exact_variance * 1e-6 + 0.5), generic_variance, variance);
+        }
+    }
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_constant_window() {
+    int32_t samples[32];
+    for (auto &sample : samples) sample = -12345;
+    int32_t mean = 0;
+    float variance = -1.0f;
+    MeanVariance::compute<5>(samples, mean, variance);
+    TEST_ASSERT_EQUAL_INT32(-12345, mean);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, variance);
+}
+
+void test_rounding_of_halves() {
+    int32_t samples[2] = {0, 1};
+    int32_t mean = 0;
+    float variance = 0.0f;
+    MeanVariance::compute<1>(samples, mean, variance);
+    TEST_ASSERT_EQUAL_INT32(1, mean);
+    TEST_ASSERT_EQUAL_FLOAT(0.5f, variance);
+
+    // Negative halves round up as well, where the generic code rounded
+    // toward zero.
+    samples[0] = -3;
+    samples[1] = -2;
+    MeanVariance::compute<1>(samples, mean, variance);
+    TEST_ASSERT_EQUAL_INT32(-2, mean);
+}
+
+void test_full_scale() {
+    int32_t samples[32];
+    for (size_t i = 0; i < 32; i++) samples[i] = i % 2 ? SAMPLE_MAX : SAMPLE_MIN;
+    int32_t mean = 0;
+    float variance = 0.0f;
+    MeanVariance::compute<5>(samples, mean, variance);
+    TEST_ASSERT_EQUAL_INT32(0, mean);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f * 7.0e13f, 70368735789056.5f, variance);
+}
+
+void test_random_windows_match_reference() {
+    std::mt19937 rng(75);
+    check_random<5>(rng, 0, 200);
+    check_random<5>(rng, 4000000, 3000);
+    check_random<5>(rng, -4000000, 3000);
+    check_random<5>(rng, 0, SAMPLE_MAX);
+    check_random<3>(rng, 100000, 50);
+    check_random<3>(rng, -100000, 50);
+}
+
+void test_speed_against_generic() {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int32_t> noise(-5000, 5000);
+    static int32_t windows[1000][32];
+    for (auto &window : windows) {
+        for (auto &sample : window) sample = 1000000 + noise(rng);
+    }
+    int64_t check = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &window : windows) {
+        int32_t mean = 0;
+        float variance = 0.0f;
+        MeanVariance::compute<5>(window, mean, variance);
+        check += mean + static_cast<int64_t>(variance);
+    }
+    const auto middle = std::chrono::steady_clock::now();
+    volatile size_t count = 32;
+    for (const auto &window : windows) {
+        int32_t mean = 0;
+        float variance = 0.0f;
+        generic(window, count, mean, variance);
+        check -= mean + static_cast<int64_t>(variance);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const auto ns = [](auto d) { return static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()); };
+    char message[96];
+    snprintf(message, sizeof(message), "1000 windows: policy %lld ns, generic %lld ns", ns(middle - start), ns(end - middle));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_INT32_WITHIN(1000, 0, static_cast<int32_t>(check));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_constant_window);
+    RUN_TEST(test_rounding_of_halves);
+    RUN_TEST(test_full_scale);
+    RUN_TEST(test_random_windows_match_reference);
+    RUN_TEST(test_speed_against_generic);
+    return UNITY_END();
+}
@@ -0,0 +1,204 @@
+#include <unity.h>
+#include <cstring>
+#include <vector>
+#include "datagrams.h"
+
+/**
+ * Datagram size of the firmware with telemetry enabled.
+ */
+static constexpr size_t DATAGRAM_SIZE = 1400;
+
+/**
+ * Records that fit one datagram.
+ */
+static constexpr size_t CAPACITY = (DATAGRAM_SIZE - TelemetryBuffer::HEADER_SIZE) / TelemetryBuffer::RECORD_SIZE;
+
+/**
+ * Decoded header, as struct.Struct('<2sBBHH') in tools/telemetry_receiver.py.
+ */
+struct Header {
+    char magic[2];
+    uint8_t version;
+    uint8_t count;
+    uint16_t sequence;
+    uint16_t dropped;
+};
+
+/**
+ * Decoded record, as struct.Struct('<IBBi') in tools/telemetry_receiver.py.
+ */
+struct Record {
+    uint32_t micros;
+    uint8_t event;
+    uint8_t arg;
+    int32_t value;
+};
+
+static_assert(TelemetryBuffer::HEADER_SIZE == 2 + 1 + 1 + 2 + 2, "header layout differs from the receiver");
+static_assert(TelemetryBuffer::RECORD_SIZE == 4 + 1 + 1 + 4, "record layout differs from the receiver");
+
+/**
+ * Little endian field readers.
+ */
+static uint16_t u16(const uint8_t *p) {
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+static uint32_t u32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+/**
+ * Decodes a datagram the way the receiver does, checking that its length
+ * matches the record count.
+ */
+static Header decode(const TelemetryBuffer::Datagram &datagram, std::vector<Record> &records) {
+    TEST_ASSERT_NOT_NULL(datagram.data);
+    TEST_ASSERT_GREATER_OR_EQUAL(TelemetryBuffer::HEADER_SIZE, datagram.length);
+    const uint8_t *p = datagram.data;
+    const Header header = {{static_cast<char>(p[0]), static_cast<char>(p[1])}, p[2], p[3], u16(p + 4), u16(p + 6)};
+    TEST_ASSERT_EQUAL_size_t(TelemetryBuffer::HEADER_SIZE + header.count * TelemetryBuffer::RECORD_SIZE, datagram.length);
+    records.clear();
+    for (size_t i = 0; i < header.count; i++) {
+        const uint8_t *r = p + TelemetryBuffer::HEADER_SIZE + i * TelemetryBuffer::RECORD_SIZE;
+        records.push_back({u32(r), r[4], r[5], static_cast<int32_t>(u32(r + 6))});
+    }
+    return header;
+}
+
+/**
+ * Value of the i-th appended event, negative for every other one to cover
+ * the sign.
+ */
+static int32_t value_of(const uint32_t i) {
+    return i % 2 ? -static_cast<int32_t>(i * 1000) : static_cast<int32_t>(i * 1000);
+}
+
+/**
+ * Appends events i in [from, to), with the timestamp and argument derived
+ * from i.
+ */
+static void append_range(TelemetryBuffer &buffer, const uint32_t from, const uint32_t to) {
+    for (uint32_t i = from; i < to; i++) {
+        buffer.append(TelemetryEvent::SAMPLE, static_cast<uint8_t>(i), value_of(i), 0xF0000000u + i);
+    }
+}
+
+/**
+ * Checks that a datagram holds events [from, from + count) in order.
+ */
+static void check_records(const std::vector<Record> &records, const uint32_t from, const size_t count) {
+    TEST_ASSERT_EQUAL_size_t(count, records.size());
+    for (size_t k = 0; k < count; k++) {
+        const uint32_t i = from + k;
+        TEST_ASSERT_EQUAL_UINT32(0xF0000000u + i, records[k].micros);
+        TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(TelemetryEvent::SAMPLE), records[k].event);
+        TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(i), records[k].arg);
+        TEST_ASSERT_EQUAL_INT32(value_of(i), records[k].value);
+    }
+}
+
+/**
+ * Storage of the buffer under test.
+ */
+static uint8_t storage[2][DATAGRAM_SIZE];
+
+void setUp() {
+    memset(storage, 0xAA, sizeof(storage));
+}
+
+void tearDown() {
+}
+
+void test_nothing_sealed_until_full() {
+    TelemetryBuffer buffer(storage[0], DATAGRAM_SIZE);
+    TEST_ASSERT_FALSE(buffer.seal());
+    append_range(buffer, 0, CAPACITY);
+    TEST_ASSERT_EQUAL_size_t(0, buffer.sealed().length);
+}
+
+void test_fill_past_one_datagram() {
+    TelemetryBuffer buffer(storage[0], DATAGRAM_SIZE);
+    append_range(buffer, 0, CAPACITY + 1);
+
+    std::vector<Record> records;
+    const Header header = decode(buffer.sealed(), records);
+    TEST_ASSERT_EQUAL_MEMORY("CF", header.magic, 2);
+    TEST_ASSERT_EQUAL_UINT8(TelemetryBuffer::VERSION, header.version);
+    TEST_ASSERT_EQUAL_UINT8(CAPACITY, header.count);
+    TEST_ASSERT_EQUAL_UINT16(0, header.sequence);
+    TEST_ASSERT_EQUAL_UINT16(0, header.dropped);
+    check_records(records, 0, CAPACITY);
+    buffer.release();
+    TEST_ASSERT_EQUAL_size_t(0, buffer.sealed().length);
+
+    // The overflowing event started the second datagram.
+    TEST_ASSERT_TRUE(buffer.seal());
+    const Header second = decode(buffer.sealed(), records);
+    TEST_ASSERT_EQUAL_UINT16(1, second.sequence);
+    check_records(records, CAPACITY, 1);
+}
+
+void test_partial_datagram_at_cadence() {
+    TelemetryBuffer buffer(storage[0], DATAGRAM_SIZE);
+    append_range(buffer, 0, 3);
+    TEST_ASSERT_TRUE(buffer.seal());
+
+    // Nothing more to seal, and the sealed one stays put until released.
+    TEST_ASSERT_FALSE(buffer.seal());
+    std::vector<Record> records;
+    const Header header = decode(buffer.sealed(), records);
+    TEST_ASSERT_EQUAL_UINT8(3, header.count);
+    check_records(records, 0, 3);
+}
+
+void test_drop_when_both_buffers_ready() {
+    TelemetryBuffer buffer(storage[0], DATAGRAM_SIZE);
+
+    // The first datagram is sealed and never sent, the second fills up, and
+    // everything after that is dropped.
+    append_range(buffer, 0, 2 * CAPACITY + 5);
+    TEST_ASSERT_EQUAL_UINT32(5, buffer.get_dropped());
+    TEST_ASSERT_FALSE(buffer.seal());
+    std::vector<Record> records;
+    TEST_ASSERT_EQUAL_UINT16(0, decode(buffer.sealed(), records).dropped);
+    check_records(records, 0, CAPACITY);
+
+    // Once the first is sent, the next event seals the second, whose header
+    // carries the drops so far.
+    buffer.release();
+    append_range(buffer, 2 * CAPACITY + 5, 2 * CAPACITY + 6);
+    const Header header = decode(buffer.sealed(), records);
+    TEST_ASSERT_EQUAL_UINT16(1, header.sequence);
+    TEST_ASSERT_EQUAL_UINT16(5, header.dropped);
+    check_records(records, CAPACITY, CAPACITY);
+
+    // The dropped events leave a gap before the one that got through.
+    buffer.release();
+    TEST_ASSERT_TRUE(buffer.seal());
+    const Header third = decode(buffer.sealed(), records);
+    TEST_ASSERT_EQUAL_UINT16(2, third.sequence);
+    check_records(records, 2 * CAPACITY + 5, 1);
+}
+
+void test_sequence_wraps() {
+    TelemetryBuffer buffer(storage[0], DATAGRAM_SIZE);
+    std::vector<Record> records;
+    for (uint32_t i = 0; i < 0x10001; i++) {
+        append_range(buffer, i, i + 1);
+        TEST_ASSERT_TRUE(buffer.seal());
+        const Header header = decode(buffer.sealed(), records);
+        TEST_ASSERT_EQUAL_UINT16(static_cast<uint16_t>(i), header.sequence);
+        buffer.release();
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_nothing_sealed_until_full);
+    RUN_TEST(test_fill_past_one_datagram);
+    RUN_TEST(test_partial_datagram_at_cadence);
+    RUN_TEST(test_drop_when_both_buffers_ready);
+    RUN_TEST(test_sequence_wraps);
+    return UNITY_END();
+}
@@ -0,0 +1,276 @@
+#include <unity.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+#include "weightlog.h"
+
+using Type = WeightLog::Type;
+using Record = WeightLog::Record;
+
+static constexpr uint32_t START = 1700000000;
+
+/**
+ * Appends a record and remembers it.
+ */
+static void append(WeightLog &log, std::vector<Record> &written, const Type type, const int32_t decigrams, const uint32_t time) {
+    log.append(type, static_cast<float>(decigrams) / 10.0f, time);
+    written.push_back({time, type, decigrams});
+}
+
+/**
+ * Reads the whole log.
+ */
+static std::vector<Record> read_all(const WeightLog &log, uint32_t *corrupt = nullptr) {
+    auto reader = std::make_unique<WeightLog::Reader>(log);
+    std::vector<Record> records;
+    Record record = {};
+    while (reader->next(record)) records.push_back(record);
+    if (corrupt) *corrupt = reader->get_corrupt();
+    return records;
+}
+
+/**
+ * Checks that actual equals a contiguous run of expected, starting at the
+ * record with the same time as its first, and returns the index in expected
+ * just past that run. Times must be unique.
+ */
+static size_t assert_run(const std::vector<Record> &expected, const std::vector<Record> &actual) {
+    size_t start = 0;
+    if (!actual.empty()) {
+        while (start < expected.size() && expected[start].time != actual[0].time) start++;
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(expected.size(), start + actual.size());
+    for (size_t i = 0; i < actual.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(expected[start + i].time, actual[i].time);
+        TEST_ASSERT_EQUAL(static_cast<int>(expected[start + i].type), static_cast<int>(actual[i].type));
+        TEST_ASSERT_EQUAL_INT32(expected[start + i].value, actual[i].value);
+    }
+    return start + actual.size();
+}
+
+/**
+ * Checks that actual equals the first actual.size() records of expected.
+ */
+static void assert_prefix(const std::vector<Record> &expected, const std::vector<Record> &actual) {
+    TEST_ASSERT_EQUAL_size_t(actual.size(), assert_run(expected, actual));
+}
+
+/**
+ * Appends a typical day: reservoir and bowl alternating every five
+ * minutes, with some jitter, and a few feeds and meals.
+ */
+static void append_day(WeightLog &log, std::vector<Record> &written, std::mt19937 &rng, uint32_t &time) {
+    std::uniform_int_distribution<int> jitter(0, 2);
+    std::uniform_int_distribution<int> noise(-3, 3);
+    for (int i = 0; i < 288; i++) {
+        time += 300 + jitter(rng);
+        const auto type = i % 2 ? Type::BOWL : Type::RESERVOIR;
+        const int32_t base = type == Type::BOWL ? 250 : 32000 - static_cast<int32_t>(written.size());
+        append(log, written, type, base + noise(rng), time);
+        if (i % 48 == 0) append(log, written, Type::FEED, 90 + noise(rng), ++time);
+        if (i % 48 == 24) append(log, written, Type::MEAL, 120 + noise(rng), ++time);
+    }
+}
+
+void setUp() {
+    LittleFS.format();
+}
+
+void tearDown() {
+}
+
+void test_round_trip_random() {
+    auto log = std::make_unique<WeightLog>();
+    std::vector<Record> written;
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> type(0, 3);
+    std::uniform_int_distribution<int32_t> value(-2000000, 2000000);
+    std::uniform_int_distribution<uint32_t> step(0, 100000);
+    uint32_t time = START;
+    for (int i = 0; i < 20000; i++) {
+        time += 1 + (i % 100 ? step(rng) % 700 : step(rng));
+        append(*log, written, static_cast<Type>(type(rng)), i % 7 ? value(rng) % 5000 : value(rng), time);
+    }
+    const auto records = read_all(*log);
+    TEST_ASSERT_EQUAL(written.size(), records.size());
+    assert_prefix(written, records);
+}
+
+void test_extreme_values() {
+    auto log = std::make_unique<WeightLog>();
+    std::vector<Record> written;
+    static const int32_t VALUES[] = {0, 1, -1, 1000000, -1000000, 20000000, -20000000, 0};
+    uint32_t time = START;
+    for (const int32_t v : VALUES) {
+        append(*log, written, Type::BOWL, v, time);
+        time += 4000000;
+    }
+    const auto records = read_all(*log);
+    TEST_ASSERT_EQUAL(written.size(), records.size());
+    assert_prefix(written, records);
+}
+
+void test_clock_not_set_is_dropped() {
+    auto log = std::make_unique<WeightLog>();
+    log->append(Type::BOWL, 1.0f, 1000);
+    TEST_ASSERT_EQUAL_UINT32(1, log->get_dropped());
+    TEST_ASSERT_EQUAL(0, read_all(*log).size());
+}
+
+void test_bytes_per_record_and_throughput() {
+    auto log = std::make_unique<WeightLog>();
+    std::vector<Record> written;
+    std::mt19937 rng(5);
+    uint32_t time = START;
+    const auto encode_start = std::chrono::steady_clock::now();
+    for (int day = 0; day < 30; day++) append_day(*log, written, rng, time);
+    const auto encode_end = std::chrono::steady_clock::now();
+    const auto records = read_all(*log);
+    const auto decode_end = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(written.size(), records.size());
+
+    // The records still in RAM are less than one block of over a hundred.
+    const size_t blocks = LittleFS.size("/wlog.bin") / WeightLog::BLOCK_SIZE;
+    const double bytes_per_record = static_cast<double>((blocks + 1) * WeightLog::BLOCK_SIZE) / static_cast<double>(written.size());
+    const auto us = [](auto d) { return std::chrono::duration_cast<std::chrono::microseconds>(d).count(); };
+    char message[160];
+    snprintf(message, sizeof(message), "%zu records in %zu blocks, %.2f bytes/record; encode %lld us, decode %lld us",
+        written.size(), blocks, bytes_per_record, static_cast<long long>(us(encode_end - encode_start)),
+        static_cast<long long>(us(decode_end - encode_end)));
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN(3.0, bytes_per_record);
+}
+
+void test_tail_survives_restart() {
+    auto log = std::make_unique<WeightLog>();
+    std::vector<Record> written;
+    std::mt19937 rng(2);
+    uint32_t time = START;
+    append_day(*log, written, rng, time);
+    TEST_ASSERT_TRUE(log->save_tail());
+
+    auto restarted = std::make_unique<WeightLog>();
+    restarted->begin();
+    auto records = read_all(*restarted);
+    TEST_ASSERT_EQUAL(written.size(), records.size());
+    assert_prefix(written, records);
+
+    // Appending continues the restored block with the same encoder state.
+    append_day(*restarted, written, rng, time);
+    records = read_all(*restarted);
+    TEST_ASSERT_EQUAL(written.size(), records.size());
+    assert_prefix(written, records);
+}
+
+void test_corrupt_block_is_skipped() {
+    auto log = std::make_unique<WeightLog>();
+    std::vector<Record> written;
+    std::mt19937 rng(3);
+    uint32_t time = START;
+    append_day(*log, written, rng, time);
+    append_day(*log, written, rng, time);
+    auto data = LittleFS.contents("/wlog.bin");
+    TEST_ASSERT_GREATER_THAN(2 * WeightLog::BLOCK_SIZE, data.size());
+    data[WeightLog::BLOCK_SIZE + 20] ^= 0x10;
+    LittleFS.store("/wlog.bin", data);
+    uint32_t corrupt = 0;
+    const auto records = read_all(*log, &corrupt);
+    TEST_ASSERT_EQUAL_UINT32(1, corrupt);
+    TEST_ASSERT_LESS_THAN(written.size(), records.size());
+}
+
+/**
+ * Brings the log to the append that flushes a block, saves the tail just
+ * before it, then loses power after each possible number of commits of that
+ * flush. After a restart, the log must hold every record up to the saved
+ * tail exactly once, in order, though a rotation may drop the oldest file.
+ */
+static void check_power_loss_during_flush(WeightLog &log, std::vector<Record> &written, uint32_t &time) {
+    // Find the append that flushes.
+    const HostFS fs = LittleFS;
+    const auto saved = std::make_unique<WeightLog>(log);
+    const size_t saved_count = written.size();
+    uint32_t t = time;
+    size_t appends = 0;
+    while (LittleFS.size("/wlog.bin") == fs.size("/wlog.bin") && LittleFS.size("/wlog.old") == fs.size("/wlog.old")) {
+        t += 300;
+        append(log, written, Type::RESERVOIR, 1000 + static_cast<int32_t>(appends), t);
+        appends++;
+    }
+
+    for (int commits = 0; commits <= 5; commits++) {
+        LittleFS = fs;
+        log = *saved;
+        written.resize(saved_count);
+        t = time;
+        for (size_t i = 0; i + 1 < appends; i++) {
+            t += 300;
+            append(log, written, Type::RESERVOIR, 1000 + static_cast<int32_t>(i), t);
+        }
+        TEST_ASSERT_TRUE(log.save_tail());
+        const size_t durable = written.size();
+        LittleFS.cut_power_after(commits);
+        t += 300;
+        append(log, written, Type::RESERVOIR, 1000 + static_cast<int32_t>(appends - 1), t);
+        LittleFS.restore_power();
+
+        auto restarted = std::make_unique<WeightLog>();
+        restarted->begin();
+        const auto records = read_all(*restarted);
+        TEST_ASSERT_GREATER_OR_EQUAL(durable, assert_run(written, records));
+
+        // A second restart must not change anything either.
+        auto again = std::make_unique<WeightLog>();
+        again->begin();
+        TEST_ASSERT_EQUAL(records.size(), read_all(*again).size());
+    }
+    time = t;
+}
+
+void test_power_loss_during_flush() {
+    auto log = std::make_unique<WeightLog>();
+    std::vector<Record> written;
+    std::mt19937 rng(4);
+    uint32_t time = START;
+    append_day(*log, written, rng, time);
+    check_power_loss_during_flush(*log, written, time);
+}
+
+void test_power_loss_during_rotation() {
+    auto log = std::make_unique<WeightLog>();
+    std::vector<Record> written;
+    uint32_t time = START;
+
+    // Rotate twice, so the next rotation also removes the previous file,
+    // and stop just short of it.
+    for (int rotation = 0; rotation < 2; rotation++) {
+        size_t size = 0;
+        while (LittleFS.size("/wlog.bin") >= size) {
+            size = LittleFS.size("/wlog.bin");
+            time += 300;
+            append(*log, written, Type::BOWL, static_cast<int32_t>(time % 1000), time);
+        }
+    }
+    while (LittleFS.size("/wlog.bin") < (WeightLog::MAX_FILE_BLOCKS - 1) * WeightLog::BLOCK_SIZE) {
+        time += 300;
+        append(*log, written, Type::BOWL, static_cast<int32_t>(time % 1000), time);
+    }
+
+    TEST_ASSERT_TRUE(LittleFS.exists("/wlog.old"));
+    check_power_loss_during_flush(*log, written, time);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_random);
+    RUN_TEST(test_extreme_values);
+    RUN_TEST(test_clock_not_set_is_dropped);
+    RUN_TEST(test_bytes_per_record_and_throughput);
+    RUN_TEST(test_tail_survives_restart);
+    RUN_TEST(test_corrupt_block_is_skipped);
+    RUN_TEST(test_power_loss_during_flush);
+    RUN_TEST(test_power_loss_during_rotation);
+    return UNITY_END();
+}
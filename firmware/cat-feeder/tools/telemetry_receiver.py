@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Receives the cat feeder UDP telemetry stream and writes it as CSV.
+
+Enable TELEMETRY_ENABLE in include/telemetry.h and point its HOST at the
+machine running this script. Usage:
+
+    telemetry_receiver.py [--port 5005] [output.csv]
+
+Writes to stdout if no output file is given. Gaps in the datagram sequence
+and the device-side dropped event counter are reported on stderr.
+"""
+
+import argparse
+import csv
+import socket
+import struct
+import sys
+
+HEADER = struct.Struct('<2sBBHH')
+RECORD = struct.Struct('<IBBi')
+EVENTS = ['sample', 'limit', 'motor', 'state']
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--port', type=int, default=5005)
+    parser.add_argument('output', nargs='?')
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(('', args.port))
+
+    out = open(args.output, 'w', newline='') if args.output else sys.stdout
+    writer = csv.writer(out)
+    writer.writerow(['sequence', 'micros', 'event', 'arg', 'value'])
+
+    expected = None
+    dropped = 0
+    try:
+        while True:
+            data, _ = sock.recvfrom(2048)
+            if len(data) < HEADER.size:
+                continue
+            magic, version, count, sequence, device_dropped = HEADER.unpack_from(data)
+            if magic != b'CF' or version != 1:
+                continue
+            if expected is not None and sequence != expected:
+                print(f'lost {(sequence - expected) & 0xFFFF} datagram(s)', file=sys.stderr)
+            expected = (sequence + 1) & 0xFFFF
+            if device_dropped != dropped:
+                print(f'device dropped {(device_dropped - dropped) & 0xFFFF} event(s)', file=sys.stderr)
+                dropped = device_dropped
+            for i in range(count):
+                offset = HEADER.size + i * RECORD.size
+                if offset + RECORD.size > len(data):
+                    break
+                micros, event, arg, value = RECORD.unpack_from(data, offset)
+                name = EVENTS[event] if event < len(EVENTS) else str(event)
+                writer.writerow([sequence, micros, name, arg, value])
+            out.flush()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""Converts a cat feeder event trace dump to Chrome trace-event JSON.
+
+Enable TRACE_ENABLE in include/trace.h, send the "trace" command over the
+serial console and save everything it prints. Usage:
+
+    trace_to_chrome.py [dump.txt] [output.json]
+
+Reads stdin and writes stdout if no files are given. Open the result in
+https://ui.perfetto.dev or chrome://tracing. Subsystem calls appear as
+slices per core; states, samples, limit switch edges, motor changes and
+publishes as instant events. Lines that aren't part of the dump, such as
+other serial output, are ignored.
+"""
+
+import argparse
+import json
+import sys
+
+INSTANT_EVENTS = {'state', 'sample', 'limit', 'motor', 'publish'}
+
+
+def parse(lines):
+    """Yields (core, micros, event, arg, value) per dump record."""
+    for line in lines:
+        line = line.strip()
+        if not line or line.startswith('#'):
+            continue
+        fields = line.split(',')
+        if len(fields) != 5:
+            continue
+        try:
+            core = int(fields[0])
+            micros = int(fields[1])
+            value = int(fields[4])
+        except ValueError:
+            continue
+        yield core, micros, fields[2], fields[3], value
+
+
+def unwrap(records):
+    """Replaces the wrapping 32-bit timestamps, which both cores take from
+    the same timer, by their signed distance to the last record. The rings
+    span far less than the 71 minute wrap period."""
+    if not records:
+        return records
+    reference = records[-1][1]
+    result = []
+    for core, micros, event, arg, value in records:
+        delta = (micros - reference) & 0xFFFFFFFF
+        if delta >= 1 << 31:
+            delta -= 1 << 32
+        result.append((core, delta, event, arg, value))
+    return result
+
+
+def convert(records):
+    events = [
+        {'name': 'process_name', 'ph': 'M', 'pid': 0, 'args': {'name': 'cat feeder'}},
+        {'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': 0, 'args': {'name': 'core 0'}},
+        {'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': 1, 'args': {'name': 'core 1'}},
+    ]
+    records = unwrap(list(records))
+    if not records:
+        return {'traceEvents': events}
+
+    # Start the timeline at the first event present on both cores, as the
+    # older part of the busier core's ring has nothing to line up with.
+    start = max(min(r[1] for r in records if r[0] == core) for core in {r[0] for r in records})
+    open_spans = {}
+    for core, micros, event, arg, value in records:
+        if micros < start:
+            continue
+        base = {'pid': 0, 'tid': core, 'ts': micros - start}
+        if event == 'begin':
+            open_spans.setdefault(core, []).append(arg)
+            events.append(dict(base, name=arg, ph='B'))
+        elif event == 'end':
+            # Drop ends whose begin was overwritten in the ring.
+            stack = open_spans.get(core, [])
+            if arg not in stack:
+                continue
+            while stack and stack.pop() != arg:
+                pass
+            events.append(dict(base, name=arg, ph='E'))
+        elif event in INSTANT_EVENTS:
+            name = f'{event} {arg}' if event in ('state', 'sample') else event
+            events.append(dict(base, name=name, ph='i', s='t', args={'arg': arg, 'value': value}))
+    return {'traceEvents': events, 'displayTimeUnit': 'ms'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('input', nargs='?')
+    parser.add_argument('output', nargs='?')
+    args = parser.parse_args()
+
+    source = open(args.input) if args.input else sys.stdin
+    out = open(args.output, 'w') if args.output else sys.stdout
+    json.dump(convert(parse(source)), out)
+    out.write('\n')
+
+
+if __name__ == '__main__':
+    main()